@@ -0,0 +1,150 @@
+#include "Synthetic.hh"
+#include "Decoder.hh"
+#include "LazyFile.hh"
+#include "LEB128.hh"
+#include "Utilities/Concurrency.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace nir;
+using namespace nir::benchmark;
+
+/// The number of times each benchmark is run, the shortest of which is reported.
+constexpr std::size_t repetitions = 5;
+
+/// Benchmarks the decoding of unsigned LEB128s by each kernel supported by the host and by the
+/// scalar and bulk methods of `Decoder`.
+void benchmark_leb128() {
+  // Most integers in NIR files are small indices and sizes.
+  std::mt19937_64 random(42);
+  std::vector<uint8_t> bytes;
+  std::size_t count = 4'000'000;
+  for (std::size_t i = 0; i < count; ++i) {
+    auto r = random() % 100;
+    auto v = (r < 80) ? random() % 128 : (r < 95) ? random() % 16384 : random() % (1u << 31);
+    do {
+      uint8_t b = v & 0x7f;
+      v >>= 7;
+      bytes.push_back((v != 0) ? (b | 0x80) : b);
+    } while (v != 0);
+  }
+
+  std::vector<uint64_t> decoded(count);
+  auto run = [&](char const* name, auto kernel) {
+    auto t = best_time(repetitions, [&]() {
+      const uint8_t* p = bytes.data();
+      const uint8_t* end = bytes.data() + bytes.size();
+      auto i = kernel(p, end, count, decoded.data());
+
+      // The kernels leave the values near the end of the bytes to a checked decoder.
+      Decoder tail(std::span<const uint8_t>(p, end));
+      for (; i < count; ++i) { decoded[i] = tail.read_unsigned_leb128(); }
+    });
+    report(name, t, bytes.size());
+  };
+
+  run("leb128/scalar", &leb128::decode_unsigned_scalar);
+#ifdef NIRC_HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) { run("leb128/sse2", &leb128::decode_unsigned_sse2); }
+  if (__builtin_cpu_supports("avx2")) { run("leb128/avx2", &leb128::decode_unsigned_avx2); }
+#endif
+
+  auto one_at_a_time = best_time(repetitions, [&]() {
+    Decoder d(std::span<const uint8_t>(bytes.data(), bytes.size()));
+    for (std::size_t i = 0; i < count; ++i) { decoded[i] = d.read_unsigned_leb128(); }
+  });
+  report("decoder/one-at-a-time", one_at_a_time, bytes.size());
+
+  auto bulk = best_time(repetitions, [&]() {
+    Decoder d(std::span<const uint8_t>(bytes.data(), bytes.size()));
+    d.read_unsigned_leb128s(count, decoded.data());
+  });
+  report("decoder/bulk", bulk, bytes.size());
+}
+
+/// Calls `action` with a file descriptor from which `bytes` are read through a pipe.
+template<typename F>
+void with_pipe(std::vector<uint8_t> const& bytes, F&& action) {
+  int fds[2];
+  if (pipe(fds) != 0) { std::exit(1); }
+  std::thread writer([&]() {
+    for (std::size_t i = 0; i < bytes.size();) {
+      auto n = write(fds[1], bytes.data() + i, bytes.size() - i);
+      if (n <= 0) { break; }
+      i += static_cast<std::size_t>(n);
+    }
+    close(fds[1]);
+  });
+  action(fds[0]);
+  close(fds[0]);
+  writer.join();
+}
+
+/// Benchmarks the encoding and the decoding of a file holding `class_count` synthetic classes.
+void benchmark_file(std::size_t class_count) {
+  auto original = synthetic_file(0, class_count, 8, 40);
+  std::vector<uint8_t> bytes;
+  auto serialization = best_time(repetitions, [&]() { bytes = original.serialized(); });
+  std::printf(
+    "file: %zu definitions, %zu bytes\n", original.definitions.size(), bytes.size());
+  report("serialize", serialization, bytes.size());
+
+  auto decode = [&](char const* name, DecodingOptions const& options) {
+    auto t = best_time(repetitions, [&]() { File::from_bytes(bytes, options); });
+    report(name, t, bytes.size());
+  };
+  decode("decode/borrowed", DecodingOptions{1, false, false});
+  decode("decode/borrowed+arena", DecodingOptions{1, true, false});
+  decode("decode/borrowed+strip-debug", DecodingOptions{1, false, true});
+  decode("decode/borrowed+arena+strip-debug", DecodingOptions{1, true, true});
+  for (std::size_t n : {2, 4}) {
+    auto name = "decode/borrowed+arena+threads=" + std::to_string(n);
+    decode(name.c_str(), DecodingOptions{n, true, false});
+  }
+
+  auto owned = best_time(repetitions, [&]() {
+    File::from_buffer(std::vector<uint8_t>(bytes), DecodingOptions{1, true, false});
+  });
+  report("decode/owned-copy+arena", owned, bytes.size());
+
+  auto path = std::filesystem::temp_directory_path() / ("nirc-bench-" + std::to_string(getpid()));
+  write_file(path, bytes);
+  auto mapped = best_time(repetitions, [&]() {
+    File::from_contents_of(path.string(), DecodingOptions{1, true, false});
+  });
+  report("decode/mapped+arena", mapped, bytes.size());
+  std::filesystem::remove(path);
+
+  auto streamed = best_time(repetitions, [&]() {
+    with_pipe(bytes, [](int fd) { File::from_descriptor(fd, DecodingOptions{1, true, false}); });
+  });
+  report("decode/pipe+arena", streamed, bytes.size());
+
+  // A lazy file is skimmed entirely, then decodes only the definitions that are accessed.
+  auto skim = best_time(repetitions, [&]() { LazyFile::from_bytes(bytes); });
+  report("lazy/skim", skim, bytes.size());
+  auto one = best_time(repetitions, [&]() {
+    auto f = LazyFile::from_bytes(bytes);
+    f.at(f.size() / 2);
+  });
+  report("lazy/skim+one-definition", one, bytes.size());
+}
+
+/// Runs the benchmarks over a file of `argv[1]` synthetic classes, or 2000 if it isn't specified.
+int main(int argc, char** argv) {
+  std::size_t class_count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000;
+  std::printf("hardware threads: %zu\n", hardware_thread_count());
+  benchmark_leb128();
+  benchmark_file(class_count);
+  return 0;
+}
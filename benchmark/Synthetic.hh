@@ -0,0 +1,157 @@
+#ifndef NIRC_BENCHMARK_SYNTHETIC_H
+#define NIRC_BENCHMARK_SYNTHETIC_H
+
+#include "File.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace nir::benchmark {
+
+/// The name of the `k`-th synthetic class.
+inline symbol::Top synthetic_class_name(std::size_t k) {
+  return symbol::Top("bench.p" + std::to_string(k % 16) + ".C" + std::to_string(k));
+}
+
+/// Returns the definitions of the `k`-th synthetic class, which has `method_count` methods of
+/// about `instruction_count` instructions each, a few fields, and a constant array.
+///
+/// The methods call each other and the methods of the class `k + 1`, so that the symbols, types,
+/// and strings of a file are interned and referred to several times, as they are in classpaths.
+inline std::vector<Definition> synthetic_class(
+  std::size_t k, std::size_t method_count, std::size_t instruction_count
+) {
+  auto object = symbol::Top("java.lang.Object");
+  auto owner = synthetic_class_name(k);
+  auto neighbor = synthetic_class_name(k + 1);
+  auto ref = Type(type::Reference(owner));
+  auto path =
+    "src/main/scala/bench/p" + std::to_string(k % 16) + "/C" + std::to_string(k) + ".scala";
+  auto at = [&](uint32_t line) { return SourcePosition{SourceFile(path), line, 4}; };
+
+  std::vector<Definition> result;
+  result.push_back(definition::Class{{}, owner, object, {}, at(1)});
+  auto field = symbol::Member(owner, Signature{"F5countO"});
+  result.push_back(definition::Binding{
+    {}, field, Type::i32(), Value(value::Zero(Type::i32())), false, at(2)
+  });
+
+  std::vector<value::Int> table(256);
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    table[i] = static_cast<value::Int>((i * 2654435761u) >> (i % 24));
+  }
+  auto constant = Value(value::ArrayValue(std::move(table)));
+  result.push_back(definition::Binding{
+    {}, symbol::Member(owner, Signature{"F5tableO"}), constant.type(), constant, true, at(3)
+  });
+
+  // String constants are views, whose characters must outlive the definitions.
+  static constexpr char const* messages[] = {"ready", "not ready", "done", "failed", "retrying"};
+
+  auto callee_type = type::Function({ref, Type::i32()}, Type::i32());
+  for (std::size_t m = 0; m < method_count; ++m) {
+    auto self = value::Local(1, ref);
+    auto x = Value(value::Local(2, Type::i32()));
+    auto callee = symbol::Member(
+      (m % 2 == 0) ? owner : neighbor,
+      Signature{"D3run" + std::to_string((m + 1) % method_count) + "iiEO"});
+
+    std::vector<Instruction> is;
+    is.push_back(instruction::Label{0, {self, value::Local(2, Type::i32())}, at(10)});
+    Local id = 10;
+    for (std::size_t i = 0; i < instruction_count; ++i) {
+      auto line = static_cast<uint32_t>(10 + i);
+      auto previous = Value(value::Local(id - 1, Type::i32()));
+      Operation o = operation::Copy{x};
+      switch (i % 6) {
+        case 0:
+          o = operation::Call{
+            callee_type, Value(value::Symbol(Symbol(callee), Type(callee_type))), {Value(self), x}
+          };
+          break;
+        case 1:
+          o = operation::FieldLoad{Type::i32(), Value(self), field};
+          break;
+        case 2:
+          o = operation::BinaryApply{
+            BinaryOperator::iadd, Type::i32(), previous, Value(value::Int(static_cast<int32_t>(i)))
+          };
+          break;
+        case 3:
+          o = operation::Compare{ComparisonOperator::slt, Type::i32(), previous, x};
+          break;
+        case 4:
+          o = operation::Copy{Value(value::String(messages[i % std::size(messages)]))};
+          break;
+        default:
+          o = operation::Convert{ConversionOperator::sext, Type::i64(), previous};
+          break;
+      }
+      is.push_back(instruction::Let{id++, o, Next::none(), at(line), {1}});
+    }
+    is.push_back(instruction::Return{Value(value::Local(id - 1, Type::i32())), at(99)});
+
+    definition::Method::DebugInformation debug{
+      {{1, "this"}, {2, "x"}, {10, "result"}},
+      {LexicalScope{{1}, {0}, at(10)}}
+    };
+    result.push_back(definition::Method{
+      {}, symbol::Member(owner, Signature{"D3run" + std::to_string(m) + "iiEO"}),
+      callee_type, std::move(is), debug, at(10)
+    });
+  }
+  return result;
+}
+
+/// Returns a file holding the synthetic classes in `[first, first + count)`.
+inline File synthetic_file(
+  std::size_t first, std::size_t count, std::size_t method_count, std::size_t instruction_count
+) {
+  std::vector<Definition> definitions;
+  for (std::size_t k = first; k < first + count; ++k) {
+    for (auto& d : synthetic_class(k, method_count, instruction_count)) {
+      definitions.push_back(std::move(d));
+    }
+  }
+  return File(Header{5, 1, false}, std::move(definitions));
+}
+
+/// Writes `bytes` to the file at `path`.
+inline void write_file(std::filesystem::path const& path, std::vector<uint8_t> const& bytes) {
+  std::ofstream(path, std::ios::binary).write(
+    reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+/// Returns the shortest time in milliseconds taken by `action` over `repetitions` runs.
+template<typename F>
+double best_time(std::size_t repetitions, F&& action) {
+  double best = 0;
+  for (std::size_t i = 0; i < repetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if ((i == 0) || (elapsed.count() < best)) { best = elapsed.count(); }
+  }
+  return best;
+}
+
+/// Prints the time taken by the benchmark `name`, along with its throughput over `byte_count`
+/// bytes if that number isn't `0`.
+inline void report(char const* name, double milliseconds, std::size_t byte_count = 0) {
+  if (byte_count == 0) {
+    std::printf("%-36s %10.2f ms\n", name, milliseconds);
+  } else {
+    auto throughput = static_cast<double>(byte_count) / (milliseconds * 1000.0);
+    std::printf("%-36s %10.2f ms %10.1f MB/s\n", name, milliseconds, throughput);
+  }
+}
+
+} // nir::benchmark
+
+#endif
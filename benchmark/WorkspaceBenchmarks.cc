@@ -0,0 +1,196 @@
+#include "Synthetic.hh"
+#include "BatchReader.hh"
+#include "Bundle.hh"
+#include "LazyWorkspace.hh"
+#include "SymbolIndex.hh"
+#include "Workspace.hh"
+#include "Utilities/Concurrency.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace nir;
+using namespace nir::benchmark;
+
+/// The number of times each benchmark is run, the shortest of which is reported.
+constexpr std::size_t repetitions = 5;
+
+/// Benchmarks the reading of the files in `files`, whose total size is `byte_count`.
+void benchmark_reading(std::vector<FoundFile> const& files, std::size_t byte_count) {
+  std::vector<std::filesystem::path> paths;
+  std::vector<std::uintmax_t> sizes;
+  for (auto const& f : files) {
+    paths.push_back(f.path);
+    sizes.push_back(f.size);
+  }
+
+  auto streams = best_time(repetitions, [&]() {
+    for (auto const& p : paths) {
+      std::ifstream s(p, std::ios::binary);
+      std::vector<uint8_t> contents(
+        (std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+    }
+  });
+  report("read/ifstream", streams, byte_count);
+
+  std::size_t system_calls = 0;
+  bool uses_io_uring = false;
+  auto batched = best_time(repetitions, [&]() {
+    BatchReader r(32);
+    r.read(paths, sizes);
+    system_calls = r.system_call_count();
+    uses_io_uring = r.uses_io_uring();
+  });
+  report(uses_io_uring ? "read/batch-reader(io_uring)" : "read/batch-reader(pread)", batched,
+    byte_count);
+  std::printf("  %zu system calls for %zu files\n", system_calls, paths.size());
+}
+
+/// Benchmarks the loading of the workspace at `root`, whose total size is `byte_count`.
+void benchmark_loading(std::filesystem::path const& root, std::size_t byte_count) {
+  for (std::size_t n : {1, 4}) {
+    auto t = best_time(repetitions, [&]() {
+      Workspace::load({root}, WorkspaceOptions{n, 32, DecodingOptions{1, true, false}});
+    });
+    auto name = "workspace/load+threads=" + std::to_string(n);
+    report(name.c_str(), t, byte_count);
+  }
+}
+
+/// Benchmarks the packing and the loading of a bundle of the files in `files`.
+void benchmark_bundle(std::vector<FoundFile> const& files, std::filesystem::path const& output) {
+  std::vector<std::filesystem::path> paths;
+  std::size_t byte_count = 0;
+  for (auto const& f : files) {
+    paths.push_back(f.path);
+    byte_count += f.size;
+  }
+
+  auto pack = best_time(1, [&]() { Bundle::pack(paths, output); });
+  report("bundle/pack", pack, byte_count);
+  std::printf(
+    "  %zu bytes of files, %ju bytes of bundle\n",
+    byte_count, static_cast<std::uintmax_t>(std::filesystem::file_size(output)));
+
+  auto separate = best_time(repetitions, [&]() {
+    for (auto const& p : paths) { File::from_contents_of(p.string(), DecodingOptions{1, true}); }
+  });
+  report("bundle/load-files-separately", separate, byte_count);
+
+  auto bundled = best_time(repetitions, [&]() {
+    auto b = Bundle::open(output.string());
+    for (std::size_t i = 0; i < b.size(); ++i) { b.load(i, DecodingOptions{1, true}); }
+  });
+  report("bundle/open+load-members", bundled, byte_count);
+
+  auto b = Bundle::open(output.string());
+  std::size_t member_byte_count = 0;
+  for (std::size_t i = 0; i < b.size(); ++i) { member_byte_count += b.contents(i).size(); }
+  std::printf("  %zu bytes of members\n", member_byte_count);
+
+  auto lookups = best_time(repetitions, [&]() {
+    for (std::size_t k = 0; k < paths.size(); ++k) { b.find(Symbol(synthetic_class_name(k))); }
+  });
+  report("bundle/find-each-class", lookups);
+}
+
+/// Benchmarks the lookup of definitions in a lazy workspace over `root`, whose filters are stored
+/// in `table`, and which holds `class_count` synthetic classes.
+void benchmark_lazy_workspace(
+  std::filesystem::path const& root, std::filesystem::path const& table, std::size_t class_count
+) {
+  std::filesystem::remove(table);
+  auto cold = best_time(1, [&]() { LazyWorkspace::open({root}, table); });
+  report("lazy-workspace/open-without-table", cold);
+  auto warm = best_time(repetitions, [&]() { LazyWorkspace::open({root}, table); });
+  report("lazy-workspace/open-with-table", warm);
+
+  auto w = LazyWorkspace::open({root}, table);
+  auto hits = best_time(1, [&]() {
+    for (std::size_t k = 0; k < class_count; k += 16) {
+      w.definition(Symbol(synthetic_class_name(k)));
+    }
+  });
+  report("lazy-workspace/find-every-16th-class", hits);
+
+  auto misses = best_time(repetitions, [&]() {
+    for (std::size_t k = 0; k < 1000; ++k) {
+      w.definition(Symbol(symbol::Top("bench.Missing" + std::to_string(k))));
+    }
+  });
+  report("lazy-workspace/miss-1000-symbols", misses);
+
+  auto const& s = w.statistics();
+  std::printf(
+    "  %zu queries, %zu files skipped, %zu candidates, %zu false positives\n",
+    s.query_count, s.skipped_count, s.candidate_count, s.false_positive_count);
+}
+
+/// Benchmarks the construction of a symbol index over the workspace at `root` and the lookup of
+/// its definitions, compared to a hash map from symbol to location.
+void benchmark_symbol_index(std::filesystem::path const& root) {
+  auto w = Workspace::load({root});
+  std::vector<Symbol> names;
+  w.for_each_definition([&](Definition const& d) { names.push_back(d.name()); });
+  std::printf("symbols: %zu\n", names.size());
+
+  auto build = best_time(repetitions, [&]() { SymbolIndex::build(w, 1); });
+  report("symbol-index/build+threads=1", build);
+
+  auto index = SymbolIndex::build(w);
+  std::size_t found = 0;
+  auto lookups = best_time(repetitions, [&]() {
+    for (auto const& n : names) { found += index.find(n).has_value(); }
+  });
+  report("symbol-index/find-all", lookups);
+
+  std::unordered_map<Symbol, std::size_t> map;
+  auto fill = best_time(repetitions, [&]() {
+    map.clear();
+    for (std::size_t i = 0; i < names.size(); ++i) { map.emplace(names[i], i); }
+  });
+  report("unordered-map/build", fill);
+  auto map_lookups = best_time(repetitions, [&]() {
+    for (auto const& n : names) { found += map.count(n); }
+  });
+  report("unordered-map/find-all", map_lookups);
+  if (found == 0) { std::exit(1); }
+}
+
+/// Runs the benchmarks over a workspace of `argv[1]` files holding one synthetic class each, or
+/// 2000 if it isn't specified.
+int main(int argc, char** argv) {
+  std::size_t class_count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000;
+  std::printf("hardware threads: %zu\n", hardware_thread_count());
+
+  auto directory =
+    std::filesystem::temp_directory_path() / ("nirc-bench-" + std::to_string(getpid()));
+  auto root = directory / "classes";
+  std::filesystem::create_directories(root);
+  std::size_t byte_count = 0;
+  for (std::size_t k = 0; k < class_count; ++k) {
+    auto bytes = synthetic_file(k, 1, 8, 40).serialized();
+    write_file(root / ("C" + std::to_string(k) + ".nir"), bytes);
+    byte_count += bytes.size();
+  }
+  std::printf("workspace: %zu files, %zu bytes\n", class_count, byte_count);
+
+  auto files = enumerate_files({root}, 1);
+  benchmark_reading(files, byte_count);
+  benchmark_loading(root, byte_count);
+  benchmark_bundle(files, directory / "bundle");
+  benchmark_lazy_workspace(root, directory / "filters", class_count);
+  benchmark_symbol_index(root);
+
+  std::filesystem::remove_all(directory);
+  return 0;
+}
@@ -5,6 +5,7 @@
 #include <cstdlib>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -65,7 +66,7 @@ struct BailOpt final {
 
   static constexpr Kind kind = Kind::bail_opt;
 
-  std::string message;
+  std::string_view message;
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(BailOpt const& rhs) const = default;
@@ -93,7 +94,7 @@ struct Link final {
 
   static constexpr Kind kind = Kind::link;
 
-  std::string name;
+  std::string_view name;
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Link const& rhs) const = default;
@@ -107,7 +108,7 @@ struct Define final {
 
   static constexpr Kind kind = Kind::define;
 
-  std::string name;
+  std::string_view name;
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Define const& rhs) const = default;
@@ -123,7 +124,7 @@ struct Alignment final {
 
   int64_t size;
 
-  std::optional<std::string> group;
+  std::optional<std::string_view> group;
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Alignment const& rhs) const = default;
@@ -20,7 +20,7 @@ private:
   using Thin = std::underlying_type<attribute::Kind>::type;
 
   /// A bitset specifying which thin attributes are in the list.
-  Thin thin;
+  Thin thin = 0;
 
   /// The fat members in the list.
   std::vector<Attribute> fat;
@@ -0,0 +1,86 @@
+#ifndef NIRC_BATCH_READER_H
+#define NIRC_BATCH_READER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace nir {
+
+/// A reader of the contents of many small files, which batches the system calls opening, reading,
+/// and closing them.
+///
+/// On Linux, files are read with an io_uring: the files of a batch are opened with one system
+/// call, then read with another, and closed with a third. On other platforms, if the kernel
+/// doesn't support io_uring (e.g., because it's disabled in a sandbox), or if the library is built
+/// with `NIRC_NO_IO_URING` defined, each file is opened, measured, read with `pread`, and closed in
+/// turn; threads reading files concurrently should then use one reader each. A reader whose
+/// io_uring fails also falls back to the latter method for the rest of its lifetime.
+///
+/// A reader is not thread-safe.
+struct BatchReader {
+private:
+
+  /// The io_uring through which files are read, if any.
+  struct Ring;
+
+  /// The io_uring through which files are read, or `nullptr` if it couldn't be set up.
+  std::unique_ptr<Ring> ring;
+
+  /// The maximum number of files read in a single batch.
+  std::size_t capacity;
+
+  /// The number of system calls made so far by the reader.
+  std::size_t _system_call_count;
+
+  /// Returns the contents of the file at `path`, read without the io_uring.
+  std::vector<uint8_t> read_one(std::filesystem::path const& path);
+
+  /// Reads the contents of the files at `paths` through the io_uring into `result`, expecting
+  /// them to have the sizes in `sizes`, and returns a mask indicating the files that couldn't be
+  /// read that way.
+  ///
+  /// - Precondition: `paths.size()` is at most `capacity`.
+  std::vector<bool> read_batch(
+    std::span<std::filesystem::path const> paths, std::span<std::uintmax_t const> sizes,
+    std::span<std::vector<uint8_t>> result);
+
+public:
+
+  /// Creates an instance reading up to `capacity` files per batch.
+  ///
+  /// - Precondition: `capacity` is greater than `0`.
+  BatchReader(std::size_t capacity = 32);
+
+  BatchReader(BatchReader const&) = delete;
+  BatchReader(BatchReader&&);
+
+  BatchReader& operator=(BatchReader const&) = delete;
+  BatchReader& operator=(BatchReader&&) = delete;
+
+  ~BatchReader();
+
+  /// Returns `true` if files are read through an io_uring.
+  inline bool uses_io_uring() const { return ring != nullptr; }
+
+  /// Returns the number of system calls made so far by the reader.
+  inline std::size_t system_call_count() const { return _system_call_count; }
+
+  /// Returns the contents of the files at `paths`, at the same indices, whose sizes are expected
+  /// to be equal to those in `sizes`.
+  ///
+  /// The sizes only serve to allocate buffers before the files are opened; a file whose size
+  /// turned out to be different is read again. An exception is thrown if a file can't be read.
+  ///
+  /// - Precondition: `sizes` has the same size as `paths`.
+  std::vector<std::vector<uint8_t>> read(
+    std::span<std::filesystem::path const> paths, std::span<std::uintmax_t const> sizes);
+
+};
+
+} // nir
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef NIRC_BUNDLE_H
+#define NIRC_BUNDLE_H
+
+#include "File.hh"
+#include "LazyFile.hh"
+#include "MappedFile.hh"
+#include "Symbol.hh"
+#include "Tags.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nir {
+
+/// A collection of NIR files stored in a single file, along with an index of their definitions.
+///
+/// A bundle is meant to be mapped in memory. It holds a table of the strings identifying the
+/// symbols that its members define, an index of these symbols sorted by identifier, a prelude
+/// interning the entities shared by the members, and the contents of each member. Finding the
+/// location of a definition doesn't require decoding any member, and decoding a member doesn't
+/// copy its bytes.
+///
+/// All integers are written in little-endian. The layout of a bundle is:
+/// - a header (see `Bundle::Layout`);
+/// - the offsets and sizes of the strings in the table, as pairs of 64-bit integers;
+/// - the members, as records holding the index of their path in the string table and their number
+///   of definitions as 32-bit integers, followed by the offset and size of their contents as
+///   64-bit integers;
+/// - the index, as records holding the indices of the top-level identifier and signature of a
+///   symbol in the string table, the index of the member defining it, the index of the definition
+///   in that member and its tag as 32-bit integers, followed by the offsets of the first byte of
+///   the definition and past its last byte in the member as 64-bit integers;
+/// - the characters of the strings in the table;
+/// - the prelude, as the encodings of the shared strings followed by those of the shared symbols;
+/// - the contents of the members, each aligned at a multiple of 8 bytes.
+///
+/// The strings and symbols that several members intern are written once in the prelude, which is
+/// decoded when the bundle is opened. Each member is a NIR file encoded as though its contents
+/// followed those of the prelude: its back-references can denote the entities interned by the
+/// prelude, and its interning tables start from the checkpoint reached at the end of the prelude.
+/// Each member can thus be decoded on its own, by deserializers that share the tables of the
+/// prelude rather than decoding the entities in these tables once per member.
+struct Bundle {
+public:
+
+  /// The location of a definition in a bundle.
+  struct Location {
+
+    /// The index of the member containing the definition.
+    std::size_t member;
+
+    /// The index of the definition in its member.
+    std::size_t index;
+
+    /// The kind of the definition.
+    tag::Definition tag;
+
+    /// The offset of the definition's first byte in its member.
+    std::size_t start;
+
+    /// The offset past the definition's last byte in its member.
+    std::size_t end;
+
+  };
+
+  /// The positions and sizes of the sections of a bundle, as written in its header.
+  struct Layout {
+
+    /// The number of members.
+    uint32_t member_count;
+
+    /// The number of strings in the string table.
+    uint32_t string_count;
+
+    /// The number of entries in the index.
+    uint32_t entry_count;
+
+    /// The offset of the string records.
+    uint64_t strings;
+
+    /// The offset of the member records.
+    uint64_t members;
+
+    /// The offset of the index records.
+    uint64_t entries;
+
+    /// The offset of the characters of the strings.
+    uint64_t characters;
+
+    /// The size of the bundle in bytes.
+    uint64_t size;
+
+    /// The number of strings interned by the prelude.
+    uint32_t prelude_string_count;
+
+    /// The number of symbols encoded in the prelude.
+    uint32_t prelude_symbol_count;
+
+    /// The offset of the prelude.
+    uint64_t prelude;
+
+    /// The size of the prelude in bytes.
+    uint64_t prelude_size;
+
+  };
+
+private:
+
+  /// The decoded prelude of a bundle.
+  struct Prelude;
+
+  /// The mapping of the bundle.
+  std::shared_ptr<MappedFile const> mapping;
+
+  /// The prelude of the bundle, which is shared by the members decoded from it.
+  std::shared_ptr<Prelude const> prelude;
+
+  /// The contents of the bundle.
+  std::span<const uint8_t> bytes;
+
+  /// The layout of the bundle.
+  Layout layout;
+
+  /// Creates an instance reading `mapping`, whose layout is `layout` and whose prelude has been
+  /// decoded into `prelude`.
+  Bundle(
+    std::shared_ptr<MappedFile const> mapping, std::shared_ptr<Prelude const> prelude,
+    Layout const& layout);
+
+  /// Returns the `i`-th string in the string table.
+  std::string_view string(uint32_t i) const;
+
+  /// Returns the index of the first entry in the index that isn't ordered before the symbol
+  /// identified by `top` and `signature`.
+  std::size_t lower_bound(std::string_view top, std::optional<std::string_view> signature) const;
+
+public:
+
+  /// Creates an instance reading the bundle at `path`.
+  ///
+  /// The symbols of the prelude are allocated in the arena that is current on the calling thread,
+  /// if any, which must then outlive the instance and the members decoded from it. An exception
+  /// is thrown if the file could not be read or is not a valid bundle.
+  static Bundle open(std::string const& path);
+
+  /// Writes a bundle containing the NIR files at `paths` to `output`, in the given order.
+  ///
+  /// The files are decoded and encoded again against the strings and symbols interned by the
+  /// prelude, so the bytes of a member generally differ from those of the file it was packed from.
+  ///
+  /// An exception is thrown if one of the files could not be read or decoded, or if the bundle
+  /// could not be written.
+  static void pack(
+    std::vector<std::filesystem::path> const& paths, std::filesystem::path const& output);
+
+  Bundle(Bundle const&) = delete;
+  Bundle(Bundle&&) = default;
+
+  Bundle& operator=(Bundle const&) = delete;
+  Bundle& operator=(Bundle&&) = default;
+
+  /// Returns the number of members in the bundle.
+  inline std::size_t size() const { return layout.member_count; }
+
+  /// Returns the path from which the `i`-th member was packed.
+  std::string_view path(std::size_t i) const;
+
+  /// Returns the contents of the `i`-th member, which may refer to the entities interned by the
+  /// prelude of the bundle.
+  std::span<const uint8_t> contents(std::size_t i) const;
+
+  /// Returns the number of definitions in the bundle.
+  inline std::size_t definition_count() const { return layout.entry_count; }
+
+  /// Returns the location of the definition of `name`, or `std::nullopt` if no member defines it.
+  ///
+  /// If several members define `name`, the result is in the first of them.
+  std::optional<Location> find(Symbol const& name) const;
+
+  /// Decodes the `i`-th member.
+  ///
+  /// The strings of the result may be views of the contents of the bundle or of the strings
+  /// interned by its prelude, which are kept alive by the result.
+  File load(std::size_t i, DecodingOptions const& options = {}) const;
+
+  /// Returns the `i`-th member, whose definitions are decoded on demand.
+  LazyFile load_lazily(std::size_t i) const;
+
+};
+
+} // nir
+
+#endif
@@ -4,13 +4,45 @@
 #include "Utilities/Assert.hh"
 #include "Utilities/Result.hh"
 
+#include <algorithm>
 #include <bit>
 #include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
 namespace nir {
 
+/// The kind of a failure that occurred during decoding.
+enum struct DecoderFailure : uint8_t {
+
+  /// No failure occurred.
+  none = 0,
+
+  /// There were not enough bytes left to read a value.
+  not_enough_bytes,
+
+  /// A signed LEB128 was too big for a 64-bit signed integer.
+  signed_leb128_overflow,
+
+  /// An unsigned LEB128 was too big for a 64-bit unsigned integer.
+  unsigned_leb128_overflow,
+
+  /// A back-reference designated an entry that has not been decoded.
+  invalid_reference,
+
+  /// A local value had an identifier too big to be represented (see `value::Local`).
+  local_overflow,
+
+};
+
+/// Returns a description of `f`.
+std::string description(DecoderFailure f);
+
 /// An error that occurred during decoding.
 struct DecoderError: public std::exception {
 
@@ -24,52 +56,269 @@ struct DecoderError: public std::exception {
   /// by `d`.
   DecoderError(std::size_t p, const std::string& d) : offset(p), diagnostic(d) {}
 
+  /// Creates an instance denoting a failure of kind `f` that occured at offset `p`.
+  DecoderError(std::size_t p, DecoderFailure f) : offset(p), diagnostic(description(f)) {}
+
+  /// Returns a description of the error.
+  const char* what() const noexcept override { return diagnostic.c_str(); }
+
 };
 
 /// A helper to decode information from an array of bytes.
+///
+/// The bytes are either held entirely in memory or read incrementally from a stream into a
+/// bounded sliding window, in which case bytes preceding the current position may be discarded.
 struct Decoder {
+public:
+
+  /// A function writing up to `n` bytes of a stream to `o` and returning the number of bytes
+  /// written, which is `0` only at the end of the stream.
+  using Refill = std::function<std::size_t(uint8_t* o, std::size_t n)>;
+
 private:
 
+  /// The storage of the bytes from which information is being decoded.
+  std::shared_ptr<void const> storage;
+
   /// The raw bytes from which information is being decoded.
-  std::vector<uint8_t> source;
+  std::span<const uint8_t> source;
 
   /// The current position of the decoder in `source`.
   std::size_t position;
 
+  /// The function reading more bytes into `window` if the decoder reads from a stream.
+  Refill refill;
+
+  /// The buffer into which bytes are read if the decoder reads from a stream.
+  std::vector<uint8_t> window;
+
+  /// The offset of `source`'s first byte in the stream from which the decoder reads.
+  std::size_t window_offset;
+
+  /// The first failure that occurred since the last time failures were checked.
+  DecoderFailure failure;
+
+  /// The position at which `failure` occurred.
+  std::size_t failure_position;
+
   /// Returns a decoding failure at the current position diagnosed by `d`.
   template<typename T>
   Result<T> fail(std::string const& d) const {
     return Result<T>::failure(DecoderError(position, d));
   }
 
+  /// Returns the result of `read`, which is a nullary function applying one of the unchecked
+  /// primitives, or the failure it caused.
+  template<typename T, typename F>
+  Result<T> checked(F&& read) {
+    auto r = read();
+    if (failure == DecoderFailure::none) { return Result<T>::success(r); }
+    auto e = DecoderError(failure_position, failure);
+    failure = DecoderFailure::none;
+    return Result<T>::failure(std::move(e));
+  }
+
+  /// Reads an instance of `T`, which denotes a fixed-width binary numeric, interpreting bytes
+  /// with `byte_order`.
+  template<typename T>
+  inline T read_numeric() {
+    if (((source.size() - position) < sizeof(T)) && !fill(sizeof(T))) [[unlikely]] {
+      record(DecoderFailure::not_enough_bytes);
+      return T{};
+    }
+
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, source.data() + position, sizeof(T));
+    if (byte_order != std::endian::native) {
+      std::reverse(std::begin(bytes), std::end(bytes));
+    }
+
+    position += sizeof(T);
+    T result;
+    std::memcpy(&result, bytes, sizeof(T));
+    return result;
+  }
+
+  /// Reads a signed integer in little endian base 128 that is encoded on more than one byte.
+  int64_t read_signed_leb128_slow();
+
+  /// Reads an unsigned integer in little endian base 128 that is encoded on more than one byte.
+  uint64_t read_unsigned_leb128_slow();
+
+  /// Makes sure that at least `n` bytes can be read from the current position, reading more bytes
+  /// from the stream if necessary, and returns `true` iff that is possible.
+  ///
+  /// - Precondition: `n` is not greater than the capacity of `window`.
+  bool fill(std::size_t n);
+
 public:
 
+  /// Creates an instance for decoding `source`, which is kept alive by `storage`.
+  Decoder(std::shared_ptr<void const> storage, std::span<const uint8_t> source);
+
   /// The order in which bytes are read.
   std::endian byte_order;
 
-  /// Creates an instance for decoding the contents of the file at `path`.
+  /// Creates an instance for decoding the contents of the file at `path`, which are copied in
+  /// memory.
   Decoder(std::string const& path);
 
+  /// Creates an instance for decoding the contents of the file at `path`, which are mapped in
+  /// memory rather than copied.
+  static Decoder mapping_contents_of(std::string const& path);
+
+  /// Creates an instance for decoding `bytes`, which are borrowed rather than copied.
+  ///
+  /// - Requires: `bytes` outlives the instance.
+  Decoder(std::span<const uint8_t> bytes);
+
+  /// Creates an instance for decoding `bytes`, which are owned by the instance.
+  Decoder(std::vector<uint8_t>&& bytes);
+
+  /// Creates an instance for decoding a stream whose bytes are read with `refill` into a sliding
+  /// window of `capacity` bytes.
+  ///
+  /// - Precondition: `capacity` is at least 64.
+  static Decoder streaming(Refill refill, std::size_t capacity = 1 << 16);
+
+  /// Creates an instance for decoding the bytes read from the file descriptor `fd`, which may
+  /// denote a pipe or any other non-seekable file, using a sliding window of `capacity` bytes.
+  ///
+  /// The descriptor is not closed when the instance is destroyed.
+  static Decoder streaming_contents_of(int fd, std::size_t capacity = 1 << 16);
+
+  /// Returns an instance decoding the same bytes from the current position, sharing rather than
+  /// copying them.
+  ///
+  /// Forks can be used concurrently with each other and with the decoder from which they were
+  /// created.
+  ///
+  /// - Precondition: the decoder does not read from a stream.
+  Decoder fork() const;
+
+  Decoder(Decoder const&) = delete;
+  Decoder(Decoder&&) = default;
+
+  Decoder& operator=(Decoder const&) = delete;
+  Decoder& operator=(Decoder&&) = default;
+
+  /// Returns `true` if the decoder reads from a stream.
+  inline bool is_streaming() const { return static_cast<bool>(refill); }
+
+  /// Returns the storage of the bytes from which data is being read, or `nullptr` if these bytes
+  /// are borrowed or read from a stream.
+  inline std::shared_ptr<void const> const& shared_contents() const { return storage; }
+
   /// Returns the number of bytes in the source from which data is being read.
-  inline std::size_t source_size() const { return source.size(); }
+  ///
+  /// If the decoder reads from a stream, the result is the number of bytes read so far.
+  inline std::size_t source_size() const { return window_offset + source.size(); }
 
   /// The current position of the decoder in its source.
-  inline std::size_t current_position() const { return position; }
+  inline std::size_t current_position() const { return window_offset + position; }
 
   /// Returns `true` if there is no more byte to read from the current position.
-  inline bool is_empty() const { return current_position() == source_size(); }
+  inline bool is_empty() { return (position == source.size()) && !fill(1); }
 
   /// Moves the decoder at `p`.
   ///
-  /// - Precondition: `p` is in the range [`0`, `source_size()`).
+  /// - Precondition: `p` is in the range [`0`, `source_size()`) and, if the decoder reads from a
+  ///   stream, the byte at `p` has not been discarded.
   inline void move_at(std::size_t p) {
-    precondition(p < source.size(), "position is out of bounds");
-    position = p;
+    precondition(
+      (p >= window_offset) && (p - window_offset < source.size()), "position is out of bounds");
+    position = p - window_offset;
   }
 
   /// Reads the next byte without consuming it.
   std::optional<int8_t> peek();
 
+  /// Returns `true` if the next byte is equal to `b`.
+  inline bool next_byte_is(uint8_t b) {
+    return ((position < source.size()) || fill(1)) && (source[position] == b);
+  }
+
+  // --- Unchecked primitives -------------------------------------------------
+  //
+  // These methods never throw. Instead, they record the first failure that occurs, return a zero
+  // value, and let the caller check for failures once it is done decoding a larger unit of data
+  // (e.g., a definition).
+
+  /// Records a failure of kind `f` at the current position, unless another failure has already
+  /// been recorded.
+  inline void record(DecoderFailure f) {
+    if (failure == DecoderFailure::none) {
+      failure = f;
+      failure_position = current_position();
+    }
+  }
+
+  /// Returns `true` if a failure has been recorded since the last time failures were checked.
+  inline bool has_failed() const { return failure != DecoderFailure::none; }
+
+  /// Throws an exception describing the first failure that has been recorded since the last time
+  /// failures were checked, if any.
+  inline void check() {
+    if (failure == DecoderFailure::none) [[likely]] { return; }
+    auto e = DecoderError(failure_position, failure);
+    failure = DecoderFailure::none;
+    throw e;
+  }
+
+  /// Reads the next byte as a 8-bit unsigned integer.
+  inline uint8_t read_u8() {
+    if ((position < source.size()) || fill(1)) [[likely]] { return source[position++]; }
+    record(DecoderFailure::not_enough_bytes);
+    return 0;
+  }
+
+  /// Reads the next byte as a 8-bit signed integer.
+  inline int8_t read_i8() { return static_cast<int8_t>(read_u8()); }
+
+  /// Reads a 32-bit unsigned integer.
+  inline uint32_t read_u32() { return read_numeric<uint32_t>(); }
+
+  /// Reads a 32-bit signed integer.
+  inline int32_t read_i32() { return read_numeric<int32_t>(); }
+
+  /// Reads a 32-bit floating-point number.
+  inline float read_f32() { return read_numeric<float>(); }
+
+  /// Reads a 64-bit floating-point number.
+  inline double read_f64() { return read_numeric<double>(); }
+
+  /// Reads a signed integer in little endian base 128.
+  inline int64_t read_signed_leb128() {
+    if (position < source.size()) [[likely]] {
+      auto b = source[position];
+      if (b < 0x80) {
+        ++position;
+        return (b & 0x40) ? static_cast<int64_t>(b) - 0x80 : static_cast<int64_t>(b);
+      }
+    }
+    return read_signed_leb128_slow();
+  }
+
+  /// Reads an unsigned integer in little endian base 128.
+  inline uint64_t read_unsigned_leb128() {
+    if (position < source.size()) [[likely]] {
+      auto b = source[position];
+      if (b < 0x80) {
+        ++position;
+        return b;
+      }
+    }
+    return read_unsigned_leb128_slow();
+  }
+
+  /// Reads `n` consecutive unsigned integers in little endian base 128, writes them to `o`, and
+  /// returns the number of values read.
+  ///
+  /// - Precondition: `o` must be a pointer to a buffer large enough to contain `n` elements.
+  std::size_t read_unsigned_leb128s(std::size_t n, uint64_t* o);
+
+  // --- Checked primitives ---------------------------------------------------
+
   /// Reads the next byte as a 8-bit unsigned integer.
   Result<uint8_t> u8();
 
@@ -102,6 +351,20 @@ public:
   /// - Precondition: `o` must be a pointer to a buffer large enough to contain `n` elements.
   std::size_t bytes(std::size_t n, int8_t* o);
 
+  /// Consumes up to `n` bytes and returns the number of consumed bytes.
+  std::size_t skip(std::size_t n);
+
+  /// Consumes `n` bytes and returns a view of them, or returns `std::nullopt` without consuming
+  /// anything if the decoder reads from a stream.
+  ///
+  /// The view is valid as long as the bytes of the source, which are kept alive by
+  /// `shared_contents()` unless they are borrowed. If there are fewer than `n` bytes left, a
+  /// failure is recorded and the result is empty.
+  std::optional<std::span<const uint8_t>> borrow(std::size_t n);
+
+  /// Consumes `n` consecutive integers in little endian base 128 without decoding them.
+  void skip_leb128s(std::size_t n);
+
 };
 
 } // nir
@@ -10,10 +10,17 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <vector>
 
+namespace nir {
+
+struct Serializer;
+
+} // nir
+
 namespace nir::definition {
 
 /// A trait describing the API of NIR definitions.
@@ -85,7 +92,7 @@ struct Method final {
   struct DebugInformation final {
 
     /// A map from a local to its name.
-    std::unordered_map<Local, std::string> local_name;
+    std::unordered_map<Local, std::string_view> local_name;
 
     /// TODO
     std::vector<LexicalScope> scopes;
@@ -193,6 +200,7 @@ struct Definition final {
 private:
 
   friend Positioned<Definition>;
+  friend Serializer;
 
   /// The internal representation of a definition.
   using Representation = std::variant<
@@ -228,6 +236,11 @@ public:
     return *this;
   }
 
+  /// Returns the name of the symbol being defined.
+  inline Symbol name() const {
+    return std::visit([](auto const& d) { return Symbol(d.name); }, wrapped);
+  }
+
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Definition const& rhs) const = default;
 
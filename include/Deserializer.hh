@@ -12,40 +12,178 @@
 #include "Operator.hh"
 #include "Scope.hh"
 #include "SourcePosition.hh"
+#include "StringPool.hh"
 #include "Symbol.hh"
 #include "Type.hh"
 #include "Tags.hh"
 #include "Value.hh"
+#include "Utilities/Assert.hh"
 
 #include <concepts>
 #include <cstdlib>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace nir {
 
+/// The entities of type `T` interned by a deserializer, in the order in which they were decoded.
+///
+/// The entries of a table outlive its size: a table can be truncated to the size it had before
+/// some part of a file was decoded, so that this part can be decoded again. In that case, the
+/// entities read again are not copied into the table; inserting them only increments its size.
+///
+/// Copies of a table share its entries, so that several deserializers can decode different parts
+/// of the same file concurrently once all its entities have been interned. Only one of the copies
+/// may insert entries past the end of the shared storage.
+///
+/// A table may also extend another one, whose entries it shares as its first entries without
+/// copying them (see `extended`). Any number of tables can extend the same one independently.
+template<typename T>
+struct InterningTable {
+private:
+
+  /// The entries of the table that this one extends, if any, which precede those in `entries`.
+  std::shared_ptr<std::vector<T> const> base;
+
+  /// The number of entries of `base` that are part of this table.
+  std::size_t base_size = 0;
+
+  /// The entries in the table past those of `base`, some of which may be past its size.
+  std::shared_ptr<std::vector<T>> entries = std::make_shared<std::vector<T>>();
+
+  /// The number of entries in the table, including those of `base`.
+  std::size_t count = 0;
+
+public:
+
+  /// Returns the number of entries in the table.
+  inline std::size_t size() const { return count; }
+
+  /// Returns the entry at index `i`.
+  ///
+  /// - Precondition: `i` is less than `size()`.
+  inline T const& operator[](std::size_t i) const {
+    return (i < base_size) ? (*base)[i] : (*entries)[i - base_size];
+  }
+
+  /// Inserts `e` at the end of the table.
+  inline void insert(T const& e) {
+    if (count - base_size == entries->size()) { entries->push_back(e); }
+    ++count;
+  }
+
+  /// Returns the entry that was at index `size()` before the table was last truncated, if any.
+  ///
+  /// If the result is not `nullptr`, it is the entry that the next insertion will insert again.
+  inline T const* truncated_entry() const {
+    auto i = count - base_size;
+    return (i < entries->size()) ? &(*entries)[i] : nullptr;
+  }
+
+  /// Removes the entries at indices greater than or equal to `n`, keeping them to be inserted
+  /// again.
+  ///
+  /// - Precondition: `n` is not greater than the number of entries that have been inserted, nor
+  ///   less than the number of entries of the table that this one extends.
+  inline void truncate(std::size_t n) {
+    precondition((n >= base_size) && (n - base_size <= entries->size()), "table is too short");
+    count = n;
+  }
+
+  /// Returns an empty table extending this one, whose first entries are those of this table.
+  ///
+  /// - Requires: this table doesn't extend another one and no entry is inserted in it afterward.
+  InterningTable extended() const {
+    precondition(base == nullptr, "table already extends another one");
+    InterningTable result;
+    result.base = entries;
+    result.base_size = count;
+    result.count = count;
+    return result;
+  }
+
+};
+
 /// The parsing of a file's serialized source.
 struct Deserializer {
 
+  /// The sizes of a deserializer's interning tables at some point during decoding.
+  struct Checkpoint {
+
+    /// The number of interned strings.
+    std::size_t strings;
+
+    /// The number of interned symbols.
+    std::size_t symbols;
+
+    /// The number of interned types.
+    std::size_t types;
+
+    /// The number of interned values.
+    std::size_t values;
+
+  };
+
   /// The source from which binary data is being read.
   Decoder& source;
 
+  /// The pool in which decoded strings are stored.
+  std::shared_ptr<StringPool> strings;
+
   /// The interned strings that have been decoded so far.
-  std::vector<std::string> interned_strings;
+  InterningTable<std::string_view> interned_strings;
 
   /// The interned symbols that have been decoded so far.
-  std::vector<Symbol> interned_symbols;
+  InterningTable<Symbol> interned_symbols;
 
   /// The interned types that have been decoded so far.
-  std::vector<Type> interned_types;
+  InterningTable<Type> interned_types;
 
   /// The interned values that have been decoded so far.
-  std::vector<Value> interned_values;
+  InterningTable<Value> interned_values;
 
-  /// Creates an instance decoding data from `source`.
-  Deserializer(Decoder& source) : source(source) {};
+  /// `true` if debug information is skipped rather than decoded.
+  ///
+  /// If this property is set, the debug information of methods is empty, source positions are
+  /// invalid, and scope identifiers denote the top-level scope. The strings that these entities
+  /// intern are still inserted in `interned_strings`.
+  bool strips_debug_information = false;
+
+  /// The path of the last concrete source file that has been decoded, along with its handle.
+  ///
+  /// Consecutive positions typically refer to the same file, whose path is then a view of the
+  /// same interned string. This cache spares a lookup in the source file table for these.
+  std::pair<std::string_view, SourceFile> last_source_file;
+
+  /// Creates an instance decoding data from `source`, storing decoded strings in `strings`.
+  ///
+  /// The strings and byte strings in the decoded IR are views of the contents of `strings` or of
+  /// the bytes of `source`, which must therefore outlive them. The latter are kept alive by
+  /// `source.shared_contents()` unless they are borrowed.
+  Deserializer(
+    Decoder& source, std::shared_ptr<StringPool> strings = std::make_shared<StringPool>()
+  ) : source(source), strings(std::move(strings)) {};
+
+  /// Creates an instance decoding data from `source` with the interning tables of `other`, whose
+  /// entries are shared rather than copied.
+  ///
+  /// The new instance is meant to decode parts of a file that `other` has already read, after its
+  /// tables have been restored to a checkpoint. Such an instance never writes to the string pool
+  /// and can therefore be used concurrently with other instances.
+  Deserializer(Decoder& source, Deserializer const& other) :
+    source(source),
+    strings(other.strings),
+    interned_strings(other.interned_strings),
+    interned_symbols(other.interned_symbols),
+    interned_types(other.interned_types),
+    interned_values(other.interned_values),
+    strips_debug_information(other.strips_debug_information)
+  {};
 
   Deserializer() = delete;
   Deserializer(Deserializer const&) = delete;
@@ -65,9 +203,30 @@ struct Deserializer {
   std::optional<T> optional(F&& decode);
 
   /// Reads an internable value of type `T`, reading or updating the memo as necessary.
+  ///
+  /// A back-reference returns a copy of an entry of `memo`, which is expected to be cheap: types
+  /// are handles to hash-consed nodes and values share their children. A back-reference to an
+  /// entry that hasn't been decoded records a failure in `source`.
   template<typename T, typename F>
   requires std::invocable<F, Deserializer&>
-  T internable(std::vector<T>& memo, F&& decode);
+  T internable(InterningTable<T>& memo, F&& decode);
+
+  /// Makes the interning tables of this instance extensions of those of `prelude`, so that the
+  /// data read afterward can refer to the entities that `prelude` has interned.
+  ///
+  /// The entries of the tables of `prelude` are shared rather than copied. Several instances can
+  /// extend the same prelude and be used concurrently.
+  ///
+  /// - Requires: no entity has been interned by this instance and `prelude` interns no entity
+  ///   afterward. The strings interned by `prelude` outlive the IR decoded by this instance.
+  void extend(Deserializer const& prelude);
+
+  /// Returns the current sizes of the interning tables.
+  Checkpoint checkpoint() const;
+
+  /// Truncates the interning tables to the sizes they had at `c`, so that the data that has been
+  /// decoded since then can be decoded again.
+  void restore(Checkpoint const& c);
 
   /// Reads a symbol (aka a "global").
   Symbol symbol();
@@ -75,45 +234,81 @@ struct Deserializer {
   /// Reads a symbol signature.
   Signature signature();
 
-  /// Reads a definition.
+  /// Reads a definition, throwing an exception if its encoding is ill-formed.
   Definition definition();
 
+  /// Reads a definition without checking whether decoding failed.
+  ///
+  /// Failures are recorded in `source` and should be checked after decoding.
+  Definition unchecked_definition();
+
+  /// Reads a definition without decoding the body of a method and returns its tag and name.
+  ///
+  /// The interning tables are updated as though the definition had been read entirely. Failures
+  /// are recorded in `source` and should be checked after decoding.
+  std::pair<tag::Definition, Symbol> skim_definition();
+
   /// Reads method debug information.
   definition::Method::DebugInformation debug();
 
   /// Reads a map from local identifier to its name.
-  std::unordered_map<Local, std::string> local_name();
+  std::unordered_map<Local, std::string_view> local_name();
 
   /// Reads a lexical scope.
   LexicalScope lexical_scope();
 
+  /// Skips method debug information.
+  void skip_debug();
+
   /// Reads an instruction.
   Instruction instruction();
 
+  /// Skips an instruction, interning the entities that it contains.
+  void skip_instruction();
+
   /// Reads a type.
   Type type();
 
   /// Reads a value.
   Value value();
 
+  /// Reads the element type and the elements of an array value.
+  ///
+  /// The elements of an array of numbers are decoded directly into a buffer of the corresponding
+  /// C++ type.
+  value::ArrayValue array_value();
+
+  /// Reads the elements of an array value of type `element_type`, which corresponds to `T`.
+  template<typename T>
+  value::ArrayValue numeric_array_value(Type const& element_type);
+
   /// Reads a label argument.
   value::Local label_argument();
 
   /// Reads a continuation.
   Next next();
 
+  /// Skips a continuation, interning the entities that it contains.
+  void skip_next();
+
   /// Reads a link-time condition.
   LinktimeCondition linktime_condition();
 
   /// Reads an operation.
   Operation operation();
 
+  /// Skips an operation, interning the entities that it contains.
+  void skip_operation();
+
   /// Reads a binary operator.
   BinaryOperator binary_operator();
 
   /// Reads a comparison operator.
   ComparisonOperator comparison_operator();
 
+  /// Reads a logical operator, which is encoded as the binary operator of the same name.
+  LogicalOperator logical_operator();
+
   /// Reads a conversion operator.
   ConversionOperator conversion_operator();
 
@@ -129,20 +324,35 @@ struct Deserializer {
   /// Reads a source position.
   SourcePosition source_position();
 
+  /// Skips a source position, interning the string that it contains.
+  void skip_source_position();
+
   /// Reads a scope identifier.
   ScopeIdentifier scope_identifier();
 
   /// Reads a string.
-  std::string string();
+  ///
+  /// The result is a view of the bytes of `source` or of a string in `strings`, which is stored
+  /// there only the first time it is decoded.
+  std::string_view string();
 
-  /// Reads a string written inline.
+  /// Skips a string, interning it if it is written inline.
+  void skip_string();
+
+  /// Reads a string written inline and returns a view of its concatenation to `prefix`.
+  ///
+  /// If `prefix` is empty and `source` does not read from a stream, the result is a view of the
+  /// bytes of `source`. Otherwise, the string is stored in `strings`.
   ///
   /// The lenght of the string is decoded first, as an unsigned LEB128, followed by its contents, as
   /// a buffer of UTF-8 code points.
-  std::string inline_string();
+  std::string_view inline_string(std::string_view prefix = std::string_view());
 
   /// Reads an array of bytes.
-  std::vector<value::Byte> bytes();
+  ///
+  /// The result is a view of the bytes of `source`, unless `source` reads from a stream, in which
+  /// case the bytes are stored in `strings`.
+  std::span<value::Byte const> bytes();
 
   /// Reads a Boolean.
   bool boolean();
@@ -152,6 +362,14 @@ struct Deserializer {
   /// The value is read as an unsigned LEB128 that's truncated to fit 32 bits.
   uint32_t uint32();
 
+  /// Reads a sequence of 32-bit unsigned integers.
+  ///
+  /// The elements are decoded in bulk; each of them is truncated as in `uint32`.
+  std::vector<uint32_t> uint32_sequence();
+
+  /// Skips a sequence of 32-bit unsigned integers.
+  void skip_uint32_sequence();
+
 };
 
 } // nir
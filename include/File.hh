@@ -11,15 +11,19 @@
 #include "Operator.hh"
 #include "Scope.hh"
 #include "SourcePosition.hh"
+#include "StringPool.hh"
 #include "Symbol.hh"
 #include "Type.hh"
 #include "Tags.hh"
 #include "Value.hh"
+#include "Utilities/Arena.hh"
 
 #include <any>
 #include <concepts>
 #include <cstdlib>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -27,6 +31,8 @@
 
 namespace nir {
 
+struct Deserializer;
+
 /// A value identifying serialized NIR files.
 ///
 /// The first 4 bytes of a serialized NIR file represent a 32-bit integer equal to this value,
@@ -45,13 +51,60 @@ struct Header {
   /// `true` if the file has entry pointers.
   const bool has_entry_points;
 
-  /// Parses an instance from `source`, throwing an exception if that fails.
+  /// Parses an instance from `source`, throwing an exception if that fails, and prepares `source`
+  /// to read the definitions that follow.
   static Header decode(Decoder& source);
 
 };
 
+/// The options of a file's decoding.
+struct DecodingOptions {
+
+  /// The number of threads decoding definitions concurrently, or `0` to use as many threads as
+  /// the host can run concurrently.
+  ///
+  /// If this number is greater than `1`, the contents of the file are first skimmed sequentially
+  /// to intern the entities that definitions refer to and find the boundaries of each definition.
+  /// The definitions are then decoded concurrently. The result is identical to that of a
+  /// sequential decoding.
+  std::size_t thread_count = 1;
+
+  /// `true` if the nodes of the IR are allocated in arenas owned by the decoded file rather than
+  /// individually on the heap.
+  ///
+  /// Arenas are faster to fill and release, but the nodes allocated in them must not outlive the
+  /// file; copies of a definition made without a current arena are allocated on the heap.
+  bool use_arena = false;
+
+  /// `true` if the debug information of methods, source positions, and scope identifiers are
+  /// skipped rather than decoded.
+  ///
+  /// The debug information of methods is then empty, source positions are invalid, and scope
+  /// identifiers denote the top-level scope.
+  bool strip_debug_information = false;
+
+};
+
 /// A NIR file.
+///
+/// The strings and byte strings in the definitions of a decoded file are views of the bytes from
+/// which the file was decoded or of the contents of a pool owned by the file. Hence, they must be
+/// copied if they should outlive the file.
 struct File {
+private:
+
+  /// The bytes from which the file was decoded, if they are owned by the file.
+  ///
+  /// This property is declared first so that the bytes are released last.
+  std::shared_ptr<void const> contents;
+
+  /// The pool in which the strings of the definitions that are not views of `contents` are stored,
+  /// if any.
+  std::shared_ptr<StringPool const> strings;
+
+  /// The arenas in which the nodes of the definitions are allocated, if any.
+  std::vector<std::unique_ptr<Arena>> arenas;
+
 public:
 
   /// The header of the file.
@@ -60,8 +113,116 @@ public:
   /// The definitions in the file.
   std::vector<Definition> definitions;
 
+  /// Creates an instance with the given properties, the strings of which are views of `contents`
+  /// or stored in `strings`, and the nodes of which are allocated in `arenas`.
+  File(
+    Header const& header, std::vector<Definition>&& definitions,
+    std::shared_ptr<StringPool const> strings = nullptr,
+    std::vector<std::unique_ptr<Arena>>&& arenas = {},
+    std::shared_ptr<void const> contents = nullptr
+  ) :
+    contents(std::move(contents)), strings(std::move(strings)), arenas(std::move(arenas)),
+    header(header), definitions(std::move(definitions))
+  {}
+
+  File(File const&) = delete;
+  File(File&&) = default;
+
+  File& operator=(File const&) = delete;
+  File& operator=(File&&) = delete;
+
   /// Creates an instance reading its contents from the file at `path`.
-  static File from_contents_of(std::string const& path);
+  static File from_contents_of(std::string const& path, DecodingOptions const& options = {});
+
+  /// Creates an instance reading its contents from `source`, which must not read from a stream.
+  ///
+  /// If `prelude` is not `nullptr`, the contents of `source` may refer to the entities that it has
+  /// interned, as though they had been read at the start of these contents (see
+  /// `Deserializer::extend`). `source.shared_contents()` should then keep the strings interned by
+  /// `prelude` alive.
+  static File from_decoder(
+    Decoder&& source, DecodingOptions const& options = {}, Deserializer const* prelude = nullptr);
+
+  /// Creates an instance reading its contents from `bytes`, which are borrowed rather than copied.
+  ///
+  /// - Requires: `bytes` outlives the instance, whose strings may be views of them.
+  static File from_bytes(std::span<const uint8_t> bytes, DecodingOptions const& options = {});
+
+  /// Creates an instance reading its contents from `bytes`, which are owned by the instance.
+  static File from_buffer(std::vector<uint8_t>&& bytes, DecodingOptions const& options = {});
+
+  /// Creates an instance reading its contents from the file descriptor `fd`, which may denote a
+  /// pipe or any other non-seekable file.
+  ///
+  /// The definitions are decoded sequentially as they are read; `options.thread_count` is ignored.
+  static File from_descriptor(int fd, DecodingOptions const& options = {});
+
+  /// Returns the encoding of this file in the binary format from which files are decoded.
+  ///
+  /// Decoding the result yields the header and the definitions of this file (see `Serializer`).
+  std::vector<uint8_t> serialized() const;
+
+};
+
+/// The incremental decoding of the definitions in a NIR file.
+///
+/// Definitions are decoded one at a time, on demand, so that a file read from a stream can be
+/// processed without holding all its contents in memory. Note that the memory used to decode a
+/// file still grows with the number of strings, symbols, types, and values that it interns.
+struct DefinitionStream {
+private:
+
+  /// The arena in which the nodes of the decoded definitions are allocated, if any.
+  ///
+  /// This property is declared first so that the arena is released after the values interned by
+  /// `deserializer`, which may be allocated in it.
+  std::unique_ptr<Arena> arena;
+
+  /// The source from which definitions are decoded.
+  std::unique_ptr<Decoder> source;
+
+  /// The deserializer reading definitions from `source`.
+  std::unique_ptr<Deserializer> deserializer;
+
+public:
+
+  /// The header of the file.
+  Header header;
+
+  /// Creates an instance decoding the contents of `source` with the given options, reading the
+  /// file's header eagerly.
+  ///
+  /// Definitions are decoded one at a time; `options.thread_count` is ignored. If
+  /// `options.use_arena` is `true`, the nodes of the decoded definitions are allocated in an arena
+  /// owned by the instance and must not outlive it, unless that arena is taken by `take_arena()`.
+  DefinitionStream(Decoder&& source, DecodingOptions const& options = {});
+
+  /// Creates an instance decoding the bytes read from the file descriptor `fd`, which may denote a
+  /// pipe or any other non-seekable file, with the given options.
+  static DefinitionStream from_descriptor(int fd, DecodingOptions const& options = {});
+
+  DefinitionStream(DefinitionStream const&) = delete;
+  DefinitionStream(DefinitionStream&&);
+
+  DefinitionStream& operator=(DefinitionStream const&) = delete;
+  DefinitionStream& operator=(DefinitionStream&&) = delete;
+
+  ~DefinitionStream();
+
+  /// Returns the pool in which the strings of the decoded definitions are stored.
+  ///
+  /// The strings of a definition returned by `next()` are views of the contents of this pool,
+  /// which is kept alive as long as the stream or the result of this method.
+  std::shared_ptr<StringPool const> strings() const;
+
+  /// Returns the arena in which the nodes of the decoded definitions are allocated, if any, and
+  /// transfers its ownership to the caller.
+  ///
+  /// - Requires: no definition is read from this instance after the call.
+  std::unique_ptr<Arena> take_arena();
+
+  /// Returns the next definition in the file, or `std::nullopt` if all definitions have been read.
+  std::optional<Definition> next();
 
 };
 
@@ -16,6 +16,8 @@
 namespace nir {
 
 struct Instruction;
+struct MethodBody;
+struct Serializer;
 
 } // nir
 
@@ -196,6 +198,8 @@ struct Instruction final {
 private:
 
   friend Positioned<Instruction>;
+  friend MethodBody;
+  friend Serializer;
 
   /// The internal representation of an instruction.
   using Representation = std::variant<
@@ -0,0 +1,113 @@
+#ifndef NIRC_LEB128_H
+#define NIRC_LEB128_H
+
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NIRC_HAS_X86_KERNELS 1
+#endif
+
+namespace nir::leb128 {
+
+/// The number of bytes that must be readable after the first byte of a LEB128 for it to be
+/// decoded by the functions of this module.
+///
+/// Decoders load whole words (or vectors) at a time and may read past the end of the value being
+/// decoded, but never past this slack.
+inline constexpr std::size_t slack = 32;
+
+/// Returns the 8 bytes at `p` as a little-endian word.
+inline uint64_t load_word(const uint8_t* p) {
+  uint64_t w;
+  std::memcpy(&w, p, sizeof(w));
+  if constexpr (std::endian::native == std::endian::big) {
+    w = __builtin_bswap64(w);
+  }
+  return w;
+}
+
+/// Returns the concatenation of the 7-bit payloads of the first `n` bytes of `w`.
+///
+/// - Precondition: `n` is in the range [1, 8].
+inline uint64_t compress_payloads(uint64_t w, std::size_t n) {
+  if (n < 8) { w &= (uint64_t{1} << (8 * n)) - 1; }
+  w &= 0x7f7f7f7f7f7f7f7f;
+  w = ((w & 0x7f007f007f007f00) >> 1) | (w & 0x007f007f007f007f);
+  w = ((w & 0x3fff00003fff0000) >> 2) | (w & 0x00003fff00003fff);
+  w = ((w & 0x0fffffff00000000) >> 4) | (w & 0x000000000fffffff);
+  return w;
+}
+
+/// Returns the number of bytes of the LEB128 at the start of `w` if it is encoded on at most 8
+/// bytes, or `0` otherwise.
+inline std::size_t encoded_size(uint64_t w) {
+  auto terminators = ~w & 0x8080808080808080;
+  return (terminators == 0) ? 0 : (std::countr_zero(terminators) + 1) / 8;
+}
+
+/// Decodes the unsigned LEB128 at `p` into `value` if it is encoded on at most 8 bytes and returns
+/// its size. Otherwise, returns `0`.
+///
+/// - Precondition: there are at least 8 readable bytes at `p`.
+inline std::size_t decode_short_unsigned(const uint8_t* p, uint64_t& value) {
+  auto w = load_word(p);
+  auto n = encoded_size(w);
+  if (n != 0) { value = compress_payloads(w, n); }
+  return n;
+}
+
+/// Decodes the signed LEB128 at `p` into `value` if it is encoded on at most 8 bytes and returns
+/// its size. Otherwise, returns `0`.
+///
+/// - Precondition: there are at least 8 readable bytes at `p`.
+inline std::size_t decode_short_signed(const uint8_t* p, int64_t& value) {
+  auto w = load_word(p);
+  auto n = encoded_size(w);
+  if (n != 0) {
+    auto s = 64 - 7 * static_cast<unsigned>(n);
+    value = static_cast<int64_t>(compress_payloads(w, n) << s) >> s;
+  }
+  return n;
+}
+
+/// Decodes up to `n` consecutive unsigned LEB128s starting at `p`, writes them to `o`, advances
+/// `p` past the decoded values, and returns how many were decoded.
+///
+/// Decoding stops early before a value encoded on more than 8 bytes, and may stop before any value
+/// starting less than `slack` bytes before `end`, so that the caller can decode it with a checked
+/// decoder. No byte at or past `end` is read.
+///
+/// This function dispatches to an implementation using the widest vector instructions supported
+/// by the host, which is selected once, at runtime.
+std::size_t decode_unsigned(const uint8_t*& p, const uint8_t* end, std::size_t n, uint64_t* o);
+
+/// Decodes up to `n` unsigned LEB128s one word at a time.
+///
+/// This function behaves as `decode_unsigned` on every host.
+std::size_t decode_unsigned_scalar(
+  const uint8_t*& p, const uint8_t* end, std::size_t n, uint64_t* o);
+
+#ifdef NIRC_HAS_X86_KERNELS
+
+/// Decodes up to `n` unsigned LEB128s, using a 16-byte continuation mask to widen runs of
+/// single-byte values and to size longer ones without scanning their bytes.
+///
+/// This function behaves as `decode_unsigned` on hosts supporting SSE2.
+std::size_t decode_unsigned_sse2(
+  const uint8_t*& p, const uint8_t* end, std::size_t n, uint64_t* o);
+
+/// Decodes up to `n` unsigned LEB128s, using a 32-byte continuation mask to widen runs of
+/// single-byte values and to size longer ones without scanning their bytes.
+///
+/// - Requires: the host supports AVX2.
+std::size_t decode_unsigned_avx2(
+  const uint8_t*& p, const uint8_t* end, std::size_t n, uint64_t* o);
+
+#endif
+
+} // nir::leb128
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef NIRC_LAZY_FILE_H
+#define NIRC_LAZY_FILE_H
+
+#include "Decoder.hh"
+#include "Definition.hh"
+#include "Deserializer.hh"
+#include "File.hh"
+#include "Symbol.hh"
+#include "Tags.hh"
+
+#include <cstdlib>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nir {
+
+/// A NIR file whose definitions are decoded on demand.
+///
+/// The contents of the file are skimmed when the instance is created to build an index of its
+/// definitions, along with the tables of the entities that it interns. Method bodies are not
+/// materialized during this pass; a definition is decoded only the first time it is accessed,
+/// by re-reading its bytes. The strings of the decoded definitions are views of these bytes or of a
+/// pool owned by the instance.
+struct LazyFile {
+public:
+
+  /// The information stored in the index of a file for each of its definitions.
+  struct Entry {
+
+    /// The kind of the definition.
+    tag::Definition tag;
+
+    /// The name of the definition.
+    Symbol name;
+
+    /// The offset of the definition's first byte in the file.
+    std::size_t start;
+
+    /// The offset past the definition's last byte in the file.
+    std::size_t end;
+
+  };
+
+private:
+
+  /// The source from which definitions are decoded.
+  std::unique_ptr<Decoder> source;
+
+  /// The deserializer reading definitions from `source`.
+  std::unique_ptr<Deserializer> deserializer;
+
+  /// The definitions in the file, in the order in which they occur.
+  std::vector<Entry> _entries;
+
+  /// The sizes of the deserializer's interning tables before each definition was read.
+  std::vector<Deserializer::Checkpoint> checkpoints;
+
+  /// The definitions that have been decoded so far, at the same indices as `_entries`.
+  std::vector<std::unique_ptr<Definition>> decoded;
+
+  /// A map from the name of a definition to its index in `_entries`.
+  std::unordered_map<Symbol, std::size_t> index;
+
+public:
+
+  /// The header of the file.
+  Header header;
+
+  /// Creates an instance decoding the contents of `source`, which must not read from a stream.
+  ///
+  /// If `prelude` is not `nullptr`, the contents of `source` may refer to the entities that it has
+  /// interned (see `File::from_decoder`).
+  LazyFile(Decoder&& source, Deserializer const* prelude = nullptr);
+
+  /// Creates an instance reading its contents from the file at `path`.
+  static LazyFile from_contents_of(std::string const& path);
+
+  /// Creates an instance reading its contents from `bytes`, which are borrowed rather than copied.
+  static LazyFile from_bytes(std::span<const uint8_t> bytes);
+
+  LazyFile(LazyFile const&) = delete;
+  LazyFile(LazyFile&&);
+
+  LazyFile& operator=(LazyFile const&) = delete;
+  LazyFile& operator=(LazyFile&&) = delete;
+
+  ~LazyFile();
+
+  /// Returns the index of the definitions in the file, in the order in which they occur.
+  inline std::vector<Entry> const& entries() const { return _entries; }
+
+  /// Returns the number of definitions in the file.
+  inline std::size_t size() const { return _entries.size(); }
+
+  /// Returns `true` if the file defines `name`.
+  inline bool contains(Symbol const& name) const { return index.contains(name); }
+
+  /// Returns the definition at index `i`, decoding it if it hasn't been accessed yet.
+  ///
+  /// - Precondition: `i` is less than `size()`.
+  Definition const& at(std::size_t i);
+
+  /// Returns the definition of `name`, decoding it if it hasn't been accessed yet, or `nullptr` if
+  /// the file does not define `name`.
+  Definition const* definition(Symbol const& name);
+
+};
+
+} // nir
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef NIRC_LAZY_WORKSPACE_H
+#define NIRC_LAZY_WORKSPACE_H
+
+#include "Definition.hh"
+#include "LazyFile.hh"
+#include "Symbol.hh"
+#include "SymbolFilter.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace nir {
+
+/// A collection of NIR files whose definitions are decoded on demand.
+///
+/// Each file is summarized by a filter of the top-level symbols that it defines, so that looking
+/// up a definition only skims the files that may define it (see `LazyFile`). The filters are built
+/// by skimming every file the first time a workspace is opened and can be stored in a table next to
+/// the files, from which they are read the next times.
+///
+/// The table records the size, modification time, and a hash of the contents of each file along
+/// with its filter. A filter is reused as is if the size and modification time of its file are
+/// unchanged. Otherwise, the file is read and its filter is reused only if the hash of its
+/// contents is unchanged, so that touching a file doesn't cause it to be skimmed again. Since a
+/// file may also be replaced by a copy that preserves its size and modification time, the filters
+/// reused as is are checked against the contents of their files before a lookup reports that no
+/// file defines a symbol; a stale filter then never hides a definition.
+///
+/// The table starts with the characters "NIRFLTR" and a null byte, followed by the version of its
+/// format and the number of files. Each file is then described by the size of its path and the
+/// number of words in its filter, its size, modification time, and hash, the characters of its
+/// path, and the words of its filter. All integers are written in little-endian.
+///
+/// A lazy workspace is not thread-safe.
+struct LazyWorkspace {
+public:
+
+  /// Counters describing the lookups made in a workspace.
+  struct Statistics {
+
+    /// The number of lookups.
+    std::size_t query_count = 0;
+
+    /// The number of files that were not skimmed because their filter excluded the symbol being
+    /// looked up.
+    std::size_t skipped_count = 0;
+
+    /// The number of files whose filter admitted the symbol being looked up.
+    std::size_t candidate_count = 0;
+
+    /// The number of candidates that did not define the symbol being looked up, either because of
+    /// a false positive of their filter or because they define the top-level symbol of a member
+    /// but not the member itself.
+    std::size_t miss_count = 0;
+
+    /// The number of misses caused by a false positive of a filter, i.e., of candidates that did
+    /// not define the top-level symbol of the symbol being looked up.
+    ///
+    /// The false positive rate of the filters is the ratio of this number to the sum of itself and
+    /// `skipped_count`.
+    std::size_t false_positive_count = 0;
+
+  };
+
+  /// The state of a file from which a filter was built.
+  struct FileState {
+
+    /// The size of the file in bytes.
+    uint64_t size;
+
+    /// The modification time of the file, in ticks of the clock of the file system.
+    int64_t time;
+
+    /// A hash of the contents of the file.
+    uint64_t hash;
+
+  };
+
+private:
+
+  /// The paths of the files in the workspace, in lexicographic order.
+  std::vector<std::filesystem::path> _paths;
+
+  /// The filters of the files, at the same indices as `_paths`.
+  std::vector<SymbolFilter> filters;
+
+  /// The files that have been skimmed so far, at the same indices as `_paths`.
+  std::vector<std::unique_ptr<LazyFile>> files;
+
+  /// The state of the files from which the filters were built, at the same indices as `_paths`.
+  std::vector<FileState> states;
+
+  /// `true` for the files whose filter was built or checked against their contents by this
+  /// instance, at the same indices as `_paths`.
+  std::vector<bool> checked;
+
+  /// The counters describing the lookups made so far.
+  Statistics _statistics;
+
+  /// The number of filters that were read from a table rather than built.
+  std::size_t _reused_filter_count;
+
+  /// The number of threads on which files are read.
+  std::size_t thread_count;
+
+  /// Creates an instance with the given properties.
+  LazyWorkspace(
+    std::vector<std::filesystem::path>&& paths, std::vector<SymbolFilter>&& filters,
+    std::vector<FileState>&& states, std::vector<bool>&& checked, std::size_t reused_filter_count,
+    std::size_t thread_count);
+
+  /// Returns the `i`-th file, skimming it if it hasn't been accessed yet.
+  LazyFile& file(std::size_t i);
+
+  /// Returns the definition of `name`, whose hash is `h`, in the `i`-th file if its filter admits
+  /// it, or `nullptr` otherwise.
+  Definition const* definition(std::size_t i, Symbol const& name, uint64_t h);
+
+  /// Checks the filters that haven't been checked yet against the contents of their files,
+  /// rebuilding the ones that are stale, and returns the indices of the latter.
+  std::vector<std::size_t> check_filters();
+
+public:
+
+  /// Creates an instance with the contents of `roots`, enumerated as they are by
+  /// `Workspace::load`, reusing the filters stored in the table at `table`, if any.
+  ///
+  /// The filters of the files that aren't described by the table, or whose contents changed, are
+  /// built by skimming these files on `thread_count` threads, or on as many threads as the host can
+  /// run concurrently if `thread_count` is `0`. The table is then rewritten if it is out of date. A
+  /// table that doesn't exist or isn't valid is treated as an empty one. An exception is thrown if
+  /// a file can't be read or decoded, or if the table can't be written.
+  static LazyWorkspace open(
+    std::vector<std::filesystem::path> const& roots,
+    std::optional<std::filesystem::path> const& table = std::nullopt,
+    std::size_t thread_count = 0);
+
+  LazyWorkspace(LazyWorkspace const&) = delete;
+  LazyWorkspace(LazyWorkspace&&);
+
+  LazyWorkspace& operator=(LazyWorkspace const&) = delete;
+  LazyWorkspace& operator=(LazyWorkspace&&) = delete;
+
+  ~LazyWorkspace();
+
+  /// Returns the number of files in the workspace.
+  inline std::size_t size() const { return _paths.size(); }
+
+  /// Returns the paths of the files in the workspace, in lexicographic order.
+  inline std::vector<std::filesystem::path> const& paths() const { return _paths; }
+
+  /// Returns the number of filters that were read from a table rather than built.
+  inline std::size_t reused_filter_count() const { return _reused_filter_count; }
+
+  /// Returns the counters describing the lookups made so far.
+  inline Statistics const& statistics() const { return _statistics; }
+
+  /// Returns the definition of `name`, decoding it if it hasn't been accessed yet, or `nullptr` if
+  /// no file defines `name`.
+  ///
+  /// If several files define `name`, the result is in the first of them. The filters that haven't
+  /// been checked against the contents of their files yet are checked before `nullptr` is
+  /// returned. An exception is thrown if a file must be read and can't be.
+  Definition const* definition(Symbol const& name);
+
+  /// Writes the filters of the files to `table`.
+  ///
+  /// An exception is thrown if the table can't be written.
+  void save_filters(std::filesystem::path const& table) const;
+
+};
+
+} // nir
+
+#endif
@@ -2,6 +2,7 @@
 #define NIRC_LINKTIME_CONDITION_H
 
 #include "Operator.hh"
+#include "SourcePosition.hh"
 #include "Value.hh"
 #include "Utilities/Indirect.hh"
 
@@ -11,6 +12,7 @@
 namespace nir {
 
 struct LinktimeCondition;
+struct Serializer;
 
 } // nir
 
@@ -28,6 +30,9 @@ struct SimpleCondition final {
   /// The operator of the predicate.
   ComparisonOperator relation;
 
+  /// The source position to which this condition corresponds.
+  SourcePosition position;
+
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(SimpleCondition const& rhs) const = default;
 
@@ -45,6 +50,9 @@ struct ComplexCondition final {
   /// The operator of the condition.
   LogicalOperator relation;
 
+  /// The source position to which this condition corresponds.
+  SourcePosition position;
+
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(ComplexCondition const& rhs) const = default;
 
@@ -58,6 +66,8 @@ namespace nir {
 struct LinktimeCondition {
 private:
 
+  friend Serializer;
+
   /// The internal representation of a linktime condition.
   using Representation = std::variant<
     linktime::SimpleCondition,
@@ -0,0 +1,58 @@
+#ifndef NIRC_MAPPED_FILE_H
+#define NIRC_MAPPED_FILE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace nir {
+
+/// The read-only contents of a file mapped in memory.
+///
+/// The contents are mapped with `mmap` on platforms that support it, with hints requesting the
+/// pages to be prefaulted and read sequentially. On other platforms, the contents are copied into
+/// a buffer owned by the instance.
+struct MappedFile {
+private:
+
+  /// The address of the mapping, or `nullptr` if the file is empty or has been copied.
+  void* base;
+
+  /// The number of bytes in the mapping.
+  std::size_t size;
+
+  /// The contents of the file if it could not be mapped.
+  std::vector<uint8_t> fallback;
+
+public:
+
+  /// Maps the contents of the file at `path`.
+  ///
+  /// An exception is thrown if the file could not be opened or mapped.
+  MappedFile(std::string const& path);
+
+  MappedFile() = delete;
+  MappedFile(MappedFile const&) = delete;
+  MappedFile(MappedFile&&) = delete;
+
+  MappedFile& operator=(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+
+  ~MappedFile();
+
+  /// Returns the contents of the file.
+  inline std::span<const uint8_t> contents() const {
+    if (base != nullptr) {
+      return { static_cast<const uint8_t*>(base), size };
+    } else {
+      return { fallback.data(), fallback.size() };
+    }
+  }
+
+};
+
+} // nir
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef NIRC_METHOD_BODY_H
+#define NIRC_METHOD_BODY_H
+
+#include "Instruction.hh"
+#include "LinktimeCondition.hh"
+#include "Local.hh"
+#include "Scope.hh"
+#include "Signature.hh"
+#include "SourcePosition.hh"
+#include "Type.hh"
+#include "Value.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace nir {
+
+/// The body of a method, flattened into parallel arrays indexed by instruction.
+///
+/// This representation is an alternative to a sequence of `Instruction`s meant for analyses that
+/// traverse every instruction of a method, which then read dense arrays of small elements rather
+/// than chasing the nested variants of each instruction. Values are stored once in a constant
+/// pool and referred to by their index in this pool.
+///
+/// The properties of the `i`-th instruction are:
+/// - its opcode, which identifies the kind of the instruction or, for a `Let`, of its operation;
+/// - the local that it defines, if it is a `Label` or a `Let`;
+/// - its types, the first of which is the type of its result (`unit` unless it is a `Let`),
+///   followed by the types that the instruction or its operation mentions, in declaration order;
+/// - its operands, which are the indices of the values that it mentions, in declaration order,
+///   omitting optional values that are not defined;
+/// - its immediates, which are the other fields of its operation, in declaration order, encoded as
+///   integers (see `Opcode`);
+/// - its successors, in declaration order;
+/// - its source position and its scope.
+struct MethodBody {
+public:
+
+  /// The kind of an instruction or, for a `Let`, of its operation.
+  ///
+  /// The immediates of an instruction depend on its opcode:
+  /// - symbols are encoded as their raw values;
+  /// - operators are encoded as their raw values;
+  /// - optional memory orders are encoded as `0` if they are not defined, or as their raw values
+  ///   plus one otherwise;
+  /// - paths, counts and positions in arrays are encoded as is;
+  /// - signatures are encoded as indices in `signature_pool()`;
+  /// - link-time conditions are encoded as indices in `condition_pool()`;
+  /// - the presence of an optional zone is encoded as `1`, and its absence as `0`.
+  enum struct Opcode : uint8_t {
+
+    label, return_, jump, if_, switch_, throw_, unreachable, linktime_jump,
+
+    call, load, store, element, extract, insert, stack_allocate, binary_apply, compare, convert,
+    fence, class_allocate, field_load, field_store, field, method, dynamic_method, module, as, is,
+    copy, size_of, alignment_of, box, unbox, var, var_load, var_store, array_allocate, array_load,
+    array_store, array_length
+
+  };
+
+  /// The flattened form of a continuation.
+  struct Successor {
+
+    /// The kind of a continuation.
+    enum struct Kind : uint8_t { none, unwind, case_, label };
+
+    /// The outermost kind of the continuation.
+    Kind kind;
+
+    /// The label to which the continuation jumps, or `no_target` if it does not jump to a label.
+    Local target;
+
+    /// The index of the first argument of the continuation in the arguments of the body.
+    ///
+    /// The arguments of a continuation are the exception of an `Unwind` or the value of a `Case`,
+    /// if any, followed by the arguments passed to its label.
+    uint32_t first_argument;
+
+    /// The number of arguments of the continuation.
+    uint32_t argument_count;
+
+    /// The target of continuations that do not jump to a label.
+    static constexpr Local no_target = std::numeric_limits<Local>::max();
+
+  };
+
+  /// The result of instructions that define no local.
+  static constexpr Local no_result = std::numeric_limits<Local>::max();
+
+private:
+
+  /// The opcode of each instruction.
+  std::vector<Opcode> opcodes;
+
+  /// The local defined by each instruction, or `no_result` if the instruction defines no local.
+  std::vector<Local> results;
+
+  /// The source position of each instruction.
+  std::vector<SourcePosition> positions;
+
+  /// The scope of each instruction, which is the top-level scope unless the instruction is a `Let`.
+  std::vector<ScopeIdentifier> scopes;
+
+  /// The types of all instructions, in order.
+  std::vector<Type> types;
+
+  /// The index in `types` of the first type of each instruction, followed by `types.size()`.
+  std::vector<uint32_t> type_starts;
+
+  /// The operands of all instructions, in order.
+  std::vector<uint32_t> operands;
+
+  /// The index in `operands` of the first operand of each instruction, followed by
+  /// `operands.size()`.
+  std::vector<uint32_t> operand_starts;
+
+  /// The immediates of all instructions, in order.
+  std::vector<uint64_t> immediates;
+
+  /// The index in `immediates` of the first immediate of each instruction, followed by
+  /// `immediates.size()`.
+  std::vector<uint32_t> immediate_starts;
+
+  /// The successors of all instructions, in order.
+  std::vector<Successor> successors;
+
+  /// The index in `successors` of the first successor of each instruction, followed by
+  /// `successors.size()`.
+  std::vector<uint32_t> successor_starts;
+
+  /// The arguments of all successors, as indices in `constants`.
+  std::vector<uint32_t> arguments;
+
+  /// The values mentioned in the body.
+  std::vector<Value> constants;
+
+  /// The signatures mentioned in the body.
+  std::vector<Signature> signatures;
+
+  /// The link-time conditions mentioned in the body.
+  std::vector<LinktimeCondition> conditions;
+
+  /// A map from a local to the index of its occurrence in `constants`, used during construction.
+  using LocalConstants = std::unordered_map<Local, uint32_t>;
+
+  /// Appends the flattened form of `i`, using `locals` to deduplicate locals.
+  void append(Instruction const& i, LocalConstants& locals);
+
+  /// Appends the flattened form of the `Let` instruction `i`, using `locals` to deduplicate locals.
+  void append(instruction::Let const& i, LocalConstants& locals);
+
+  /// Stores `v` in the constant pool, unless it is a local already stored there according to
+  /// `locals`, and returns its index.
+  uint32_t constant(Value const& v, LocalConstants& locals);
+
+  /// Appends `v` to the operands of the last instruction.
+  inline void push_operand(Value const& v, LocalConstants& locals) {
+    operands.push_back(constant(v, locals));
+  }
+
+  /// Appends `t` to the types of the last instruction.
+  inline void push_type(Type const& t) { types.push_back(t); }
+
+  /// Appends `n` to the immediates of the last instruction.
+  inline void push_immediate(uint64_t n) { immediates.push_back(n); }
+
+  /// Appends `n` to the successors of the last instruction.
+  void push_successor(Next const& n, LocalConstants& locals);
+
+  /// Returns the subrange of `elements` assigned to the `i`-th instruction by `starts`.
+  template<typename T>
+  inline static std::span<T const> slice(
+    std::vector<T> const& elements, std::vector<uint32_t> const& starts, std::size_t i
+  ) {
+    return std::span<T const>(elements.data() + starts[i], starts[i + 1] - starts[i]);
+  }
+
+public:
+
+  /// Creates an instance representing `instructions`.
+  MethodBody(std::vector<Instruction> const& instructions);
+
+  /// Returns the number of instructions in the body.
+  inline std::size_t size() const { return opcodes.size(); }
+
+  /// Returns the opcode of the `i`-th instruction.
+  inline Opcode opcode(std::size_t i) const { return opcodes[i]; }
+
+  /// Returns the local defined by the `i`-th instruction, or `no_result` if it defines no local.
+  inline Local result(std::size_t i) const { return results[i]; }
+
+  /// Returns the type of the result of the `i`-th instruction.
+  inline Type const& result_type(std::size_t i) const { return types[type_starts[i]]; }
+
+  /// Returns the source position of the `i`-th instruction.
+  inline SourcePosition const& position(std::size_t i) const { return positions[i]; }
+
+  /// Returns the scope of the `i`-th instruction.
+  inline ScopeIdentifier scope(std::size_t i) const { return scopes[i]; }
+
+  /// Returns the types mentioned by the `i`-th instruction, after the type of its result.
+  inline std::span<Type const> type_operands(std::size_t i) const {
+    return slice(types, type_starts, i).subspan(1);
+  }
+
+  /// Returns the indices in `constant_pool()` of the operands of the `i`-th instruction.
+  inline std::span<uint32_t const> operands_of(std::size_t i) const {
+    return slice(operands, operand_starts, i);
+  }
+
+  /// Returns the immediates of the `i`-th instruction.
+  inline std::span<uint64_t const> immediates_of(std::size_t i) const {
+    return slice(immediates, immediate_starts, i);
+  }
+
+  /// Returns the successors of the `i`-th instruction.
+  inline std::span<Successor const> successors_of(std::size_t i) const {
+    return slice(successors, successor_starts, i);
+  }
+
+  /// Returns the indices in `constant_pool()` of the arguments of `s`.
+  inline std::span<uint32_t const> arguments_of(Successor const& s) const {
+    return std::span<uint32_t const>(arguments.data() + s.first_argument, s.argument_count);
+  }
+
+  /// Returns the values mentioned in the body.
+  inline std::vector<Value> const& constant_pool() const { return constants; }
+
+  /// Returns the signatures mentioned in the body.
+  inline std::vector<Signature> const& signature_pool() const { return signatures; }
+
+  /// Returns the link-time conditions mentioned in the body.
+  inline std::vector<LinktimeCondition> const& condition_pool() const { return conditions; }
+
+};
+
+} // nir
+
+#endif
@@ -10,6 +10,8 @@
 namespace nir {
 
 struct Next;
+struct MethodBody;
+struct Serializer;
 
 } // nir
 
@@ -67,6 +69,9 @@ namespace nir {
 struct Next final {
 private:
 
+  friend MethodBody;
+  friend Serializer;
+
   /// The internal representation of a continuation.
   using Representation = std::variant<
     next::None,
@@ -13,6 +13,13 @@
 #include <optional>
 #include <variant>
 
+namespace nir {
+
+struct MethodBody;
+struct Serializer;
+
+} // nir
+
 namespace nir::operation {
 
 /// A function call.
@@ -28,7 +35,7 @@ struct Call final  {
   std::vector<Value> arguments;
 
   /// Returns the type of this operation's result.
-  inline Type result_type() const { return *callee_type.return_value; }
+  inline Type result_type() const { return callee_type.return_value; }
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Call const& rhs) const = default;
@@ -444,7 +451,7 @@ struct Box final {
 
   /// Returns the type of this operation's result.
   inline Type result_type() const {
-    auto t = box_type.as<type::Reference>().value();
+    [[maybe_unused]] auto t = box_type.as<type::Reference>().value();
     auto is_nullable = box_type.is_pointer_box();
     return Type(type::Reference(box_type.class_name(), true, is_nullable));
   }
@@ -490,7 +497,7 @@ struct VarLoad final {
   Value slot;
 
   /// Returns the type of this operation's result.
-  inline Type result_type() const { return *(slot.type().as<type::Var>().value().type); }
+  inline Type result_type() const { return slot.type().as<type::Var>().value().type; }
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(VarLoad const& rhs) const = default;
@@ -598,6 +605,9 @@ namespace nir {
 struct Operation {
 private:
 
+  friend MethodBody;
+  friend Serializer;
+
   /// The internal representation of an operation.
   using Representation = std::variant<
     operation::Call,
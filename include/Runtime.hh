@@ -7,44 +7,62 @@
 namespace nir::runtime {
 
   /// `java.lang.Object`.
-  const type::Reference Object(symbol::Top("java.lang.Object"));
+  inline const Type Object = type::Reference(symbol::Top("java.lang.Object"));
 
   /// `java.lang.Class`.
-  const type::Reference Class(symbol::Top("java.lang.Class"));
+  inline const Type Class = type::Reference(symbol::Top("java.lang.Class"));
 
   /// `java.lang.String`.
-  const type::Reference String(symbol::Top("java.lang.String"));
+  inline const Type String = type::Reference(symbol::Top("java.lang.String"));
 
   /// The type of the runtime package.
-  const type::Reference Runtime(symbol::Top("scala.scalanative.runtime.package$"));
+  inline const Type Runtime = type::Reference(symbol::Top("scala.scalanative.runtime.package$"));
 
   /// The nothing type of Scala's runtime.
-  const type::Reference RuntimeNothing(symbol::Top("scala.runtime.Nothing$"));
+  inline const Type RuntimeNothing = type::Reference(symbol::Top("scala.runtime.Nothing$"));
 
   /// The null reference type of Scala's runtime.
-  const type::Reference RuntimeNull(symbol::Top("scala.runtime.Null$"));
+  inline const Type RuntimeNull = type::Reference(symbol::Top("scala.runtime.Null$"));
 
   /// The type of a boxed pointer.
-  const type::Reference BoxedPointer(symbol::Top("scala.scalanative.unsafe.Ptr"));
+  inline const Type BoxedPointer = type::Reference(symbol::Top("scala.scalanative.unsafe.Ptr"));
 
   /// The type of a boxed null reference.
-  const type::Reference BoxedNull(symbol::Top("scala.runtime.Null$"));
+  inline const Type BoxedNull = type::Reference(symbol::Top("scala.runtime.Null$"));
 
   /// The type of a boxed unit.
-  const type::Reference BoxedUnit(symbol::Top("scala.runtime.BoxedUnit"));
+  inline const Type BoxedUnit = type::Reference(symbol::Top("scala.runtime.BoxedUnit"));
 
   /// The type of a boxed unit module.
-  const type::Reference BoxedUnitModule(symbol::Top("scala.scalanative.runtime.BoxedUnit$"));
-
-  const type::Reference BooleanArray(symbol::Top("scala.scalanative.runtime.BooleanArray"));
-  const type::Reference CharArray(symbol::Top("scala.scalanative.runtime.CharArray"));
-  const type::Reference ByteArray(symbol::Top("scala.scalanative.runtime.ByteArray"));
-  const type::Reference ShortArray(symbol::Top("scala.scalanative.runtime.ShortArray"));
-  const type::Reference IntArray(symbol::Top("scala.scalanative.runtime.IntArray"));
-  const type::Reference LongArray(symbol::Top("scala.scalanative.runtime.LongArray"));
-  const type::Reference FloatArray(symbol::Top("scala.scalanative.runtime.FloatArray"));
-  const type::Reference DoubleArray(symbol::Top("scala.scalanative.runtime.DoubleArray"));
-  const type::Reference ObjectArray(symbol::Top("scala.scalanative.runtime.ObjectArray"));
+  inline const Type BoxedUnitModule =
+    type::Reference(symbol::Top("scala.scalanative.runtime.BoxedUnit$"));
+
+  inline const Type BooleanArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.BooleanArray"));
+
+  inline const Type CharArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.CharArray"));
+
+  inline const Type ByteArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.ByteArray"));
+
+  inline const Type ShortArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.ShortArray"));
+
+  inline const Type IntArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.IntArray"));
+
+  inline const Type LongArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.LongArray"));
+
+  inline const Type FloatArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.FloatArray"));
+
+  inline const Type DoubleArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.DoubleArray"));
+
+  inline const Type ObjectArray =
+    type::Reference(symbol::Top("scala.scalanative.runtime.ObjectArray"));
 
 } // nir::runtime
 
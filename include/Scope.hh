@@ -36,6 +36,9 @@ struct LexicalScope final {
   /// The source position corresponding to the scope.
   SourcePosition position;
 
+  /// Returns `true` if this instance is equal to `rhs`.
+  bool operator==(LexicalScope const& rhs) const = default;
+
 };
 
 }; // nir
@@ -0,0 +1,247 @@
+#ifndef NIRC_SERIALIZER_H
+#define NIRC_SERIALIZER_H
+
+#include "Attribute.hh"
+#include "Definition.hh"
+#include "File.hh"
+#include "Instruction.hh"
+#include "Local.hh"
+#include "MemoryOrder.hh"
+#include "Next.hh"
+#include "Operation.hh"
+#include "Operator.hh"
+#include "Scope.hh"
+#include "SourcePosition.hh"
+#include "StringPool.hh"
+#include "Symbol.hh"
+#include "Type.hh"
+#include "Value.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace nir {
+
+/// The encoding of NIR entities in the binary format read by `Deserializer`.
+///
+/// A serializer interns entities the same way a deserializer does, so that its tables always
+/// match those of a deserializer reading its output. A symbol, type, or value whose inline
+/// encoding is longer than 2 bytes is interned the first time it is written and encoded as a
+/// back-reference to its index in the corresponding table afterward. A string written inline is
+/// interned as well; later strings that are prefixes of an interned string are encoded as views of
+/// that string, and other strings are encoded as the extension of the longest prefix that they
+/// share with an interned string when that is shorter than writing them entirely.
+///
+/// The encoding of an entity only depends on that entity and on the entities written before it.
+/// Hence, decoding the output of a serializer yields entities equal to its inputs, and encoding
+/// these entities again yields the same bytes. The bytes of a file written by another encoder are
+/// not necessarily reproduced, since that encoder may make different interning decisions.
+struct Serializer {
+private:
+
+  /// An equivalence relation on values that holds iff two values have the same encoding, along
+  /// with a hash function consistent with that relation.
+  ///
+  /// Unlike `Value::operator==`, this relation distinguishes zeros of different types and
+  /// floating-point numbers with different bit patterns.
+  struct ValueIdentity {
+
+    /// Returns a hash of `v`.
+    std::size_t operator()(Value const& v) const;
+
+    /// Returns `true` iff `a` and `b` are identical.
+    bool operator()(Value const& a, Value const& b) const;
+
+  };
+
+public:
+
+  /// The buffer to which encoded data is appended.
+  std::vector<uint8_t>& target;
+
+  /// The pool storing copies of the strings in `interned_strings`.
+  StringPool strings;
+
+  /// The strings that have been interned so far, in the order in which they were written.
+  std::vector<std::string_view> interned_strings;
+
+  /// A node of the radix tree of interned strings, denoting the concatenation of the labels on the
+  /// path from the root to that node.
+  struct PrefixNode {
+
+    /// The characters on the edge from the node's parent to the node.
+    std::string_view label;
+
+    /// The index in `interned_strings` of a string starting with the characters that the node
+    /// denotes.
+    uint32_t string;
+
+  };
+
+  /// The nodes of the radix tree of interned strings, the first of which is the root.
+  ///
+  /// The tree is used to find the longest prefix shared by a string and any interned string,
+  /// walking one edge per distinct branch rather than comparing strings. Labels are views of the
+  /// contents of `strings`.
+  std::vector<PrefixNode> prefix_nodes = {PrefixNode{std::string_view(), 0}};
+
+  /// A map from a node of the radix tree and the first character of one of its children's labels,
+  /// packed as `(n << 8) | c`, to that child.
+  std::unordered_map<uint64_t, uint32_t> prefix_edges;
+
+  /// A map from each interned symbol to its index in the interning table of symbols.
+  std::unordered_map<Symbol, std::size_t> interned_symbols;
+
+  /// A map from each interned type to its index in the interning table of types.
+  std::unordered_map<Type, std::size_t> interned_types;
+
+  /// A map from each interned value to its index in the interning table of values.
+  std::unordered_map<Value, std::size_t, ValueIdentity, ValueIdentity> interned_values;
+
+  /// Creates an instance appending encoded data to `target`.
+  Serializer(std::vector<uint8_t>& target) : target(target) {};
+
+  /// Creates an instance appending encoded data to `target`, whose interning tables are initially
+  /// copies of those of `prelude`.
+  ///
+  /// The output of the new instance can be decoded by a deserializer extending one that has read
+  /// the output of `prelude` (see `Deserializer::extend`).
+  ///
+  /// - Requires: `prelude` outlives the instance, since the interned strings of the latter may be
+  ///   views of the contents of `prelude.strings`.
+  Serializer(std::vector<uint8_t>& target, Serializer const& prelude) :
+    target(target),
+    interned_strings(prelude.interned_strings),
+    prefix_nodes(prelude.prefix_nodes),
+    prefix_edges(prelude.prefix_edges),
+    interned_symbols(prelude.interned_symbols),
+    interned_types(prelude.interned_types),
+    interned_values(prelude.interned_values)
+  {};
+
+  Serializer() = delete;
+  Serializer(Serializer const&) = delete;
+  Serializer(Serializer&& other) = delete;
+
+  Serializer& operator=(Serializer const&) = delete;
+  Serializer& operator=(Serializer&&) = delete;
+
+  /// Writes the header of a file and prepares to write the definitions that follow.
+  void header(Header const& h);
+
+  /// Writes the contents of `elements`, applying `encode` to write each of them.
+  template<typename C, typename F>
+  void sequence(C const& elements, F&& encode);
+
+  /// Writes an optional value of type `T`, applying `encode` to write it if it is defined.
+  template<typename T, typename F>
+  void optional(std::optional<T> const& v, F&& encode);
+
+  /// Writes an internable value of type `T`, reading or updating the memo as necessary.
+  template<typename T, typename M, typename F>
+  void internable(M& memo, T const& v, F&& encode);
+
+  /// Writes a symbol (aka a "global").
+  void symbol(Symbol const& s);
+
+  /// Writes a symbol signature.
+  void signature(Signature const& s);
+
+  /// Writes a definition.
+  void definition(Definition const& d);
+
+  /// Writes method debug information.
+  void debug(definition::Method::DebugInformation const& d);
+
+  /// Writes a map from local identifier to its name, in the order of the locals.
+  void local_name(std::unordered_map<Local, std::string_view> const& m);
+
+  /// Writes a lexical scope.
+  void lexical_scope(LexicalScope const& s);
+
+  /// Writes an instruction.
+  void instruction(Instruction const& i);
+
+  /// Writes a type.
+  ///
+  /// - Requires: `t` is not a numeric type other than those of Scala's primitives.
+  void type(Type const& t);
+
+  /// Writes a value.
+  void value(Value const& v);
+
+  /// Writes the element type and the elements of an array value.
+  void array_value(value::ArrayValue const& v);
+
+  /// Writes a continuation.
+  void next(Next const& n);
+
+  /// Writes a link-time condition.
+  void linktime_condition(LinktimeCondition const& c);
+
+  /// Writes an operation.
+  ///
+  /// - Requires: the ordering of a load or a store is defined.
+  void operation(Operation const& o);
+
+  /// Writes a binary operator.
+  void binary_operator(BinaryOperator o);
+
+  /// Writes a comparison operator.
+  void comparison_operator(ComparisonOperator o);
+
+  /// Writes a logical operator, which is encoded as the binary operator of the same name.
+  void logical_operator(LogicalOperator o);
+
+  /// Writes a conversion operator.
+  void conversion_operator(ConversionOperator o);
+
+  /// Writes a memory order.
+  void memory_order(MemoryOrder o);
+
+  /// Writes a local.
+  void local(Local l);
+
+  /// Writes an attribute.
+  void attribute(Attribute const& a);
+
+  /// Writes a source position.
+  void source_position(SourcePosition const& p);
+
+  /// Writes a scope identifier.
+  void scope_identifier(ScopeIdentifier const& s);
+
+  /// Writes a string, interning it if it is written inline.
+  void string(std::string_view s);
+
+  /// Writes an array of bytes.
+  void bytes(std::span<value::Byte const> bs);
+
+  /// Writes a Boolean.
+  void boolean(bool b);
+
+  /// Writes a 32-bit unsigned integer.
+  void uint32(uint32_t v);
+
+  /// Writes a sequence of 32-bit unsigned integers.
+  void uint32_sequence(std::span<uint32_t const> vs);
+
+  /// Writes a byte.
+  void u8(uint8_t v);
+
+  /// Writes `v` as an unsigned LEB128.
+  void unsigned_leb128(uint64_t v);
+
+  /// Writes `v` as a signed LEB128.
+  void signed_leb128(int64_t v);
+
+};
+
+} // nir
+
+#endif
@@ -1,7 +1,8 @@
 #ifndef NIRC_SIGNATURE_H
 #define NIRC_SIGNATURE_H
 
-#include <string>
+#include <ostream>
+#include <string_view>
 
 namespace nir {
 
@@ -11,7 +12,10 @@ struct Signature {
   friend std::ostream& operator<<(std::ostream&, const Signature&);
 
   /// The mangled name of the signature.
-  std::string mangled_name;
+  ///
+  /// The characters of the name are stored in the symbol table if the signature is part of a
+  /// symbol, or in the string pool of the file from which it was decoded.
+  std::string_view mangled_name;
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Signature const& rhs) const = default;
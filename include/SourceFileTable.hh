@@ -0,0 +1,81 @@
+#ifndef NIRC_SOURCE_FILE_TABLE_H
+#define NIRC_SOURCE_FILE_TABLE_H
+
+#include "StringPool.hh"
+#include "Utilities/StableVector.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace nir {
+
+/// The table in which the paths of all concrete source files are interned.
+///
+/// Each distinct path is stored exactly once and identified by a dense 32-bit index, which is the
+/// representation of `SourceFile`. Paths can be read without locking. Since a workspace refers to
+/// few source files compared to symbols, the table is protected by a single lock.
+///
+/// Like `SymbolTable`, the table is shared by the whole process rather than owned by a workspace,
+/// so that a position can read its path without a reference to the workspace it comes from. Paths
+/// are never removed: every distinct path decoded during the life of the process stays in memory,
+/// along with less than 100 bytes of bookkeeping. That cost grows with the number of source files
+/// rather than with the number of positions, and is small next to that of the symbols that the
+/// same files define, which are retained the same way.
+struct SourceFileTable {
+public:
+
+  /// The information stored for a source file.
+  struct Entry {
+
+    /// The path of the file, whose characters are stored in the table.
+    std::string_view path;
+
+    /// A hash of `path`.
+    std::size_t hash;
+
+  };
+
+private:
+
+  /// The lock protecting `paths` and `indices`.
+  std::mutex lock;
+
+  /// The storage of the paths interned in the table.
+  StringPool paths;
+
+  /// A map from the path of a file to its index.
+  std::unordered_map<std::string_view, uint32_t> indices;
+
+  /// The files in the table.
+  StableVector<Entry> entries;
+
+public:
+
+  SourceFileTable() = default;
+
+  SourceFileTable(SourceFileTable const&) = delete;
+  SourceFileTable(SourceFileTable&&) = delete;
+
+  SourceFileTable& operator=(SourceFileTable const&) = delete;
+  SourceFileTable& operator=(SourceFileTable&&) = delete;
+
+  /// Returns the table in which all source files are interned.
+  static SourceFileTable& global();
+
+  /// Returns the index of the file at `path`, interning it if necessary.
+  uint32_t intern(std::string_view path);
+
+  /// Returns the file at index `i`.
+  inline Entry const& operator[](uint32_t i) const { return entries[i]; }
+
+  /// Returns the number of files in the table.
+  inline std::size_t size() const { return entries.size(); }
+
+};
+
+} // nir
+
+#endif
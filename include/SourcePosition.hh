@@ -1,11 +1,18 @@
 #ifndef NIRC_SOURCE_POSITION_H
 #define NIRC_SOURCE_POSITION_H
 
-#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <string_view>
 
 namespace nir {
 
 /// A Scala source file.
+///
+/// An instance is a 32-bit handle to an entry of the global `SourceFileTable` if the file is
+/// concrete. Hence, source files are cheap to copy and compare.
 struct SourceFile {
 public:
 
@@ -25,22 +32,30 @@ public:
 
 private:
 
-  /// The kind of the file.
-  Kind _kind;
+  friend std::hash<SourceFile>;
 
-  /// The path of the file if `_kind` is `Kind::concrete`.
-  std::string path;
+  /// The raw representation of this instance.
+  ///
+  /// The value is `0` if the file is virtual, or the index of its path in the global source file
+  /// table plus one otherwise.
+  uint32_t raw;
 
 public:
 
   /// Creates a virtual source file.
-  SourceFile() : _kind(Kind::virtual_) {}
+  SourceFile() : raw(0) {}
 
   /// Creates a concrete source file identified by its path relative to the workspace.
-  SourceFile(std::string const& path) : _kind(Kind::concrete), path(path) {}
+  SourceFile(std::string_view path);
 
   /// Returns the kind of this file.
-  inline Kind kind() const { return _kind; }
+  inline Kind kind() const { return (raw == 0) ? Kind::virtual_ : Kind::concrete; }
+
+  /// Returns the path of this file if it is concrete, or an empty string otherwise.
+  std::string_view path() const;
+
+  /// Returns the raw representation of this instance.
+  inline uint32_t raw_value() const { return raw; }
 
   /// Returns `true` if this instance is equal to `rhs`:
   bool operator==(SourceFile const& rhs) const = default;
@@ -58,19 +73,19 @@ struct SourcePosition {
   // NirSource nir_source;
 
   /// The 0-based line number of this position in its source.
-  std::size_t line_index;
+  uint32_t line_index;
 
   /// The zero-based colun number of this position in its source.
-  std::size_t column_index;
+  uint32_t column_index;
 
   /// Returns `true` if this position is invalid.
   inline bool is_invalid() const { return *this == SourcePosition::invalid(); }
 
   /// Returns the 1-based line number of this position in its source.
-  inline std::size_t line_number() const { return line_index + 1; }
+  inline std::size_t line_number() const { return std::size_t{line_index} + 1; }
 
   /// Returns the 1-based column number of this position in its source.
-  inline std::size_t column_number() const { return column_index + 1; }
+  inline std::size_t column_number() const { return std::size_t{column_index} + 1; }
 
   /// Returns the comparison of this instance with `rhs`;
   bool operator==(SourcePosition const& rhs) const = default;
@@ -79,8 +94,8 @@ struct SourcePosition {
   inline static SourcePosition invalid() {
     return {
       SourceFile(),
-      std::numeric_limits<std::size_t>::max(),
-      std::numeric_limits<std::size_t>::max()
+      std::numeric_limits<uint32_t>::max(),
+      std::numeric_limits<uint32_t>::max()
     };
   }
 
@@ -88,5 +103,24 @@ struct SourcePosition {
 
 } // nir
 
+namespace std {
+
+template<>
+struct hash<nir::SourceFile> {
+
+  /// Returns a hash of `self`'s salient properties.
+  size_t operator()(nir::SourceFile const& self) const;
+
+};
+
+template<>
+struct hash<nir::SourcePosition> {
+
+  /// Returns a hash of `self`'s salient properties.
+  size_t operator()(nir::SourcePosition const& self) const;
+
+};
+
+} // std
 
 #endif
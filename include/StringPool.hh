@@ -0,0 +1,73 @@
+#ifndef NIRC_STRING_POOL_H
+#define NIRC_STRING_POOL_H
+
+#include "Utilities/Arena.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string_view>
+
+namespace nir {
+
+/// A collection of strings whose contents are stored contiguously and never moved.
+///
+/// The strings in a pool are referred to by views that remain valid as long as the pool. A pool
+/// is not thread-safe, but its strings can be read concurrently once they have been inserted.
+struct StringPool {
+private:
+
+  /// The storage of the strings in the pool.
+  Arena storage;
+
+public:
+
+  StringPool() = default;
+
+  StringPool(StringPool const&) = delete;
+  StringPool(StringPool&&) = delete;
+
+  StringPool& operator=(StringPool const&) = delete;
+  StringPool& operator=(StringPool&&) = delete;
+
+  /// Returns the address of `n` uninitialized characters stored in the pool.
+  inline char* allocate(std::size_t n) {
+    return (n == 0) ? nullptr : static_cast<char*>(storage.allocate(n, 1));
+  }
+
+  /// Returns the address of `prefix.size() + n` characters stored in the pool, the first of which
+  /// are equal to `prefix` and the last `n` of which are uninitialized.
+  ///
+  /// The characters of `prefix` are shared rather than copied if `prefix` ends where the last
+  /// string stored in the pool ends. `std::bad_alloc` is thrown if the size of the result can't
+  /// be represented.
+  inline char* allocate(std::string_view prefix, std::size_t n) {
+    if (prefix.empty()) {
+      return allocate(n);
+    } else if (storage.extend(prefix.data() + prefix.size(), n)) {
+      return const_cast<char*>(prefix.data());
+    } else if (n > std::numeric_limits<std::size_t>::max() - prefix.size()) {
+      throw std::bad_alloc();
+    } else {
+      auto p = allocate(prefix.size() + n);
+      std::memcpy(p, prefix.data(), prefix.size());
+      return p;
+    }
+  }
+
+  /// Returns a view of a copy of `s` stored in the pool.
+  inline std::string_view insert(std::string_view s) {
+    auto p = allocate(s.size());
+    if (p != nullptr) { std::memcpy(p, s.data(), s.size()); }
+    return std::string_view(p, s.size());
+  }
+
+  /// Returns the number of characters stored in the pool.
+  inline std::size_t size() const { return storage.allocated_bytes(); }
+
+};
+
+} // nir
+
+#endif
@@ -3,9 +3,19 @@
 
 #include "Signature.hh"
 
+#include <cstdint>
+#include <cstdlib>
 #include <memory>
 #include <optional>
-#include <variant>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace nir {
+
+  struct Symbol;
+
+} // nir
 
 namespace nir::symbol {
 
@@ -18,36 +28,76 @@ struct None final {
 };
 
 /// A top-level symbol.
+///
+/// An instance is the index of its identifier in the global `SymbolTable`.
 struct Top final {
+private:
 
   friend std::ostream& operator<<(std::ostream&, const Top&);
+  friend std::hash<Top>;
+  friend Symbol;
 
-  /// The identifier of the symbol.
-  std::string id;
+  /// The index of the symbol in the global symbol table.
+  uint32_t raw;
+
+  /// Creates an instance with its raw value.
+  explicit Top(uint32_t raw, std::nullptr_t) : raw(raw) {}
+
+public:
+
+  /// Creates an instance with the given identifier.
+  Top(std::string_view id);
 
   /// Creates an instance with the given identifier.
-  Top(std::string const& id) : id(id) {}
+  Top(std::string const& id) : Top(std::string_view(id)) {}
 
   /// Creates an instance with the given identifier.
-  Top(const char* id) : id(id) {}
+  Top(const char* id) : Top(std::string_view(id)) {}
 
   Top() = delete;
 
+  /// Returns the identifier of the symbol.
+  std::string_view id() const;
+
+  /// Returns the index of the symbol in the global symbol table.
+  inline uint32_t raw_value() const { return raw; }
+
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Top const& rhs) const = default;
 
 };
 
 /// A member of some top-level symbol having its own signature.
+///
+/// An instance is the index of its owner and signature in the global `SymbolTable`.
 struct Member final {
+private:
 
   friend std::ostream& operator<<(std::ostream&, const Member&);
+  friend std::hash<Member>;
+  friend Symbol;
 
-  /// The owner of this symbol.
-  Top top;
+  /// The index of the symbol in the global symbol table.
+  uint32_t raw;
 
-  /// The signature of this symbol.
-  Signature signature;
+  /// Creates an instance with its raw value.
+  explicit Member(uint32_t raw, std::nullptr_t) : raw(raw) {}
+
+public:
+
+  /// Creates an instance representing the member of `top` having `signature`.
+  Member(Top top, Signature const& signature);
+
+  Member() = delete;
+
+  /// Returns the owner of this symbol.
+  Top top() const;
+
+  /// Returns the signature of this symbol.
+  Signature const& signature() const;
+
+  /// Returns the index of the symbol in the global symbol table.
+  inline uint32_t raw_value() const { return raw; }
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Member const& rhs) const = default;
@@ -59,51 +109,74 @@ struct Member final {
 namespace nir {
 
 /// The identifier of a type or method (aka a global).
+///
+/// An instance is represented by 32 bits: `0` denotes the none symbol, other values with the most
+/// significant bit unset denote top-level symbols, and values with that bit set denote members.
 struct Symbol final {
 private:
 
   friend std::hash<Symbol>;
   friend std::ostream& operator<<(std::ostream&, const Symbol&);
 
-  /// The internal representation of a symbol.
-  using Representation = std::variant<symbol::None, symbol::Top, symbol::Member>;
+  /// The bit set in the raw value of member symbols.
+  static constexpr uint32_t member_bit = uint32_t{1} << 31;
 
-  /// The wrapped value.
-  Representation wrapped;
+  /// The raw value of this instance.
+  uint32_t raw;
 
 public:
 
   /// Creates an instance wrapping `w`.
-  template<typename T>
-  Symbol(T const& w) : wrapped(w) {}
+  Symbol(symbol::None const&) : raw(0) {}
 
-  Symbol(Symbol const& other) : wrapped(other.wrapped) {}
+  /// Creates an instance wrapping `w`.
+  Symbol(symbol::Top const& w) : raw(w.raw + 1) {}
+
+  /// Creates an instance wrapping `w`.
+  Symbol(symbol::Member const& w) : raw(w.raw | member_bit) {}
+
+  Symbol(Symbol const& other) = default;
 
-  Symbol(Symbol&& other) : wrapped(std::move(other.wrapped)) {}
+  Symbol(Symbol&& other) = default;
 
   Symbol() = delete;
 
-  ~Symbol() noexcept {}
+  ~Symbol() noexcept = default;
 
-  Symbol& operator=(Symbol const& other) { return *this = Symbol(other); };
+  Symbol& operator=(Symbol const& other) = default;
 
-  Symbol& operator=(Symbol&& other) {
-    std::swap(wrapped, other.wrapped);
-    return *this;
-  }
+  Symbol& operator=(Symbol&& other) = default;
 
   /// Returns `true` if `this` wraps an instance of `T`.
   template<typename T>
   inline bool is() const {
-    return std::holds_alternative<T>(wrapped);
+    if constexpr (std::is_same_v<T, symbol::None>) {
+      return raw == 0;
+    } else if constexpr (std::is_same_v<T, symbol::Top>) {
+      return (raw != 0) && !(raw & member_bit);
+    } else {
+      static_assert(std::is_same_v<T, symbol::Member>);
+      return (raw & member_bit);
+    }
   }
 
   /// Projects `this` as an instance of `T` or returns `std::nullopt` if it's diffent kind of type.
   template<typename T>
   inline std::optional<T> as() const {
-    return is<T>() ? std::optional(std::get<T>(wrapped)) : std::nullopt;
+    if (!is<T>()) {
+      return std::nullopt;
+    } else if constexpr (std::is_same_v<T, symbol::None>) {
+      return symbol::None{};
+    } else if constexpr (std::is_same_v<T, symbol::Top>) {
+      return symbol::Top(raw - 1, nullptr);
+    } else {
+      return symbol::Member(raw & ~member_bit, nullptr);
+    }
   }
 
+  /// Returns the raw value of this instance, which identifies it uniquely in the process.
+  inline uint32_t raw_value() const { return raw; }
+
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(Symbol const& rhs) const = default;
 
@@ -144,5 +217,4 @@ struct hash<nir::Symbol> {
 
 } // std
 
-
 #endif
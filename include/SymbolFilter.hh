@@ -0,0 +1,63 @@
+#ifndef NIRC_SYMBOL_FILTER_H
+#define NIRC_SYMBOL_FILTER_H
+
+#include "Symbol.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace nir {
+
+/// A Bloom filter of the identifiers of top-level symbols.
+///
+/// A filter answers whether a symbol may be defined in the set it summarizes: it never reports a
+/// symbol that was inserted as absent, but may report a symbol that wasn't inserted as present.
+/// The rate of these false positives is about 1% with the default of 10 bits per identifier.
+///
+/// Identifiers are hashed with a function that doesn't depend on the process, so that filters can
+/// be stored and reused across runs.
+struct SymbolFilter {
+private:
+
+  /// The bits of the filter.
+  std::vector<uint64_t> _words;
+
+public:
+
+  /// The number of bits set for each identifier.
+  static constexpr std::size_t probe_count = 7;
+
+  /// Creates an empty instance sized to hold `count` identifiers with `bits_per_identifier` bits
+  /// each.
+  explicit SymbolFilter(std::size_t count, std::size_t bits_per_identifier = 10);
+
+  /// Creates an instance with the given bits.
+  ///
+  /// - Precondition: `words` is not empty.
+  explicit SymbolFilter(std::vector<uint64_t>&& words);
+
+  /// Returns the hash of `id` with which it is inserted in or looked up from a filter.
+  static uint64_t hash(std::string_view id);
+
+  /// Returns the hash of the top-level symbol of `name`, or `std::nullopt` if `name` is the none
+  /// symbol.
+  static std::optional<uint64_t> hash(Symbol const& name);
+
+  /// Returns the bits of the filter.
+  inline std::span<uint64_t const> words() const { return _words; }
+
+  /// Inserts the identifier whose hash is `h`.
+  void insert(uint64_t h);
+
+  /// Returns `false` if the identifier whose hash is `h` was definitely not inserted.
+  bool may_contain(uint64_t h) const;
+
+};
+
+} // nir
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef NIRC_SYMBOL_INDEX_H
+#define NIRC_SYMBOL_INDEX_H
+
+#include "Symbol.hh"
+#include "Workspace.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+namespace nir {
+
+/// An immutable map from the symbols defined in a workspace to the locations of their definitions.
+///
+/// The index is a minimal perfect hash table keyed by the raw values of symbols, which identify
+/// them uniquely in the global symbol table: a lookup never hashes or compares strings. Keys are
+/// split into partitions of a few thousand symbols, whose tables are built independently on
+/// different threads with the "hash and displace" method. The keys of a partition are grouped in
+/// small buckets and each bucket is assigned a pilot such that its keys hash to distinct free slots
+/// when combined with that pilot. A lookup reads the description of one partition, the pilot of one
+/// bucket, and the slot to which it leads, then compares the key in that slot with the symbol.
+///
+/// The index doesn't reference the workspace from which it was built.
+struct SymbolIndex {
+public:
+
+  /// The location of a definition in a workspace.
+  struct Location {
+
+    /// The index of the file containing the definition.
+    uint32_t file;
+
+    /// The index of the definition in its file.
+    uint32_t definition;
+
+  };
+
+private:
+
+  /// The keys of a partition and the way they are assigned to slots.
+  struct Partition {
+
+    /// The index of the first slot of the partition.
+    uint32_t offset;
+
+    /// The number of keys in the partition.
+    uint32_t size;
+
+    /// The index of the pilot of the partition's first bucket.
+    uint32_t bucket_offset;
+
+    /// The number of buckets in the partition.
+    uint32_t bucket_count;
+
+    /// A value combined with the pilots of the partition's buckets.
+    uint32_t seed;
+
+  };
+
+  /// A key of the index and its value.
+  struct Slot {
+
+    /// The raw value of the symbol.
+    uint32_t key;
+
+    /// The location of the symbol's definition.
+    Location location;
+
+  };
+
+  /// The partitions of the index.
+  std::vector<Partition> partitions;
+
+  /// The pilots of every bucket.
+  std::vector<uint32_t> pilots;
+
+  /// The keys of the index and their values.
+  std::vector<Slot> slots;
+
+  /// Creates an empty instance.
+  SymbolIndex() = default;
+
+public:
+
+  /// Creates an instance indexing the definitions of `workspace`, built on `thread_count` threads
+  /// or on as many threads as the host can run concurrently if `thread_count` is `0`.
+  ///
+  /// If several definitions have the same name, the index refers to the first of them in the
+  /// order of `Workspace::for_each_definition`.
+  static SymbolIndex build(Workspace const& workspace, std::size_t thread_count = 0);
+
+  SymbolIndex(SymbolIndex const&) = delete;
+  SymbolIndex(SymbolIndex&&) = default;
+
+  SymbolIndex& operator=(SymbolIndex const&) = delete;
+  SymbolIndex& operator=(SymbolIndex&&) = default;
+
+  /// Returns the number of symbols in the index.
+  inline std::size_t size() const { return slots.size(); }
+
+  /// Returns the location of the definition of `name`, or `std::nullopt` if `name` isn't defined.
+  std::optional<Location> find(Symbol const& name) const;
+
+};
+
+} // nir
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef NIRC_SYMBOL_TABLE_H
+#define NIRC_SYMBOL_TABLE_H
+
+#include "Signature.hh"
+#include "StringPool.hh"
+#include "Symbol.hh"
+#include "Utilities/StableVector.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace nir {
+
+/// The table in which the names of all top-level and member symbols are interned.
+///
+/// Each distinct name is stored exactly once and identified by a dense 32-bit index, which is the
+/// representation of `symbol::Top` and `symbol::Member`. Names can be read without locking; they
+/// are interned in shards that are protected by different locks to reduce contention.
+struct SymbolTable {
+public:
+
+  /// The information stored for a top-level symbol.
+  struct TopEntry {
+
+    /// The identifier of the symbol, whose characters are stored in the table.
+    std::string_view id;
+
+    /// A hash of `id`.
+    std::size_t hash;
+
+  };
+
+  /// The information stored for a member symbol.
+  struct MemberEntry {
+
+    /// The owner of the symbol.
+    symbol::Top top;
+
+    /// The signature of the symbol, whose characters are stored in the table.
+    Signature signature;
+
+    /// A hash of `top` and `signature`.
+    std::size_t hash;
+
+  };
+
+private:
+
+  /// The number of shards in the table.
+  static constexpr std::size_t shard_count = 16;
+
+  /// A hash function for the keys identifying member symbols.
+  struct MemberKeyHash {
+
+    std::size_t operator()(std::pair<uint32_t, std::string_view> const& k) const {
+      return std::hash<std::string_view>{}(k.second) ^ (std::size_t{k.first} * 0x9e3779b97f4a7c15);
+    }
+
+  };
+
+  /// A part of a symbol table.
+  struct Shard {
+
+    /// The lock protecting this shard.
+    std::mutex lock;
+
+    /// The storage of the names interned in this shard.
+    StringPool names;
+
+    /// A map from the identifier of a top-level symbol to its index.
+    std::unordered_map<std::string_view, uint32_t> tops;
+
+    /// A map from the owner and signature of a member symbol to its index.
+    std::unordered_map<std::pair<uint32_t, std::string_view>, uint32_t, MemberKeyHash> members;
+
+  };
+
+  /// The shards of the table.
+  Shard shards[shard_count];
+
+  /// The top-level symbols in the table.
+  StableVector<TopEntry> top_entries;
+
+  /// The member symbols in the table.
+  StableVector<MemberEntry> member_entries;
+
+public:
+
+  SymbolTable() = default;
+
+  SymbolTable(SymbolTable const&) = delete;
+  SymbolTable(SymbolTable&&) = delete;
+
+  SymbolTable& operator=(SymbolTable const&) = delete;
+  SymbolTable& operator=(SymbolTable&&) = delete;
+
+  /// Returns the table in which all symbols are interned.
+  static SymbolTable& global();
+
+  /// Returns the index of the top-level symbol identified by `id`, interning it if necessary.
+  uint32_t intern_top(std::string_view id);
+
+  /// Returns the index of the member of `top` having `signature`, interning it if necessary.
+  uint32_t intern_member(symbol::Top top, std::string_view signature);
+
+  /// Returns the top-level symbol at index `i`.
+  inline TopEntry const& top(uint32_t i) const { return top_entries[i]; }
+
+  /// Returns the member symbol at index `i`.
+  inline MemberEntry const& member(uint32_t i) const { return member_entries[i]; }
+
+  /// Returns the number of top-level symbols in the table.
+  inline std::size_t top_count() const { return top_entries.size(); }
+
+  /// Returns the number of member symbols in the table.
+  inline std::size_t member_count() const { return member_entries.size(); }
+
+};
+
+} // nir
+
+#endif
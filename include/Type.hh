@@ -3,21 +3,31 @@
 
 #include "Symbol.hh"
 #include "Tags.hh"
-#include "Utilities/Indirect.hh"
 
 #include <algorithm>
 #include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <ranges>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
 namespace nir {
 
   struct Type;
+  struct TypeContext;
 
 } // nir
 
+namespace nir::type {
+
+  struct Node;
+
+} // nir::type
+
 namespace nir::type {
 
 /// A predefined type symbol.
@@ -83,13 +93,159 @@ public:
 
 };
 
+} // nir::type
+
+namespace nir {
+
+/// The type of a NIR entity.
+///
+/// An instance is a handle to a node in the global `TypeContext`, which represents each
+/// structurally distinct type exactly once. Hence, types are cheap to copy and two types are equal
+/// if and only if they are represented by the same node.
+struct Type {
+private:
+
+  friend std::ostream& operator<<(std::ostream&, const Type&);
+  friend std::hash<Type>;
+
+  /// The node representing this type.
+  type::Node const* node;
+
+  /// Returns the structure of this type.
+  inline auto const& wrapped() const;
+
+public:
+
+  /// Creates an instance wrapping `w`.
+  template<typename T>
+  Type(T const& w);
+
+  Type(Type const& other) = default;
+
+  Type(Type&& other) = default;
+
+  Type() = delete;
+
+  ~Type() noexcept = default;
+
+  Type& operator=(Type const& other) = default;
+
+  Type& operator=(Type&& other) = default;
+
+  /// Returns `true` if `this` wraps an instance of `T`.
+  template<typename T>
+  inline bool is() const;
+
+  /// Returns the wrapped value if it is an instance of `T`.
+  template<typename T>
+  inline std::optional<T> as() const;
+
+  /// Returns the type of the `i`-th part of an instance of the type denoted by `this`.
+  ///
+  /// An exception is thrown if `i` is not a valid index in `this`.
+  Type element_at(uint32_t) const;
+
+  /// Returns the type of the part identified by `path` relative to an instance of the type denoted
+  /// by `this`.
+  ///
+  /// An exception is thrown if `path` is not valid in `this`.
+  template<std::ranges::forward_range P>
+  requires std::same_as<std::ranges::range_value_t<P>, uint32_t>
+  Type element_at_path(const P& path) const {
+    if (path.empty()) {
+      return *this;
+    } else {
+      return element_at(path.front())
+        .element_at_path(std::ranges::subrange(path | std::views::drop(1)));
+    }
+  }
+
+  /// Returns the identifier of the class corresponding to this type.
+  ///
+  /// An exception is thrown if the wrapped instance is not a reference.
+  symbol::Top class_name() const;
+
+  /// Returns the type of that box' contents if `this` denotes the type of a box.
+  std::optional<Type> unboxed() const;
+
+  /// Returns the normalized form of `this`.
+  Type normalized() const;
+
+  /// Returns `true` if `this` denotes a box of `t`.
+  bool is_box_of(Type const& t) const;
+
+  /// Returns `true` if `this` denotes a boxed pointer.
+  bool is_pointer_box() const;
+
+  /// Returns `true` if `this` denotes a reference type.
+  ///
+  /// This property holds if the corresponding type in Scala is subtype of `RefKind`.
+  bool is_reference() const;
+
+  /// Returns `true` if the size of this type is known at compile-time.
+  bool has_known_size() const;
+
+  /// Returns `true` if this instance is equal to `rhs`.
+  inline bool operator==(Type const& other) const { return node == other.node; }
+
+  /// Returns The null reference type.
+  static Type null();
+
+  /// Returns the unit type.
+  static Type unit();
+
+  /// Returns the type of pointers.
+  static Type pointer();
+
+  /// Returns the type of sizes.
+  static Type size();
+
+  /// Returns the vararg type.
+  static Type vararg();
+
+  /// Returns the nothing type.
+  static Type nothing();
+
+  /// Returns the virtual type.
+  static Type virtual_();
+
+  /// Returns a 1-bit unsigned integer, which corresponds to Scala's `Boolean`.
+  static Type u1();
+
+  /// Returns a 8-bit signed integer, which corresponds to Scala's `Byte`.
+  static Type i8();
+
+  /// Returns a 16-bit signed integer, which corresponds to Scala's `Short`.
+  static Type i16();
+
+  /// Returns a 16-bit unsigned integer, which corresponds to Scala's `Char`.
+  static Type u16();
+
+  /// Returns a 32-bit signed integer, which corresponds to Scala's `Int`.
+  static Type i32();
+
+  /// Returns a 64-bit signed integer, which corresponds to Scala's `Long`.
+  static Type i64();
+
+  /// Returns a 32-bit IEEE 754 single-precision float.
+  static Type f32();
+
+  /// Returns a 64-bit IEEE 754 double-precision float.
+  static Type f64();
+
+};
+
+} // nir
+
+namespace nir::type {
+
 /// The type of an array value.
 struct ArrayValue {
 
   friend std::ostream& operator<<(std::ostream&, const ArrayValue&);
 
   /// The type of the array's elements.
-  indirect<Type> element;
+  Type element;
 
   /// The size of the array.
   std::size_t size;
@@ -113,7 +269,7 @@ struct ArrayReference {
   friend std::ostream& operator<<(std::ostream&, const ArrayValue&);
 
   /// The type of the array's elements.
-  indirect<Type> element;
+  Type element;
 
   /// `true` if instances of the denoted type are nullable.
   bool is_nullable;
@@ -139,16 +295,13 @@ struct Struct {
   friend std::ostream& operator<<(std::ostream&, const Struct&);
 
   /// The types of the elements in the aggregate.
-  std::vector<indirect<Type>> elements;
+  std::vector<Type> elements;
 
   /// Creates an empty struct.
   Struct() = default;
 
   /// Creates an instance with `elements`.
-  Struct(std::vector<Type> const& elements);
-
-  /// Creates an instance with `elements`.
-  Struct(std::vector<indirect<Type>>&& elements) : elements(std::move(elements)) {}
+  Struct(std::vector<Type> elements) : elements(std::move(elements)) {}
 
   /// Returns the normalized form of `this`.
   Type normalized() const;
@@ -192,7 +345,7 @@ struct Var {
 
   friend std::ostream& operator<<(std::ostream&, const Var&);
 
-  indirect<Type> type;
+  Type type;
 
   /// Creates an instance with the given type.
   Var(Type const& type) : type(type) {}
@@ -213,13 +366,13 @@ struct Function {
   friend std::ostream& operator<<(std::ostream&, const Function&);
 
   /// The types of the function's parameters.
-  std::vector<indirect<Type>> parameters;
+  std::vector<Type> parameters;
 
   /// The type of the function's return value.
-  indirect<Type> return_value;
+  Type return_value;
 
   /// Creates an instance representing function types from `ps` to `rv`;
-  Function(std::vector<Type> const& ps, Type const& rv);
+  Function(std::vector<Type> ps, Type const& rv) : parameters(std::move(ps)), return_value(rv) {}
 
   Function() = delete;
 
@@ -231,160 +384,113 @@ struct Function {
 
 };
 
-} // nir::type
+/// The representation of a type in a `TypeContext`.
+struct Node {
 
-namespace nir {
-
-/// The type of a NIR entity.
-struct Type {
-private:
-
-  friend std::ostream& operator<<(std::ostream&, const Type&);
-
-  /// The internal representation of a type.
+  /// The structure of a type.
   using Representation = std::variant<
-    type::Predefined,
-    type::Numeric,
-    type::ArrayValue,
-    type::ArrayReference,
-    type::Struct,
-    type::Reference,
-    type::Var,
-    type::Function
+    Predefined,
+    Numeric,
+    ArrayValue,
+    ArrayReference,
+    Struct,
+    Reference,
+    Var,
+    Function
   >;
 
-  /// The wrapped value.
-  Representation wrapped;
-
-public:
-
-  /// Creates an instance wrapping `w`.
-  template<typename T>
-  Type(T const& w) : wrapped(w) {}
+  /// The structure of the represented type.
+  const Representation wrapped;
 
-  Type(Type const& other) : wrapped(other.wrapped) {}
-
-  Type(Type&& other) : wrapped(std::move(other.wrapped)) {}
-
-  Type() = delete;
+  /// A hash of `wrapped`.
+  const std::size_t hash;
 
-  ~Type() noexcept {};
+  /// Creates an instance representing `w`, whose hash is `h`.
+  Node(Representation&& w, std::size_t h) : wrapped(std::move(w)), hash(h) {}
 
-  Type& operator=(Type const& other) { return *this = Type(other); }
-
-  Type& operator=(Type&& other) {
-    std::swap(wrapped, other.wrapped);
-    return *this;
-  }
-
-  /// Returns `true` if `this` wraps an instance of `T`.
-  template<typename T>
-  inline bool is() const {
-    return std::holds_alternative<T>(wrapped);
-  }
+};
 
-  /// Returns the wrapped value if it is an instance of `T`.
-  template<typename T>
-  inline std::optional<T> as() const {
-    return is<T>() ? std::optional(std::get<T>(wrapped)) : std::nullopt;
-  }
+} // nir::type
 
-  /// Returns the type of the `i`-th part of an instance of the type denoted by `this`.
-  ///
-  /// An exception is thrown if `i` is not a valid index in `this`.
-  Type element_at(uint32_t) const;
+namespace nir {
 
-  /// Returns the type of the part identified by `path` relative to an instance of the type denoted
-  /// by `this`.
-  ///
-  /// An exception is thrown if `path` is not valid in `this`.
-  template<std::ranges::forward_range P>
-  requires std::same_as<std::ranges::range_value_t<P>, uint32_t>
-  Type element_at_path(const P& path) const {
-    if (path.empty()) {
-      return *this;
-    } else {
-      return element_at(path.front())
-        .element_at_path(std::ranges::subrange(path | std::views::drop(1)));
-    }
-  }
+/// The universe of NIR types, in which each structurally distinct type is represented by exactly
+/// one node that lives as long as the program.
+///
+/// Types can be interned concurrently. The nodes are distributed in shards that are protected
+/// by different locks to reduce contention.
+struct TypeContext {
+private:
 
-  /// Returns the identifier of the class corresponding to this type.
-  ///
-  /// An exception is thrown if the wrapped instance is not a reference.
-  symbol::Top class_name() const;
+  /// The number of shards in the context.
+  static constexpr std::size_t shard_count = 16;
 
-  /// Returns the type of that box' contents if `this` denotes the type of a box.
-  std::optional<Type> unboxed() const;
+  /// A part of a type context.
+  struct Shard {
 
-  /// Returns the normalized form of `this`.
-  Type normalized() const;
+    /// The lock protecting this shard.
+    std::mutex lock;
 
-  /// Returns `true` if `this` denotes a box of `t`.
-  bool is_box_of(Type const& t) const;
+    /// The nodes in this shard.
+    std::deque<type::Node> nodes;
 
-  /// Returns `true` if `this` denotes a boxed pointer.
-  bool is_pointer_box() const;
+    /// A map from the hash of a node to its address in `nodes`.
+    std::unordered_multimap<std::size_t, type::Node const*> index;
 
-  /// Returns `true` if `this` denotes a reference type.
-  ///
-  /// This property holds if the corresponding type in Scala is subtype of `RefKind`.
-  bool is_reference() const;
+  };
 
-  /// Returns `true` if the size of this type is known at compile-time.
-  bool has_known_size() const;
+  /// The shards of the context.
+  Shard shards[shard_count];
 
-  /// Returns `true` if this instance is equal to `rhs`.
-  bool operator==(Type const& other) const = default;
+public:
 
-  /// Returns The null reference type.
-  inline static Type null() { return { type::Predefined::null }; }
+  TypeContext() = default;
 
-  /// Returns the unit type.
-  inline static Type unit() { return { type::Predefined::unit }; }
+  TypeContext(TypeContext const&) = delete;
+  TypeContext(TypeContext&&) = delete;
 
-  /// Returns the type of pointers.
-  inline static Type pointer() { return { type::Predefined::pointer }; }
+  TypeContext& operator=(TypeContext const&) = delete;
+  TypeContext& operator=(TypeContext&&) = delete;
 
-  /// Returns the type of sizes.
-  inline static Type size() { return { type::Predefined::size }; }
+  /// Returns the context in which all types are interned.
+  static TypeContext& global();
 
-  /// Returns the vararg type.
-  inline static Type vararg() { return { type::Predefined::vararg }; }
+  /// Returns the node representing `w`, creating it if necessary.
+  type::Node const* intern(type::Node::Representation&& w);
 
-  /// Returns the nothing type.
-  inline static Type nothing() { return { type::Predefined::nothing }; }
+  /// Returns the number of distinct types in the context.
+  std::size_t size();
 
-  /// Returns the virtual type.
-  inline static Type virtual_() { return { type::Predefined::virtual_ }; }
+};
 
-  /// Returns a 1-bit unsigned integer, which corresponds to Scala's `Boolean`.
-  inline static Type u1() { return { type::Numeric::integer(1, false) }; }
+template<typename T>
+Type::Type(T const& w) : node(TypeContext::global().intern(type::Node::Representation(w))) {}
 
-  /// Returns a 8-bit signed integer, which corresponds to Scala's `Byte`.
-  inline static Type i8() { return { type::Numeric::integer(32, true) }; }
+inline auto const& Type::wrapped() const { return node->wrapped; }
 
-  /// Returns a 16-bit signed integer, which corresponds to Scala's `Short`.
-  inline static Type i16() { return { type::Numeric::integer(16, true) }; }
+template<typename T>
+inline bool Type::is() const {
+  return std::holds_alternative<T>(node->wrapped);
+}
 
-  /// Returns a 16-bit unsigned integer, which corresponds to Scala's `Char`.
-  inline static Type u16() { return { type::Numeric::integer(16, false) }; }
+template<typename T>
+inline std::optional<T> Type::as() const {
+  return is<T>() ? std::optional(std::get<T>(node->wrapped)) : std::nullopt;
+}
 
-  /// Returns a 32-bit signed integer, which corresponds to Scala's `Int`.
-  inline static Type i32() { return { type::Numeric::integer(32, true) }; }
+} // nir
 
-  /// Returns a 64-bit signed integer, which corresponds to Scala's `Long`.
-  inline static Type i64() { return { type::Numeric::integer(64, true) }; }
+namespace std {
 
-  /// Returns a 32-bit IEEE 754 single-precision float.
-  inline static Type f32() { return { type::Numeric::floating_point(32) }; }
+template<>
+struct hash<nir::Type> {
 
-  /// Returns a 64-bit IEEE 754 double-precision float.
-  inline static Type f64() { return { type::Numeric::floating_point(64) }; }
+  /// Returns a hash of `self`'s salient properties.
+  inline std::size_t operator()(nir::Type const& self) const { return self.node->hash; }
 
 };
 
-} // nir
+} // std
 
 namespace nir::type {
 
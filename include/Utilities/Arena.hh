@@ -0,0 +1,114 @@
+#ifndef NIRC_ARENA_H
+#define NIRC_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace nir {
+
+/// A region of memory in which objects are allocated by bumping a pointer and freed in bulk.
+///
+/// An arena is not thread-safe. Objects allocated in an arena must be destroyed before it, but
+/// destroying them does not release their memory, which is only released with the arena.
+struct Arena {
+private:
+
+  /// The blocks of memory owned by the arena.
+  std::vector<std::unique_ptr<std::byte[]>> blocks;
+
+  /// The address of the next free byte in the current block.
+  std::byte* cursor = nullptr;
+
+  /// The address past the last byte in the current block.
+  std::byte* limit = nullptr;
+
+  /// The size of the blocks allocated to serve small requests.
+  std::size_t block_size;
+
+  /// The number of allocations served by the arena.
+  std::size_t _allocation_count = 0;
+
+  /// The number of bytes served by the arena.
+  std::size_t _allocated_bytes = 0;
+
+  /// Allocates a new block to serve a request of `size` bytes aligned at `alignment`.
+  void* allocate_slow(std::size_t size, std::size_t alignment);
+
+public:
+
+  /// Creates an empty arena allocating memory in blocks of `block_size` bytes.
+  Arena(std::size_t block_size = 1 << 16) : block_size(block_size) {}
+
+  Arena(Arena const&) = delete;
+  Arena(Arena&&) = delete;
+
+  Arena& operator=(Arena const&) = delete;
+  Arena& operator=(Arena&&) = delete;
+
+  /// Returns the address of `size` bytes aligned at `alignment`, or throws `std::bad_alloc` if
+  /// that much memory can't be allocated.
+  ///
+  /// - Precondition: `alignment` is a power of 2.
+  inline void* allocate(std::size_t size, std::size_t alignment) {
+    auto p = reinterpret_cast<std::uintptr_t>(cursor);
+    auto a = (p + alignment - 1) & ~(alignment - 1);
+    auto l = reinterpret_cast<std::uintptr_t>(limit);
+    if ((cursor != nullptr) && (a <= l) && (size <= l - a)) {
+      cursor = reinterpret_cast<std::byte*>(a + size);
+      _allocation_count += 1;
+      _allocated_bytes += size;
+      return reinterpret_cast<void*>(a);
+    }
+    return allocate_slow(size, alignment);
+  }
+
+  /// Grows the last allocation served by the arena by `size` bytes, if it ends at `end` and there
+  /// is enough room left in the current block, and returns `true` iff it did.
+  inline bool extend(void const* end, std::size_t size) {
+    if ((end == cursor) && (cursor != nullptr) && (size <= std::size_t(limit - cursor))) {
+      cursor += size;
+      _allocated_bytes += size;
+      return true;
+    }
+    return false;
+  }
+
+  /// Returns the number of allocations served by the arena.
+  inline std::size_t allocation_count() const { return _allocation_count; }
+
+  /// Returns the number of bytes served by the arena.
+  inline std::size_t allocated_bytes() const { return _allocated_bytes; }
+
+  /// Returns the arena in which the current thread allocates IR nodes, if any.
+  static Arena* current();
+
+};
+
+/// An object that makes an arena current on the calling thread during its lifetime.
+struct ArenaScope {
+private:
+
+  /// The arena that was current before this instance was created.
+  Arena* previous;
+
+public:
+
+  /// Makes `arena` current on the calling thread until this instance is destroyed.
+  ArenaScope(Arena& arena);
+
+  ArenaScope(ArenaScope const&) = delete;
+  ArenaScope(ArenaScope&&) = delete;
+
+  ArenaScope& operator=(ArenaScope const&) = delete;
+  ArenaScope& operator=(ArenaScope&&) = delete;
+
+  ~ArenaScope();
+
+};
+
+}
+
+#endif
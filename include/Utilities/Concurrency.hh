@@ -0,0 +1,54 @@
+#ifndef NIRC_CONCURRENCY_H
+#define NIRC_CONCURRENCY_H
+
+#include <concepts>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nir {
+
+/// Returns the number of threads that can run concurrently on the host, or `1` if that number
+/// can't be determined.
+inline std::size_t hardware_thread_count() {
+  auto n = std::thread::hardware_concurrency();
+  return (n == 0) ? 1 : n;
+}
+
+/// Calls `work(k)` for each `k` in the range [`0`, `n`), on `n` threads that run concurrently,
+/// and returns once all calls have returned.
+///
+/// If some of the calls throw, the first exception that was thrown is rethrown once all calls
+/// have returned.
+template<typename F>
+requires std::invocable<F, std::size_t>
+void concurrently(std::size_t n, F&& work) {
+  std::exception_ptr failure;
+  std::mutex failure_lock;
+
+  auto run = [&](std::size_t k) {
+    try {
+      work(k);
+    } catch (...) {
+      std::lock_guard<std::mutex> guard(failure_lock);
+      if (!failure) { failure = std::current_exception(); }
+    }
+  };
+
+  // The calling thread does its share of the work.
+  std::vector<std::thread> threads;
+  threads.reserve(n);
+  for (std::size_t k = 1; k < n; ++k) {
+    threads.emplace_back(run, k);
+  }
+  if (n > 0) { run(0); }
+
+  for (auto& t : threads) { t.join(); }
+  if (failure) { std::rethrow_exception(failure); }
+}
+
+}
+
+#endif
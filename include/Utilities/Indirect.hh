@@ -1,33 +1,71 @@
 #ifndef NIRC_INDIRECT_H
 #define NIRC_INDIRECT_H
 
+#include "Utilities/Arena.hh"
+
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <utility>
 
 namespace nir {
 
 /// A box wrapping a copy-constructible value allocated on the heap.
 ///
 /// Use `indirect` to store a value in a recursive data type while preserving value semantics.
+///
+/// The value is allocated in the arena that is current on the calling thread when the box is
+/// created, if any, in which case the box must be destroyed before that arena.
 template<typename T>
 struct indirect {
 private:
 
-  /// The wrapped value.
-  std::unique_ptr<T> wrapped;
+  /// The address of the wrapped value, whose least significant bit is set if the value is
+  /// allocated in an arena, or `0` if the box has been consumed.
+  std::uintptr_t address;
+
+  /// Returns the address of a new instance of `T` created with `arguments`.
+  template<typename ... Arguments>
+  static std::uintptr_t make(Arguments&& ... arguments) {
+    static_assert(alignof(T) > 1, "the least significant bit of an address must be free");
+    if (auto a = Arena::current()) {
+      auto p = new (a->allocate(sizeof(T), alignof(T))) T(std::forward<Arguments>(arguments)...);
+      return reinterpret_cast<std::uintptr_t>(p) | 1;
+    } else {
+      return reinterpret_cast<std::uintptr_t>(new T(std::forward<Arguments>(arguments)...));
+    }
+  }
+
+  /// Returns a pointer to the wrapped value.
+  inline T* get() const { return reinterpret_cast<T*>(address & ~std::uintptr_t{1}); }
+
+  /// Destroys the wrapped value, if any.
+  void release() {
+    if (address == 0) {
+      return;
+    } else if (address & 1) {
+      get()->~T();
+    } else {
+      delete get();
+    }
+    address = 0;
+  }
 
 public:
 
   /// Creates a copy of `other`.
-  indirect(T const& other) : wrapped(std::make_unique<T>(other)) {}
+  indirect(T const& other) : address(make(other)) {}
 
   /// Creates a copy of `other`.
-  indirect(T&& other) : wrapped(std::make_unique<T>(std::move(other))) {}
+  indirect(T&& other) : address(make(std::move(other))) {}
 
   /// Creates a copy of `other`.
-  indirect(indirect const& other) : wrapped(std::make_unique<T>(*other.wrapped)) {}
+  indirect(indirect const& other) : address(make(*other)) {}
 
   /// Creates an instance by consuming `other`.
-  indirect(indirect&& other) : wrapped(std::move(other.wrapped)) {}
+  indirect(indirect&& other) : address(std::exchange(other.address, 0)) {}
+
+  ~indirect() { release(); }
 
   /// Assigns `this` to a copy of `other`.
   indirect& operator=(indirect const& other) {
@@ -36,21 +74,21 @@ public:
 
   /// Assigns `this` to `other`, consuming it.
   indirect& operator=(indirect&& other) {
-    std::swap(wrapped, other.wrapped);
+    std::swap(address, other.address);
     return *this;
   }
 
   /// Accesses the wrapped value.
-  T& operator*() { return *wrapped; }
+  T& operator*() { return *get(); }
 
   /// Accesses the wrapped value.
-  T const& operator*() const { return *wrapped; }
+  T const& operator*() const { return *get(); }
 
   /// Accesses the wrapped value.
-  T* operator->() { return wrapped.get(); }
+  T* operator->() { return get(); }
 
   /// Accesses the wrapped value.
-  const T* operator->() const { return wrapped.get(); }
+  const T* operator->() const { return get(); }
 
   /// Returns `true` if this instance is equal to `rhs`.
   inline bool operator==(indirect<T> const& rhs) const { return *(*this) == *rhs; };
@@ -59,4 +97,4 @@ public:
 
 }
 
-#endif
\ No newline at end of file
+#endif
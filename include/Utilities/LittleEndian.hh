@@ -0,0 +1,29 @@
+#ifndef NIRC_LITTLE_ENDIAN_H
+#define NIRC_LITTLE_ENDIAN_H
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace nir {
+
+/// Writes `v` at `p` in little-endian.
+template<typename T>
+void write_le(uint8_t* p, T v) {
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+  }
+}
+
+/// Returns the unsigned integer of type `T` written at `p` in little-endian.
+template<typename T>
+T read_le(uint8_t const* p) {
+  T result = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    result |= static_cast<T>(p[i]) << (8 * i);
+  }
+  return result;
+}
+
+} // nir
+
+#endif
@@ -9,16 +9,16 @@
 
 namespace nir {
 
-/// A value of type `T` or an `std::exception`.
+/// A value of type `T` or an error.
 template<typename T>
 struct Result {
 private:
 
   /// The internal representation of this instance.
-  std::variant<T, std::exception> wrapped;
+  std::variant<T, std::exception_ptr> wrapped;
 
   /// Creates an instance wrapping `w`.
-  explicit Result(std::variant<T, std::exception>&& w) : wrapped(std::move(w)) {}
+  explicit Result(std::variant<T, std::exception_ptr>&& w) : wrapped(std::move(w)) {}
 
 public:
 
@@ -29,7 +29,14 @@ public:
   inline static Result<T> success(T&& w) { return Result(std::move(w)); }
 
   /// Creates an instance wrapping the error `e`.
-  inline static Result<T> failure(std::exception&& e) { return Result(e); }
+  template<typename E>
+  requires std::derived_from<std::decay_t<E>, std::exception>
+  inline static Result<T> failure(E&& e) {
+    return Result(std::make_exception_ptr(std::forward<E>(e)));
+  }
+
+  /// Creates an instance wrapping the error `e`.
+  inline static Result<T> failure(std::exception_ptr e) { return Result(std::move(e)); }
 
   /// Returns `true` if this instance wraps a value and `false` if it wraps an error.
   inline bool is_success() const { return wrapped.index() == 0; }
@@ -39,7 +46,7 @@ public:
     if (wrapped.index() == 0) {
       return std::get<0>(wrapped);
     } else {
-      throw std::get<1>(wrapped);
+      std::rethrow_exception(std::get<1>(wrapped));
     }
   }
 
@@ -51,7 +58,7 @@ public:
     if (wrapped.index() == 0) {
       return Result<U>::success(transform(std::get<0>(wrapped)));
     } else {
-      return Result<U>::failure(std::exception(std::get<1>(wrapped)));
+      return Result<U>::failure(std::get<1>(wrapped));
     }
   }
 
@@ -0,0 +1,141 @@
+#ifndef NIRC_SHARED_H
+#define NIRC_SHARED_H
+
+#include "Utilities/Arena.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace nir {
+
+/// A handle to an immutable value that is shared by all copies of the handle.
+///
+/// Use `shared` to store a value in a recursive data type when copies of the enclosing value
+/// should not copy the wrapped one. Copying a handle only increments a reference count, which is
+/// updated atomically so that handles to the same value can be used on different threads.
+///
+/// The value is allocated in the arena that is current on the calling thread when the handle is
+/// created, if any, in which case all copies of the handle must be destroyed before that arena.
+/// Copying a handle to such a value while that arena isn't current copies the value in the arena
+/// that is, or on the heap if there's none, so that the copy doesn't depend on the arena.
+template<typename T>
+struct shared {
+private:
+
+  /// The storage of a shared value.
+  struct Node {
+
+    /// The number of handles referring to this node.
+    std::atomic<std::size_t> count;
+
+    /// The arena in which this node is allocated, or `nullptr` if it is allocated on the heap.
+    Arena* const arena;
+
+    /// The wrapped value.
+    T const value;
+
+    /// Creates an instance allocated in `arena` and referred to by one handle, wrapping a value
+    /// created with `arguments`.
+    template<typename ... Arguments>
+    Node(Arena* arena, Arguments&& ... arguments) :
+      count(1), arena(arena), value(std::forward<Arguments>(arguments)...)
+    {}
+
+  };
+
+  /// The address of the node storing the wrapped value, whose least significant bit is set if the
+  /// node is allocated in an arena, or `0` if the handle has been consumed.
+  std::uintptr_t address;
+
+  /// Returns the address of a new node wrapping an instance of `T` created with `arguments`.
+  template<typename ... Arguments>
+  static std::uintptr_t make(Arguments&& ... arguments) {
+    static_assert(alignof(Node) > 1, "the least significant bit of an address must be free");
+    if (auto a = Arena::current()) {
+      auto p = new (a->allocate(sizeof(Node), alignof(Node)))
+        Node(a, std::forward<Arguments>(arguments)...);
+      return reinterpret_cast<std::uintptr_t>(p) | 1;
+    } else {
+      auto p = new Node(nullptr, std::forward<Arguments>(arguments)...);
+      return reinterpret_cast<std::uintptr_t>(p);
+    }
+  }
+
+  /// Returns a pointer to the node storing the wrapped value.
+  inline Node* node() const { return reinterpret_cast<Node*>(address & ~std::uintptr_t{1}); }
+
+  /// Increments the reference count of the wrapped value, if any, and returns `address`.
+  std::uintptr_t retain() const {
+    if (address != 0) { node()->count.fetch_add(1, std::memory_order_relaxed); }
+    return address;
+  }
+
+  /// Returns the address of the node that a copy of this handle should refer to, which is a new
+  /// copy of the wrapped value if that value is allocated in an arena other than the current one,
+  /// or `address` after incrementing the reference count of the wrapped value.
+  std::uintptr_t share() const {
+    if ((address & 1) && (node()->arena != Arena::current())) {
+      return make(node()->value);
+    } else {
+      return retain();
+    }
+  }
+
+  /// Decrements the reference count of the wrapped value, if any, destroying it if this handle was
+  /// the last one referring to it.
+  void release() {
+    if ((address == 0) || (node()->count.fetch_sub(1, std::memory_order_acq_rel) != 1)) {
+      // Other handles still refer to the value.
+    } else if (address & 1) {
+      node()->~Node();
+    } else {
+      delete node();
+    }
+    address = 0;
+  }
+
+public:
+
+  /// Creates a handle to a copy of `other`.
+  shared(T const& other) : address(make(other)) {}
+
+  /// Creates a handle to a copy of `other`.
+  shared(T&& other) : address(make(std::move(other))) {}
+
+  /// Creates a handle to the value wrapped by `other`, or to a copy of that value (see `share`).
+  shared(shared const& other) : address(other.share()) {}
+
+  /// Creates an instance by consuming `other`.
+  shared(shared&& other) : address(std::exchange(other.address, 0)) {}
+
+  ~shared() { release(); }
+
+  /// Assigns `this` to a handle to the value wrapped by `other`.
+  shared& operator=(shared const& other) {
+    return *this = shared(other);
+  }
+
+  /// Assigns `this` to `other`, consuming it.
+  shared& operator=(shared&& other) {
+    std::swap(address, other.address);
+    return *this;
+  }
+
+  /// Accesses the wrapped value.
+  T const& operator*() const { return node()->value; }
+
+  /// Accesses the wrapped value.
+  const T* operator->() const { return &node()->value; }
+
+  /// Returns `true` if this instance is equal to `rhs`.
+  inline bool operator==(shared<T> const& rhs) const {
+    return (node() == rhs.node()) || (*(*this) == *rhs);
+  };
+
+};
+
+}
+
+#endif
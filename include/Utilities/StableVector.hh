@@ -0,0 +1,112 @@
+#ifndef NIRC_STABLE_VECTOR_H
+#define NIRC_STABLE_VECTOR_H
+
+#include "Utilities/Assert.hh"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace nir {
+
+/// An append-only sequence of up to 2^32 elements whose addresses are stable.
+///
+/// Elements are stored in chunks whose sizes grow geometrically and that are never moved. Hence,
+/// an element can be read without synchronization while other threads append new elements, as
+/// long as the index of that element was obtained after it was appended.
+template<typename T>
+struct StableVector {
+private:
+
+  /// The base 2 logarithm of the number of elements in the first chunk.
+  static constexpr std::size_t first_chunk_bits = 10;
+
+  /// The number of chunks necessary to store 2^32 elements.
+  static constexpr std::size_t chunk_count = 32 - first_chunk_bits + 1;
+
+  /// The chunks of the vector, allocated on demand.
+  std::atomic<T*> chunks[chunk_count] = {};
+
+  /// The number of elements that have been appended.
+  std::atomic<uint64_t> count = 0;
+
+  /// The lock that must be acquired to allocate a chunk.
+  std::mutex growth;
+
+  /// Returns the number of elements in the `k`-th chunk.
+  static constexpr std::size_t capacity_of(std::size_t k) {
+    return std::size_t{1} << (k + first_chunk_bits);
+  }
+
+  /// Returns the chunk containing the element at index `i` and the offset of that element in the
+  /// chunk.
+  static inline std::pair<std::size_t, std::size_t> locate(uint32_t i) {
+    auto j = static_cast<uint64_t>(i) + capacity_of(0);
+    auto k = static_cast<std::size_t>(std::bit_width(j)) - first_chunk_bits - 1;
+    return {k, static_cast<std::size_t>(j - capacity_of(k))};
+  }
+
+  /// Returns the `k`-th chunk, allocating it if necessary.
+  T* chunk(std::size_t k) {
+    auto c = chunks[k].load(std::memory_order_acquire);
+    if (c != nullptr) { return c; }
+
+    std::lock_guard<std::mutex> guard(growth);
+    c = chunks[k].load(std::memory_order_relaxed);
+    if (c == nullptr) {
+      c = static_cast<T*>(::operator new(capacity_of(k) * sizeof(T), std::align_val_t{alignof(T)}));
+      chunks[k].store(c, std::memory_order_release);
+    }
+    return c;
+  }
+
+public:
+
+  StableVector() = default;
+
+  StableVector(StableVector const&) = delete;
+  StableVector(StableVector&&) = delete;
+
+  StableVector& operator=(StableVector const&) = delete;
+  StableVector& operator=(StableVector&&) = delete;
+
+  ~StableVector() {
+    auto n = count.load();
+    for (uint64_t i = 0; i < n; ++i) {
+      auto [k, o] = locate(static_cast<uint32_t>(i));
+      chunks[k].load()[o].~T();
+    }
+    for (std::size_t k = 0; k < chunk_count; ++k) {
+      if (auto c = chunks[k].load()) { ::operator delete(c, std::align_val_t{alignof(T)}); }
+    }
+  }
+
+  /// Returns the number of elements that have been appended.
+  inline std::size_t size() const { return count.load(std::memory_order_relaxed); }
+
+  /// Appends `e` and returns its index.
+  uint32_t push_back(T&& e) {
+    auto i = count.fetch_add(1, std::memory_order_relaxed);
+    precondition(i <= UINT32_MAX, "vector is full");
+    auto [k, o] = locate(static_cast<uint32_t>(i));
+    new (chunk(k) + o) T(std::move(e));
+    return static_cast<uint32_t>(i);
+  }
+
+  /// Returns the element at index `i`.
+  ///
+  /// - Precondition: the element at index `i` has been appended.
+  inline T const& operator[](uint32_t i) const {
+    auto [k, o] = locate(i);
+    return chunks[k].load(std::memory_order_acquire)[o];
+  }
+
+};
+
+}
+
+#endif
@@ -5,10 +5,19 @@
 #include "Runtime.hh"
 #include "Symbol.hh"
 #include "Type.hh"
-#include "Utilities/Indirect.hh"
+#include "Utilities/Assert.hh"
+#include "Utilities/Shared.hh"
 
 #include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <cstdlib>
+#include <new>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
 namespace nir {
@@ -114,19 +123,86 @@ using Float = float;
 using Double = double;
 
 /// A homogeneous collection of data members.
+///
+/// The elements of an array whose element type is a numeric type other than `u1` are stored
+/// contiguously as instances of the corresponding C++ type, rather than as `Value`s.
 struct ArrayValue final {
+public:
+
+  /// The storage of an array's elements.
+  using Storage = std::variant<
+    std::vector<Value>,
+    std::vector<Char>,
+    std::vector<Byte>,
+    std::vector<Short>,
+    std::vector<Int>,
+    std::vector<Long>,
+    std::vector<Float>,
+    std::vector<Double>
+  >;
 
   /// The type of the array's elements.
   Type element_type;
 
-  /// The elements in the array.
-  std::vector<indirect<Value>> elements;
+private:
+
+  /// The elements in the array, which are shared by the copies of this instance.
+  shared<Storage> storage;
+
+public:
 
   /// Creates an instance with `es`, which are instances of `t`.
-  ArrayValue(Type const& t, std::vector<Value> const& es);
+  ///
+  /// The elements are stored contiguously if `t` is a numeric type other than `u1` and all
+  /// elements are instances of the corresponding C++ type.
+  ArrayValue(Type const& t, std::vector<Value>&& es);
+
+  /// Creates an instance with `es`, which are instances of the numeric type corresponding to `T`.
+  template<typename T>
+  requires (!std::is_same_v<T, Value>)
+  ArrayValue(std::vector<T>&& es) :
+    element_type(ValueTrait<T>::type(T{})), storage(Storage(std::move(es)))
+  {}
 
   ArrayValue() = delete;
 
+  /// Returns the number of elements in the array.
+  std::size_t size() const;
+
+  /// Returns the element at index `i`.
+  ///
+  /// - Precondition: `i` is less than `size()`.
+  Value operator[](std::size_t i) const;
+
+  /// Calls `action` with each element of the array, in order.
+  ///
+  /// The elements stored as `Value`s are passed by reference; the others are passed as temporary
+  /// instances of `Value`.
+  template<typename F>
+  void for_each(F&& action) const {
+    std::visit([&](auto const& es) {
+      for (auto const& e : es) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(e)>, Value>) {
+          action(e);
+        } else {
+          action(Value(e));
+        }
+      }
+    }, *storage);
+  }
+
+  /// Returns a view of the elements if they are stored as instances of `T`.
+  ///
+  /// The elements are stored as `Value`s unless the type of the array is a numeric type.
+  template<typename T>
+  inline std::optional<std::span<T const>> elements_as() const {
+    if (auto es = std::get_if<std::vector<T>>(&*storage)) {
+      return std::span<T const>(es->data(), es->size());
+    } else {
+      return std::nullopt;
+    }
+  }
+
   /// Returns the NIR type of `self`.
   inline Type type() const { return element_type; }
 
@@ -138,11 +214,11 @@ struct ArrayValue final {
 /// A heterogeneous collection of data members.
 struct Struct final {
 
-  /// The elements in the aggregate.
-  std::vector<indirect<Value>> elements;
+  /// The elements in the aggregate, which are shared by the copies of this instance.
+  shared<std::vector<Value>> elements;
 
   /// Creates an instance with `es`.
-  Struct(std::vector<Value> const& es);
+  Struct(std::vector<Value>&& es) : elements(std::move(es)) {}
 
   Struct() = delete;
 
@@ -158,10 +234,12 @@ struct Struct final {
 struct ByteString final {
 
   /// The contents of the collection.
-  std::vector<Byte> bytes;
+  std::span<Byte const> bytes;
 
   /// Creates an instance with the given bytes.
-  ByteString(std::vector<Byte> const& bs) : bytes(bs) {}
+  ///
+  /// - Requires: the bytes of `bs` outlive the instance.
+  ByteString(std::span<Byte const> bs) : bytes(bs) {}
 
   ByteString() = delete;
 
@@ -172,7 +250,9 @@ struct ByteString final {
   inline Type type() const { return Type(type::ArrayValue(Type::i8(), byte_count())); }
 
   /// Returns `true` if this instance is equal to `rhs`.
-  bool operator==(ByteString const& rhs) const = default;
+  inline bool operator==(ByteString const& rhs) const {
+    return std::equal(bytes.begin(), bytes.end(), rhs.bytes.begin(), rhs.bytes.end());
+  }
 
 };
 
@@ -188,6 +268,10 @@ public:
   /// The identifier of the variable.
   nir::Local id;
 
+  /// The upper bound (exclusive) of the identifiers of local values, which are stored along with
+  /// the kind of their value in 64 bits.
+  static constexpr nir::Local identifier_limit = nir::Local{1} << 56;
+
   /// Creates an instance with the given properties.
   Local(nir::Local const& n, Type const& t) : _type(t), id(n) {}
 
@@ -229,11 +313,11 @@ public:
 /// A constant value.
 struct Constant final {
 
-  /// The value of the constant.
-  indirect<Value> value;
+  /// The value of the constant, which is shared by the copies of this instance.
+  shared<Value> value;
 
   /// Creates an instance with the given properties.
-  Constant(Value const& v) : value(indirect(v)) {}
+  Constant(Value const& v) : value(v) {}
 
   Constant() = delete;
 
@@ -249,15 +333,19 @@ struct Constant final {
 struct String final {
 
   /// The value of the character string.
-  std::string value;
+  std::string_view value;
 
   /// Creates an instance with the given value.
-  String(std::string const& v) : value(v) {}
+  ///
+  /// - Requires: the characters of `v` outlive the instance.
+  String(std::string_view v) : value(v) {}
 
   String() = delete;
 
   /// Returns the NIR type of `self`.
-  inline Type type() const { return Type(type::Reference(runtime::String.name, true, false)); }
+  inline Type type() const {
+    return Type(type::Reference(runtime::String.class_name(), true, false));
+  }
 
   /// Returns `true` if this instance is equal to `rhs`.
   bool operator==(String const& rhs) const = default;
@@ -307,78 +395,304 @@ struct ClassOf final {
 namespace nir {
 
 /// A value in NIR.
+///
+/// An instance is 16 bytes wide. Scalars, types, locals, symbols, and views of strings are stored
+/// inline. Aggregates are stored out of line, in nodes that are shared by the copies of a value
+/// and allocated in the current arena, if any. They are read by reference through `as` and
+/// `visit`, so that only copies of a value may copy its nodes out of an arena.
 struct Value final {
 private:
 
-  /// The internal representation of a value.
-  using Representation = std::variant<
-    value::Null,
-    value::Unit,
-    value::Zero,
-    value::Boolean,
-    value::Size,
-    value::Char,
-    value::Byte,
-    value::Short,
-    value::Int,
-    value::Long,
-    value::Float,
-    value::Double,
-    value::ArrayValue,
-    value::Struct,
-    value::ByteString,
-    value::Local,
-    value::Symbol,
-    value::Constant,
-    value::String,
-    value::Virtual,
-    value::ClassOf
-  >;
+  /// The kind of a value, in the order of the alternatives of `value`.
+  enum struct Kind : uint8_t {
+    null, unit, zero, boolean, size, char_, byte, short_, int_, long_, float_, double_, array,
+    struct_, byte_string, local, symbol, constant, string, virtual_, class_of
+  };
+
+  /// The main part of a value's representation.
+  union Payload {
+
+    /// The bits of a scalar, type, character or byte pointer, or key.
+    uint64_t bits;
+
+    /// An array, stored out of line.
+    shared<value::ArrayValue> array;
+
+    /// A struct, whose elements are stored out of line.
+    value::Struct struct_;
+
+    /// A constant, whose value is stored out of line.
+    value::Constant constant;
+
+    Payload() : bits(0) {}
+
+    ~Payload() {}
+
+  };
 
-  /// The wrapped value.
-  Representation wrapped;
+  /// The main part of this value's representation.
+  Payload payload;
+
+  /// The kind of this value in the 8 least significant bits, followed by a 56-bit extension of the
+  /// payload holding the identifier of a local, the length of a string or byte string, or the raw value
+  /// of a symbol.
+  uint64_t header;
+
+  /// Returns the kind of values of type `T`.
+  template<typename T>
+  static constexpr Kind kind_of() {
+    if constexpr (std::is_same_v<T, value::Null>) { return Kind::null; }
+    else if constexpr (std::is_same_v<T, value::Unit>) { return Kind::unit; }
+    else if constexpr (std::is_same_v<T, value::Zero>) { return Kind::zero; }
+    else if constexpr (std::is_same_v<T, value::Boolean>) { return Kind::boolean; }
+    else if constexpr (std::is_same_v<T, value::Size>) { return Kind::size; }
+    else if constexpr (std::is_same_v<T, value::Char>) { return Kind::char_; }
+    else if constexpr (std::is_same_v<T, value::Byte>) { return Kind::byte; }
+    else if constexpr (std::is_same_v<T, value::Short>) { return Kind::short_; }
+    else if constexpr (std::is_same_v<T, value::Int>) { return Kind::int_; }
+    else if constexpr (std::is_same_v<T, value::Long>) { return Kind::long_; }
+    else if constexpr (std::is_same_v<T, value::Float>) { return Kind::float_; }
+    else if constexpr (std::is_same_v<T, value::Double>) { return Kind::double_; }
+    else if constexpr (std::is_same_v<T, value::ArrayValue>) { return Kind::array; }
+    else if constexpr (std::is_same_v<T, value::Struct>) { return Kind::struct_; }
+    else if constexpr (std::is_same_v<T, value::ByteString>) { return Kind::byte_string; }
+    else if constexpr (std::is_same_v<T, value::Local>) { return Kind::local; }
+    else if constexpr (std::is_same_v<T, value::Symbol>) { return Kind::symbol; }
+    else if constexpr (std::is_same_v<T, value::Constant>) { return Kind::constant; }
+    else if constexpr (std::is_same_v<T, value::String>) { return Kind::string; }
+    else if constexpr (std::is_same_v<T, value::Virtual>) { return Kind::virtual_; }
+    else {
+      static_assert(std::is_same_v<T, value::ClassOf>, "not a value");
+      return Kind::class_of;
+    }
+  }
+
+  /// Returns the kind of this value.
+  inline Kind kind() const { return static_cast<Kind>(header & 0xff); }
+
+  /// Returns the extension of the payload.
+  inline uint64_t extension() const { return header >> 8; }
+
+  /// Sets the kind of this value to `k` and the extension of its payload to `e`.
+  ///
+  /// - Precondition: `e` is smaller than 2^56.
+  inline void set_header(Kind k, uint64_t e = 0) { header = static_cast<uint64_t>(k) | (e << 8); }
+
+  /// An unsigned integer type as wide as `T`.
+  template<typename T>
+  using Bits = std::conditional_t<sizeof(T) == 1, uint8_t,
+    std::conditional_t<sizeof(T) == 2, uint16_t,
+    std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+  /// Returns the bits of `v`, which is trivially copyable and 1, 2, 4, or 8 bytes wide.
+  template<typename T>
+  inline static uint64_t bits_of(T const& v) {
+    return static_cast<uint64_t>(std::bit_cast<Bits<T>>(v));
+  }
+
+  /// Returns the instance of `T` whose bits are `b`.
+  template<typename T>
+  inline static T from_bits(uint64_t b) {
+    return std::bit_cast<T>(static_cast<Bits<T>>(b));
+  }
+
+  /// `true` iff values of type `T` are stored out of line.
+  template<typename T>
+  static constexpr bool is_out_of_line =
+    std::is_same_v<T, value::ArrayValue> || std::is_same_v<T, value::Struct> ||
+    std::is_same_v<T, value::Constant>;
+
+  /// Returns the value wrapped by `this`, which is an instance of `T`.
+  ///
+  /// Values stored out of line are returned by reference, so that reading them doesn't copy the
+  /// handles to their nodes.
+  template<typename T>
+  decltype(auto) get() const {
+    if constexpr (std::is_same_v<T, value::Null> || std::is_same_v<T, value::Unit>) {
+      return T{};
+    } else if constexpr (std::is_same_v<T, value::Zero>) {
+      return value::Zero(from_bits<Type>(payload.bits));
+    } else if constexpr (std::is_same_v<T, value::Size>) {
+      return value::Size(payload.bits);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      return from_bits<T>(payload.bits);
+    } else if constexpr (std::is_same_v<T, value::ArrayValue>) {
+      return *payload.array;
+    } else if constexpr (std::is_same_v<T, value::Struct>) {
+      return (payload.struct_);
+    } else if constexpr (std::is_same_v<T, value::ByteString>) {
+      return value::ByteString(
+        std::span<value::Byte const>(from_bits<value::Byte const*>(payload.bits), extension()));
+    } else if constexpr (std::is_same_v<T, value::Local>) {
+      return value::Local(extension(), from_bits<Type>(payload.bits));
+    } else if constexpr (std::is_same_v<T, value::Symbol>) {
+      return value::Symbol(
+        from_bits<nir::Symbol>(extension()), from_bits<Type>(payload.bits));
+    } else if constexpr (std::is_same_v<T, value::Constant>) {
+      return (payload.constant);
+    } else if constexpr (std::is_same_v<T, value::String>) {
+      return value::String(std::string_view(from_bits<char const*>(payload.bits), extension()));
+    } else if constexpr (std::is_same_v<T, value::Virtual>) {
+      return value::Virtual(payload.bits);
+    } else {
+      static_assert(std::is_same_v<T, value::ClassOf>, "not a value");
+      return value::ClassOf(from_bits<symbol::Top>(extension()));
+    }
+  }
+
+  /// Initializes this value with a copy of `other`.
+  void copy_from(Value const& other);
+
+  /// Initializes this value by consuming `other`, which is left wrapping `value::Null`.
+  void move_from(Value& other);
+
+  /// Destroys the out-of-line parts of this value, if any.
+  void release();
 
 public:
 
   /// Creates an instance wrapping `w`.
   template<typename T>
-  Value(T const& w) : wrapped(w) {}
+  Value(T const& w) {
+    constexpr auto k = kind_of<T>();
+    if constexpr (std::is_same_v<T, value::Null> || std::is_same_v<T, value::Unit>) {
+      set_header(k);
+    } else if constexpr (std::is_same_v<T, value::Zero>) {
+      payload.bits = bits_of(w.type());
+      set_header(k);
+    } else if constexpr (std::is_same_v<T, value::Size>) {
+      payload.bits = w.raw_value;
+      set_header(k);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      payload.bits = bits_of(w);
+      set_header(k);
+    } else if constexpr (std::is_same_v<T, value::ArrayValue>) {
+      new (&payload.array) shared<value::ArrayValue>(w);
+      set_header(k);
+    } else if constexpr (std::is_same_v<T, value::Struct>) {
+      new (&payload.struct_) value::Struct(w);
+      set_header(k);
+    } else if constexpr (std::is_same_v<T, value::ByteString>) {
+      payload.bits = bits_of(w.bytes.data());
+      set_header(k, w.bytes.size());
+    } else if constexpr (std::is_same_v<T, value::Local>) {
+      precondition(w.id < value::Local::identifier_limit, "local identifier is too large");
+      payload.bits = bits_of(w.type());
+      set_header(k, w.id);
+    } else if constexpr (std::is_same_v<T, value::Symbol>) {
+      payload.bits = bits_of(w.type());
+      set_header(k, bits_of(w.name));
+    } else if constexpr (std::is_same_v<T, value::Constant>) {
+      new (&payload.constant) value::Constant(w);
+      set_header(k);
+    } else if constexpr (std::is_same_v<T, value::String>) {
+      payload.bits = bits_of(w.value.data());
+      set_header(k, w.value.size());
+    } else if constexpr (std::is_same_v<T, value::Virtual>) {
+      payload.bits = w.key;
+      set_header(k);
+    } else {
+      set_header(k, bits_of(w.name));
+    }
+  }
 
-  Value(Value const& other) : wrapped(other.wrapped) {}
+  Value(Value const& other) { copy_from(other); }
 
-  Value(Value&& other) : wrapped(std::move(other.wrapped)) {}
+  Value(Value&& other) { move_from(other); }
 
   Value() = delete;
 
-  ~Value() noexcept {}
+  ~Value() noexcept { release(); }
 
   Value& operator=(Value const& other) { return *this = Value(other); }
 
   Value& operator=(Value&& other) {
-    std::swap(wrapped, other.wrapped);
+    if (this != &other) {
+      release();
+      move_from(other);
+    }
     return *this;
   }
 
   /// Returns `true` if `this` wraps an instance of `T`.
   template<typename T>
   inline bool is() const {
-    return std::holds_alternative<T>(wrapped);
+    return kind() == kind_of<T>();
   }
 
   /// Returns the wrapped value if it is an instance of `T`.
+  ///
+  /// If `T` is stored out of line, the result is a pointer to the wrapped value, or `nullptr`,
+  /// rather than a copy of it.
   template<typename T>
-  inline std::optional<T> as() const {
-    return is<T>() ? std::optional(std::get<T>(wrapped)) : std::nullopt;
+  inline auto as() const {
+    if constexpr (is_out_of_line<T>) {
+      return is<T>() ? &get<T>() : nullptr;
+    } else {
+      return is<T>() ? std::optional<T>(get<T>()) : std::nullopt;
+    }
+  }
+
+  /// Returns the result of `action` applied to the value wrapped by `this`, which is passed by
+  /// reference if it is stored out of line.
+  template<typename F>
+  decltype(auto) visit(F&& action) const {
+    switch (kind()) {
+      case Kind::null:
+        return action(get<value::Null>());
+      case Kind::unit:
+        return action(get<value::Unit>());
+      case Kind::zero:
+        return action(get<value::Zero>());
+      case Kind::boolean:
+        return action(get<value::Boolean>());
+      case Kind::size:
+        return action(get<value::Size>());
+      case Kind::char_:
+        return action(get<value::Char>());
+      case Kind::byte:
+        return action(get<value::Byte>());
+      case Kind::short_:
+        return action(get<value::Short>());
+      case Kind::int_:
+        return action(get<value::Int>());
+      case Kind::long_:
+        return action(get<value::Long>());
+      case Kind::float_:
+        return action(get<value::Float>());
+      case Kind::double_:
+        return action(get<value::Double>());
+      case Kind::array:
+        return action(get<value::ArrayValue>());
+      case Kind::struct_:
+        return action(get<value::Struct>());
+      case Kind::byte_string:
+        return action(get<value::ByteString>());
+      case Kind::local:
+        return action(get<value::Local>());
+      case Kind::symbol:
+        return action(get<value::Symbol>());
+      case Kind::constant:
+        return action(get<value::Constant>());
+      case Kind::string:
+        return action(get<value::String>());
+      case Kind::virtual_:
+        return action(get<value::Virtual>());
+      default:
+        return action(get<value::ClassOf>());
+    }
   }
 
   /// Returns the NIR type of this instance.
   Type type() const;
 
   /// Returns `true` if this instance is equal to `rhs`.
-  bool operator==(Value const& rhs) const = default;
+  bool operator==(Value const& rhs) const;
 
 };
 
+static_assert(sizeof(Value) == 16);
+
 } // nir
 
 // --- Trait implementations --------------------------------------------------
@@ -0,0 +1,113 @@
+#ifndef NIRC_WORKSPACE_H
+#define NIRC_WORKSPACE_H
+
+#include "Definition.hh"
+#include "File.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+namespace nir {
+
+/// The options of a workspace's loading.
+struct WorkspaceOptions {
+
+  /// The number of threads enumerating and decoding files concurrently, or `0` to use as many
+  /// threads as the host can run concurrently.
+  std::size_t thread_count = 0;
+
+  /// The number of files that a thread reads with a single batch of system calls before decoding
+  /// them.
+  std::size_t batch_size = 32;
+
+  /// The options of each file's decoding.
+  ///
+  /// Files are decoded concurrently with each other, so there is usually no benefit in decoding
+  /// the definitions of a single file on more than one thread.
+  DecodingOptions decoding;
+
+};
+
+/// A file found during the enumeration of a workspace, along with its size.
+struct FoundFile {
+
+  /// The path of the file.
+  std::filesystem::path path;
+
+  /// The size of the file in bytes.
+  std::uintmax_t size;
+
+};
+
+/// Returns the files in `roots` on `thread_count` threads, sorted by path and without duplicates.
+///
+/// The paths denoting regular files are returned as is. The paths denoting directories are
+/// searched recursively for files whose extension is `.nir`, without following symbolic links to
+/// other directories. An exception is thrown if a path can't be read.
+std::vector<FoundFile> enumerate_files(
+  std::vector<std::filesystem::path> const& roots, std::size_t thread_count);
+
+/// A collection of NIR files loaded together, such as the contents of a classpath.
+///
+/// The files of a workspace are sorted by path, so that the order in which its definitions are
+/// visited doesn't depend on the order in which the files were enumerated or decoded.
+struct Workspace {
+private:
+
+  /// The paths of the files in the workspace, in lexicographic order.
+  std::vector<std::filesystem::path> _paths;
+
+  /// The files in the workspace, at the same indices as `_paths`.
+  std::vector<File> _files;
+
+  /// Creates an instance with the given properties.
+  Workspace(std::vector<std::filesystem::path>&& paths, std::vector<File>&& files) :
+    _paths(std::move(paths)), _files(std::move(files))
+  {}
+
+public:
+
+  /// Creates an instance with the contents of `roots`, which are paths to directories or files,
+  /// enumerating and decoding files concurrently.
+  ///
+  /// The paths denoting regular files are loaded as is. The paths denoting directories are
+  /// searched recursively for files whose extension is `.nir`, without following symbolic links to
+  /// other directories. A file contained in more than one root is loaded once. An exception is
+  /// thrown if a path can't be read or a file can't be decoded.
+  static Workspace load(
+    std::vector<std::filesystem::path> const& roots, WorkspaceOptions const& options = {});
+
+  Workspace(Workspace const&) = delete;
+  Workspace(Workspace&&) = default;
+
+  Workspace& operator=(Workspace const&) = delete;
+  Workspace& operator=(Workspace&&) = default;
+
+  /// Returns the number of files in the workspace.
+  inline std::size_t size() const { return _files.size(); }
+
+  /// Returns the paths of the files in the workspace, in lexicographic order.
+  inline std::vector<std::filesystem::path> const& paths() const { return _paths; }
+
+  /// Returns the files in the workspace, at the same indices as `paths()`.
+  inline std::vector<File> const& files() const { return _files; }
+
+  /// Returns the number of definitions in the workspace.
+  std::size_t definition_count() const;
+
+  /// Calls `action` with each definition in the workspace, in the order of the files that contain
+  /// them and then in the order in which they occur in these files.
+  template<typename F>
+  void for_each_definition(F&& action) const {
+    for (auto const& f : _files) {
+      for (auto const& d : f.definitions) { action(d); }
+    }
+  }
+
+};
+
+} // nir
+
+#endif
@@ -0,0 +1,43 @@
+#include "Utilities/Arena.hh"
+
+#include <limits>
+#include <new>
+
+namespace nir {
+
+/// The arena that is current on this thread.
+thread_local Arena* current_arena = nullptr;
+
+void* Arena::allocate_slow(std::size_t size, std::size_t alignment) {
+  // Sizes read from untrusted input may be arbitrarily large.
+  if (size > std::numeric_limits<std::size_t>::max() - alignment) { throw std::bad_alloc(); }
+
+  // Large requests get a block of their own so that the current block keeps serving small ones.
+  auto n = size + alignment;
+  if (n > block_size / 4) {
+    auto& b = blocks.emplace_back(new std::byte[n]);
+    auto p = reinterpret_cast<std::uintptr_t>(b.get());
+    _allocation_count += 1;
+    _allocated_bytes += size;
+    return reinterpret_cast<void*>((p + alignment - 1) & ~(alignment - 1));
+  }
+
+  auto& b = blocks.emplace_back(new std::byte[block_size]);
+  cursor = b.get();
+  limit = cursor + block_size;
+  return allocate(size, alignment);
+}
+
+Arena* Arena::current() {
+  return current_arena;
+}
+
+ArenaScope::ArenaScope(Arena& arena) : previous(current_arena) {
+  current_arena = &arena;
+}
+
+ArenaScope::~ArenaScope() {
+  current_arena = previous;
+}
+
+}
@@ -0,0 +1,416 @@
+#include "BatchReader.hh"
+#include "Utilities/Assert.hh"
+#include "Utilities/Defer.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <fstream>
+#include <ios>
+
+#if __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NIRC_HAS_POSIX_IO 1
+#endif
+
+// io_uring can be disabled by defining `NIRC_NO_IO_URING`, so that the fallback can be tested on
+// hosts that support it.
+#if !defined(NIRC_NO_IO_URING) && __has_include(<linux/io_uring.h>) && \
+  __has_include(<sys/syscall.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define NIRC_HAS_IO_URING 1
+#endif
+#endif
+
+namespace nir {
+
+#ifdef NIRC_HAS_IO_URING
+
+/// An io_uring along with the mappings of its submission and completion queues.
+struct BatchReader::Ring {
+
+  /// The file descriptor of the ring.
+  int fd = -1;
+
+  /// The mapping of the submission queue.
+  void* sq_ring = MAP_FAILED;
+
+  /// The size of `sq_ring` in bytes.
+  std::size_t sq_ring_size = 0;
+
+  /// The mapping of the completion queue, which may be the same as `sq_ring`.
+  void* cq_ring = MAP_FAILED;
+
+  /// The size of `cq_ring` in bytes.
+  std::size_t cq_ring_size = 0;
+
+  /// The mapping of the submission queue entries.
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+
+  /// The size of `sqes` in bytes.
+  std::size_t sqes_size = 0;
+
+  /// The tail of the submission queue, shared with the kernel.
+  unsigned* sq_tail;
+
+  /// The mask applied to positions in the submission queue.
+  unsigned sq_mask;
+
+  /// The indices of the submitted entries, shared with the kernel.
+  unsigned* sq_array;
+
+  /// The head of the completion queue, shared with the kernel.
+  unsigned* cq_head;
+
+  /// The tail of the completion queue, shared with the kernel.
+  unsigned* cq_tail;
+
+  /// The mask applied to positions in the completion queue.
+  unsigned cq_mask;
+
+  /// The completion queue entries.
+  io_uring_cqe* cqes;
+
+  /// The position past the last entry queued for submission.
+  unsigned queued_tail;
+
+  /// `false` if a submission failed and some of the entries it submitted may still be in flight.
+  bool is_drained = true;
+
+  Ring() = default;
+
+  Ring(Ring const&) = delete;
+  Ring& operator=(Ring const&) = delete;
+
+  ~Ring() {
+    if (sqes != MAP_FAILED) { ::munmap(sqes, sqes_size); }
+    if ((cq_ring != MAP_FAILED) && (cq_ring != sq_ring)) { ::munmap(cq_ring, cq_ring_size); }
+    if (sq_ring != MAP_FAILED) { ::munmap(sq_ring, sq_ring_size); }
+    if (fd >= 0) { ::close(fd); }
+  }
+
+  /// Returns a ring with room for `entries` submissions, or `nullptr` if the kernel doesn't
+  /// support io_uring.
+  static std::unique_ptr<Ring> make(unsigned entries) {
+    io_uring_params p{};
+    auto result = std::make_unique<Ring>();
+    result->fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+    if (result->fd < 0) { return nullptr; }
+
+    result->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    result->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    result->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+
+    // Both queues may be mapped at once on recent kernels.
+    auto single_mapping = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mapping) {
+      result->sq_ring_size = std::max(result->sq_ring_size, result->cq_ring_size);
+    }
+
+    auto protection = PROT_READ | PROT_WRITE;
+    auto flags = MAP_SHARED | MAP_POPULATE;
+    result->sq_ring = ::mmap(
+      nullptr, result->sq_ring_size, protection, flags, result->fd, IORING_OFF_SQ_RING);
+    if (result->sq_ring == MAP_FAILED) { return nullptr; }
+
+    result->cq_ring = single_mapping
+      ? result->sq_ring
+      : ::mmap(nullptr, result->cq_ring_size, protection, flags, result->fd, IORING_OFF_CQ_RING);
+    if (result->cq_ring == MAP_FAILED) { return nullptr; }
+
+    result->sqes = static_cast<io_uring_sqe*>(::mmap(
+      nullptr, result->sqes_size, protection, flags, result->fd, IORING_OFF_SQES));
+    if (result->sqes == MAP_FAILED) { return nullptr; }
+
+    auto sq = static_cast<char*>(result->sq_ring);
+    result->sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    result->sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    result->sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    result->queued_tail = *result->sq_tail;
+
+    auto cq = static_cast<char*>(result->cq_ring);
+    result->cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    result->cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    result->cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    result->cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    return result;
+  }
+
+  /// Returns a cleared entry queued for submission.
+  ///
+  /// - Precondition: fewer entries than the capacity of the ring are queued.
+  io_uring_sqe& queue() {
+    auto i = queued_tail++ & sq_mask;
+    sq_array[i] = i;
+    sqes[i] = io_uring_sqe{};
+    return sqes[i];
+  }
+
+  /// Calls `complete(d, r)` with the user data and the result of each entry in the completion
+  /// queue, removes these entries from the queue, and returns their number.
+  template<typename F>
+  unsigned reap(F&& complete) {
+    auto head = *cq_head;
+    auto tail = std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire);
+    unsigned count = 0;
+    for (; head != tail; ++head, ++count) {
+      auto const& e = cqes[head & cq_mask];
+      complete(e.user_data, e.res);
+    }
+    std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+    return count;
+  }
+
+  /// Waits for `n` submitted entries to complete, calls `complete(d, r)` with the user data and the
+  /// result of each of them, and returns `true` iff they all completed.
+  template<typename F>
+  bool drain(unsigned n, F&& complete) {
+    while (n > 0) {
+      auto r = ::syscall(__NR_io_uring_enter, fd, 0, n, IORING_ENTER_GETEVENTS, nullptr, 0);
+      n -= reap(complete);
+      if ((r < 0) && (errno != EINTR)) { return n == 0; }
+    }
+    return true;
+  }
+
+  /// Submits the `n` entries queued since the last submission, waits for them to complete, calls
+  /// `complete(d, r)` with the user data and the result of each of them, and returns the number
+  /// of system calls made.
+  ///
+  /// If a submission fails, the entries that were already submitted are waited for, `complete` is
+  /// called for those that completed, and an exception is thrown; the ring must not be used
+  /// afterward. The kernel may still be processing some of these entries if `is_drained` is then
+  /// `false`, in which case the memory and file descriptors they refer to must not be released.
+  template<typename F>
+  std::size_t submit(unsigned n, F&& complete) {
+    std::atomic_ref<unsigned>(*sq_tail).store(queued_tail, std::memory_order_release);
+
+    std::size_t calls = 0;
+    unsigned submitted = 0;
+    unsigned completed = 0;
+    while (completed < n) {
+      auto r = ::syscall(
+        __NR_io_uring_enter, fd, n - submitted, n - completed, IORING_ENTER_GETEVENTS, nullptr, 0);
+      ++calls;
+      if (r < 0) {
+        if (errno == EINTR) { continue; }
+        completed += reap(complete);
+        is_drained = drain(submitted - completed, complete);
+        throw std::ios_base::failure("files could not be read");
+      }
+      submitted += static_cast<unsigned>(r);
+      completed += reap(complete);
+    }
+    return calls;
+  }
+
+};
+
+std::vector<bool> BatchReader::read_batch(
+  std::span<std::filesystem::path const> paths, std::span<std::uintmax_t const> sizes,
+  std::span<std::vector<uint8_t>> result
+) {
+  auto n = static_cast<unsigned>(paths.size());
+  std::vector<bool> failed(n, false);
+  std::vector<int> fds(n, -1);
+
+  // The operation of the current phase and the files for which it hasn't completed yet.
+  uint8_t operation = IORING_OP_OPENAT;
+  std::vector<bool> pending(n, false);
+
+  // Close the files that are still open when the batch ends, which is only the case if the ring
+  // failed before it could close them.
+  defer close_files([&]() {
+    for (auto fd : fds) {
+      if (fd < 0) { continue; }
+      ::close(fd);
+      ++_system_call_count;
+    }
+  });
+
+  try {
+    // Open all files.
+    for (unsigned i = 0; i < n; ++i) {
+      auto& e = ring->queue();
+      e.opcode = IORING_OP_OPENAT;
+      e.fd = AT_FDCWD;
+      e.addr = reinterpret_cast<uint64_t>(paths[i].c_str());
+      e.open_flags = O_RDONLY | O_CLOEXEC;
+      e.user_data = i;
+      pending[i] = true;
+    }
+    _system_call_count += ring->submit(n, [&](uint64_t i, int32_t r) {
+      pending[i] = false;
+      if (r >= 0) { fds[i] = r; } else { failed[i] = true; }
+    });
+
+    // Read the opened files, asking for one more byte than expected to detect files that grew.
+    operation = IORING_OP_READ;
+    unsigned m = 0;
+    for (unsigned i = 0; i < n; ++i) {
+      if (failed[i]) { continue; }
+      if (sizes[i] >= UINT32_MAX) {
+        failed[i] = true;
+        continue;
+      }
+      result[i].resize(static_cast<std::size_t>(sizes[i]) + 1);
+
+      auto& e = ring->queue();
+      e.opcode = IORING_OP_READ;
+      e.fd = fds[i];
+      e.addr = reinterpret_cast<uint64_t>(result[i].data());
+      e.len = static_cast<uint32_t>(result[i].size());
+      e.off = 0;
+      e.user_data = i;
+      pending[i] = true;
+      ++m;
+    }
+    _system_call_count += ring->submit(m, [&](uint64_t i, int32_t r) {
+      pending[i] = false;
+      if (static_cast<std::uintmax_t>(r) == sizes[i]) {
+        result[i].resize(static_cast<std::size_t>(r));
+      } else {
+        result[i] = {};
+        failed[i] = true;
+      }
+    });
+
+    // Close the files. A descriptor is released even if closing it reports an error.
+    operation = IORING_OP_CLOSE;
+    m = 0;
+    for (unsigned i = 0; i < n; ++i) {
+      if (fds[i] < 0) { continue; }
+      auto& e = ring->queue();
+      e.opcode = IORING_OP_CLOSE;
+      e.fd = fds[i];
+      e.user_data = i;
+      pending[i] = true;
+      ++m;
+    }
+    _system_call_count += ring->submit(m, [&](uint64_t i, int32_t) {
+      pending[i] = false;
+      fds[i] = -1;
+    });
+  } catch (std::ios_base::failure const&) {
+    // The kernel may still write to the buffers of the reads that didn't complete, or close the
+    // files whose closing didn't complete. The former are leaked rather than released, and the
+    // latter are not closed again. Files whose opening didn't complete can't be closed.
+    if (!ring->is_drained) {
+      for (unsigned i = 0; i < n; ++i) {
+        if (!pending[i]) { continue; }
+        if (operation == IORING_OP_READ) {
+          new std::vector<uint8_t>(std::move(result[i]));
+        } else if (operation == IORING_OP_CLOSE) {
+          fds[i] = -1;
+        }
+      }
+    }
+
+    // The queues are in an unknown state after a failed submission, so the ring is dropped and
+    // the files of this batch and of the following ones are read without it.
+    ring.reset();
+    std::fill(failed.begin(), failed.end(), true);
+  }
+
+  return failed;
+}
+
+#else
+
+struct BatchReader::Ring {};
+
+std::vector<bool> BatchReader::read_batch(
+  std::span<std::filesystem::path const>, std::span<std::uintmax_t const>,
+  std::span<std::vector<uint8_t>>
+) {
+  fatal_error("unreachable");
+}
+
+#endif
+
+#ifdef NIRC_HAS_POSIX_IO
+
+std::vector<uint8_t> BatchReader::read_one(std::filesystem::path const& path) {
+  auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  ++_system_call_count;
+  if (fd < 0) { throw std::ios_base::failure("file could not be opened"); }
+  defer close_file([&]() {
+    ::close(fd);
+    ++_system_call_count;
+  });
+
+  struct stat info;
+  ++_system_call_count;
+  if (::fstat(fd, &info) != 0) { throw std::ios_base::failure("file could not be opened"); }
+
+  std::vector<uint8_t> result(static_cast<std::size_t>(info.st_size));
+  std::size_t m = 0;
+  while (m < result.size()) {
+    auto k = ::pread(fd, result.data() + m, result.size() - m, static_cast<off_t>(m));
+    ++_system_call_count;
+    if (k > 0) {
+      m += static_cast<std::size_t>(k);
+    } else if (k == 0) {
+      break;
+    } else if (errno != EINTR) {
+      throw std::ios_base::failure("file could not be read");
+    }
+  }
+  result.resize(m);
+  return result;
+}
+
+#else
+
+std::vector<uint8_t> BatchReader::read_one(std::filesystem::path const& path) {
+  std::ifstream f(path, std::ios::binary | std::ios::ate);
+  if (f.fail()) { throw std::ios_base::failure("file could not be opened"); }
+
+  std::vector<uint8_t> result(static_cast<std::size_t>(f.tellg()));
+  f.seekg(0, std::ios::beg);
+  f.read(reinterpret_cast<char*>(result.data()), static_cast<std::streamsize>(result.size()));
+  if (f.fail()) { throw std::ios_base::failure("file could not be read"); }
+  return result;
+}
+
+#endif
+
+BatchReader::BatchReader(std::size_t capacity) : capacity(capacity), _system_call_count(0) {
+  precondition(capacity > 0, "capacity must be positive");
+#ifdef NIRC_HAS_IO_URING
+  ring = Ring::make(static_cast<unsigned>(std::bit_ceil(capacity)));
+#endif
+}
+
+BatchReader::BatchReader(BatchReader&&) = default;
+
+BatchReader::~BatchReader() = default;
+
+std::vector<std::vector<uint8_t>> BatchReader::read(
+  std::span<std::filesystem::path const> paths, std::span<std::uintmax_t const> sizes
+) {
+  precondition(paths.size() == sizes.size(), "sizes and paths must have the same length");
+  std::vector<std::vector<uint8_t>> result(paths.size());
+
+  for (std::size_t i = 0; i < paths.size(); i += capacity) {
+    auto n = std::min(capacity, paths.size() - i);
+    auto failed = (ring != nullptr)
+      ? read_batch(paths.subspan(i, n), sizes.subspan(i, n), std::span(result).subspan(i, n))
+      : std::vector<bool>(n, true);
+
+    // Files that couldn't be read through the ring are read again, which also reports the errors
+    // that prevented them from being read.
+    for (std::size_t k = 0; k < n; ++k) {
+      if (failed[k]) { result[i + k] = read_one(paths[i + k]); }
+    }
+  }
+  return result;
+}
+
+} // nir
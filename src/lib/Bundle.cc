@@ -0,0 +1,480 @@
+#include "Bundle.hh"
+#include "Decoder.hh"
+#include "Deserializer.hh"
+#include "Serializer.hh"
+#include "Utilities/Assert.hh"
+#include "Utilities/LittleEndian.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <tuple>
+#include <unordered_map>
+
+namespace nir {
+
+/// The first bytes of a bundle.
+inline constexpr char bundle_identifier[8] = {'N', 'I', 'R', 'P', 'A', 'C', 'K', '\0'};
+
+/// The version of the bundle format written by this implementation.
+inline constexpr uint32_t bundle_version = 2;
+
+/// The size of a bundle's header in bytes.
+inline constexpr std::size_t bundle_header_size = 88;
+
+/// The size of a string record in bytes.
+inline constexpr std::size_t string_record_size = 16;
+
+/// The size of a member record in bytes.
+inline constexpr std::size_t member_record_size = 24;
+
+/// The size of an index record in bytes.
+inline constexpr std::size_t entry_record_size = 40;
+
+/// The index of the signature of top-level symbols in index records.
+inline constexpr uint32_t no_signature = UINT32_MAX;
+
+/// Returns `n` rounded up to the next multiple of 8.
+inline uint64_t aligned(uint64_t n) {
+  return (n + 7) & ~uint64_t{7};
+}
+
+/// Returns the identifier of the top-level symbol of `s` and that of its signature, if any.
+inline std::pair<std::string_view, std::optional<std::string_view>> key_of(
+  Symbol const& s
+) {
+  if (auto m = s.as<symbol::Member>()) {
+    return {m->top().id(), m->signature().mangled_name};
+  } else if (auto t = s.as<symbol::Top>()) {
+    return {t->id(), std::nullopt};
+  } else {
+    return {std::string_view(), std::nullopt};
+  }
+}
+
+/// The contents of an index record before it is written.
+struct EntryRecord {
+
+  /// The index of the identifier of the symbol's top-level symbol in the string table.
+  uint32_t top;
+
+  /// The index of the identifier of the symbol's signature in the string table, or `no_signature`.
+  uint32_t signature;
+
+  /// The index of the member defining the symbol.
+  uint32_t member;
+
+  /// The index of the definition in its member.
+  uint32_t index;
+
+  /// The kind of the definition.
+  uint32_t tag;
+
+  /// The offset of the definition's first byte in its member.
+  uint64_t start;
+
+  /// The offset past the definition's last byte in its member.
+  uint64_t end;
+
+};
+
+/// A table of unique strings, under construction.
+struct StringTable {
+
+  /// The strings in the table, in the order in which they were inserted.
+  std::vector<std::string> values;
+
+  /// A map from a string to its index in `values`.
+  std::unordered_map<std::string, uint32_t> indices;
+
+  /// Inserts `s` in the table if it isn't already there and returns its index.
+  uint32_t insert(std::string_view s) {
+    auto [i, inserted] = indices.emplace(std::string(s), static_cast<uint32_t>(values.size()));
+    if (inserted) { values.emplace_back(s); }
+    return i->second;
+  }
+
+  /// Returns the key of the symbol identified by the strings at indices `top` and `signature`.
+  std::pair<std::string_view, std::optional<std::string_view>> key(
+    uint32_t top, uint32_t signature
+  ) const {
+    if (signature == no_signature) {
+      return {values[top], std::nullopt};
+    } else {
+      return {values[top], std::string_view(values[signature])};
+    }
+  }
+
+};
+
+/// The entities of type `T` interned by the members of a bundle, along with the number of members
+/// interning each of them.
+template<typename T>
+struct Occurrences {
+
+  /// The entities, in the order in which they were first inserted.
+  std::vector<T> values;
+
+  /// A map from each entity to the number of members interning it.
+  std::unordered_map<T, std::size_t> counts;
+
+  /// Records that a member interns `v`.
+  void insert(T const& v) {
+    if (counts[v]++ == 0) { values.push_back(v); }
+  }
+
+  /// Returns the entities interned by more than one member, in the order of their insertion.
+  std::vector<T> shared() const {
+    std::vector<T> result;
+    for (auto const& v : values) {
+      if (counts.at(v) > 1) { result.push_back(v); }
+    }
+    return result;
+  }
+
+};
+
+/// Writes the contents of `f` with `s`.
+inline void encode(Serializer& s, File const& f) {
+  s.header(f.header);
+  for (auto const& d : f.definitions) { s.definition(d); }
+}
+
+/// The decoded prelude of a bundle, which keeps the bytes and the strings it interns alive.
+struct Bundle::Prelude {
+
+  /// The storage of the bytes of the prelude.
+  std::shared_ptr<void const> storage;
+
+  /// The source from which the prelude is decoded.
+  Decoder source;
+
+  /// The deserializer holding the entities interned by the prelude.
+  Deserializer deserializer;
+
+  /// Decodes the prelude of a bundle whose layout is `layout` from `bytes`, which are kept alive by
+  /// `storage`, throwing an exception if that fails.
+  Prelude(
+    std::shared_ptr<void const> storage, std::span<const uint8_t> bytes, Layout const& layout
+  ) :
+    storage(storage),
+    source(std::move(storage), bytes.subspan(layout.prelude, layout.prelude_size)),
+    deserializer(source)
+  {
+    for (uint32_t i = 0; i < layout.prelude_string_count; ++i) { deserializer.string(); }
+    for (uint32_t i = 0; i < layout.prelude_symbol_count; ++i) { deserializer.symbol(); }
+    source.check();
+    if (!source.is_empty()) {
+      throw DecoderError(layout.prelude + source.current_position(), "invalid bundle prelude");
+    }
+  }
+
+};
+
+void Bundle::pack(
+  std::vector<std::filesystem::path> const& paths, std::filesystem::path const& output
+) {
+  std::vector<File> files;
+  for (auto const& p : paths) { files.push_back(File::from_contents_of(p.string())); }
+
+  // Encode each file on its own to find the strings and symbols that several of them intern.
+  Occurrences<std::string> interned_strings;
+  Occurrences<Symbol> interned_symbols;
+  for (auto const& f : files) {
+    std::vector<uint8_t> scratch;
+    Serializer s(scratch);
+    encode(s, f);
+
+    for (auto v : s.interned_strings) { interned_strings.insert(std::string(v)); }
+    std::vector<std::pair<std::size_t, Symbol>> symbols;
+    for (auto const& [v, i] : s.interned_symbols) { symbols.emplace_back(i, v); }
+    std::sort(symbols.begin(), symbols.end(), [](auto const& a, auto const& b) {
+      return a.first < b.first;
+    });
+    for (auto const& [i, v] : symbols) { interned_symbols.insert(v); }
+  }
+
+  // Write the shared entities in the prelude, interning them in `prelude`.
+  auto shared_strings = interned_strings.shared();
+  auto shared_symbols = interned_symbols.shared();
+  std::vector<uint8_t> prelude_bytes;
+  Serializer prelude(prelude_bytes);
+  for (auto const& v : shared_strings) { prelude.string(v); }
+  for (auto const& v : shared_symbols) { prelude.symbol(v); }
+
+  // Encode each file again, starting from the tables of the prelude.
+  StringTable strings;
+  std::vector<uint32_t> member_paths;
+  std::vector<uint32_t> member_definition_counts;
+  std::vector<std::vector<uint8_t>> members;
+  std::vector<EntryRecord> entries;
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    std::vector<uint8_t> contents;
+    Serializer s(contents, prelude);
+    s.header(files[i].header);
+
+    member_paths.push_back(strings.insert(paths[i].string()));
+    member_definition_counts.push_back(static_cast<uint32_t>(files[i].definitions.size()));
+    for (std::size_t j = 0; j < files[i].definitions.size(); ++j) {
+      auto const& d = files[i].definitions[j];
+      auto start = contents.size();
+      s.definition(d);
+
+      // The encoding of a definition starts with its tag.
+      auto [top, signature] = key_of(d.name());
+      entries.push_back(EntryRecord{
+        strings.insert(top),
+        signature.has_value() ? strings.insert(*signature) : no_signature,
+        static_cast<uint32_t>(i),
+        static_cast<uint32_t>(j),
+        contents[start],
+        start,
+        contents.size()
+      });
+    }
+    members.push_back(std::move(contents));
+  }
+
+  // Entries with the same symbol are kept in the order of the members defining them.
+  std::stable_sort(entries.begin(), entries.end(), [&](auto const& a, auto const& b) {
+    return strings.key(a.top, a.signature) < strings.key(b.top, b.signature);
+  });
+
+  // Compute the layout of the bundle.
+  Layout layout;
+  layout.member_count = static_cast<uint32_t>(members.size());
+  layout.string_count = static_cast<uint32_t>(strings.values.size());
+  layout.entry_count = static_cast<uint32_t>(entries.size());
+  layout.strings = bundle_header_size;
+  layout.members = layout.strings + string_record_size * layout.string_count;
+  layout.entries = layout.members + member_record_size * layout.member_count;
+  layout.characters = layout.entries + entry_record_size * layout.entry_count;
+
+  uint64_t size = layout.characters;
+  for (auto const& s : strings.values) { size += s.size(); }
+  layout.prelude_string_count = static_cast<uint32_t>(shared_strings.size());
+  layout.prelude_symbol_count = static_cast<uint32_t>(shared_symbols.size());
+  layout.prelude = size;
+  layout.prelude_size = prelude_bytes.size();
+  size += prelude_bytes.size();
+
+  std::vector<uint64_t> member_offsets;
+  for (auto const& m : members) {
+    size = aligned(size);
+    member_offsets.push_back(size);
+    size += m.size();
+  }
+  layout.size = size;
+
+  // Write the bundle.
+  std::vector<uint8_t> bytes(size, 0);
+  auto p = bytes.data();
+  std::memcpy(p, bundle_identifier, sizeof(bundle_identifier));
+  write_le(p + 8, bundle_version);
+  write_le(p + 12, layout.member_count);
+  write_le(p + 16, layout.string_count);
+  write_le(p + 20, layout.entry_count);
+  write_le(p + 24, layout.strings);
+  write_le(p + 32, layout.members);
+  write_le(p + 40, layout.entries);
+  write_le(p + 48, layout.characters);
+  write_le(p + 56, layout.size);
+  write_le(p + 64, layout.prelude_string_count);
+  write_le(p + 68, layout.prelude_symbol_count);
+  write_le(p + 72, layout.prelude);
+  write_le(p + 80, layout.prelude_size);
+
+  uint64_t offset = layout.characters;
+  for (std::size_t i = 0; i < strings.values.size(); ++i) {
+    auto const& s = strings.values[i];
+    write_le(p + layout.strings + string_record_size * i, offset);
+    write_le(p + layout.strings + string_record_size * i + 8, static_cast<uint64_t>(s.size()));
+    std::memcpy(p + offset, s.data(), s.size());
+    offset += s.size();
+  }
+  if (!prelude_bytes.empty()) {
+    std::memcpy(p + layout.prelude, prelude_bytes.data(), prelude_bytes.size());
+  }
+
+  for (std::size_t i = 0; i < members.size(); ++i) {
+    auto r = p + layout.members + member_record_size * i;
+    auto const& c = members[i];
+    write_le(r, member_paths[i]);
+    write_le(r + 4, member_definition_counts[i]);
+    write_le(r + 8, member_offsets[i]);
+    write_le(r + 16, static_cast<uint64_t>(c.size()));
+    if (!c.empty()) { std::memcpy(p + member_offsets[i], c.data(), c.size()); }
+  }
+
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    auto r = p + layout.entries + entry_record_size * i;
+    auto const& e = entries[i];
+    write_le(r, e.top);
+    write_le(r + 4, e.signature);
+    write_le(r + 8, e.member);
+    write_le(r + 12, e.index);
+    write_le(r + 16, e.tag);
+    write_le(r + 24, e.start);
+    write_le(r + 32, e.end);
+  }
+
+  std::ofstream f(output, std::ios::binary | std::ios::trunc);
+  if (f.fail()) { throw std::ios_base::failure("bundle could not be created"); }
+  f.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (f.fail()) { throw std::ios_base::failure("bundle could not be written"); }
+}
+
+/// Throws an error diagnosed by `d` if `condition` doesn't hold.
+inline void expect_valid(bool condition, std::size_t offset, char const* d) {
+  if (!condition) { throw DecoderError(offset, d); }
+}
+
+Bundle Bundle::open(std::string const& path) {
+  auto mapping = std::make_shared<MappedFile const>(path);
+  auto bytes = mapping->contents();
+  auto p = bytes.data();
+
+  expect_valid(bytes.size() >= bundle_header_size, 0, "invalid bundle format");
+  expect_valid(
+    std::memcmp(p, bundle_identifier, sizeof(bundle_identifier)) == 0, 0, "invalid bundle format");
+  expect_valid(read_le<uint32_t>(p + 8) == bundle_version, 8, "unsupported bundle version");
+
+  Layout layout;
+  layout.member_count = read_le<uint32_t>(p + 12);
+  layout.string_count = read_le<uint32_t>(p + 16);
+  layout.entry_count = read_le<uint32_t>(p + 20);
+  layout.strings = read_le<uint64_t>(p + 24);
+  layout.members = read_le<uint64_t>(p + 32);
+  layout.entries = read_le<uint64_t>(p + 40);
+  layout.characters = read_le<uint64_t>(p + 48);
+  layout.size = read_le<uint64_t>(p + 56);
+  layout.prelude_string_count = read_le<uint32_t>(p + 64);
+  layout.prelude_symbol_count = read_le<uint32_t>(p + 68);
+  layout.prelude = read_le<uint64_t>(p + 72);
+  layout.prelude_size = read_le<uint64_t>(p + 80);
+
+  // Check that the sections are in bounds, so that the records can then be read without checks.
+  // The sections are contiguous, so their sizes can't overflow if their ends are in order.
+  auto size = static_cast<uint64_t>(bytes.size());
+  expect_valid(layout.size == size, 56, "truncated bundle");
+  expect_valid(
+    (layout.strings == bundle_header_size) &&
+    (layout.members == layout.strings + string_record_size * layout.string_count) &&
+    (layout.entries == layout.members + member_record_size * layout.member_count) &&
+    (layout.characters == layout.entries + entry_record_size * layout.entry_count) &&
+    (layout.characters <= size) &&
+    (layout.prelude >= layout.characters) && (layout.prelude <= size) &&
+    (layout.prelude_size <= size - layout.prelude),
+    24, "invalid bundle layout");
+
+  for (uint64_t i = 0; i < layout.string_count; ++i) {
+    auto r = layout.strings + string_record_size * i;
+    auto o = read_le<uint64_t>(p + r);
+    auto n = read_le<uint64_t>(p + r + 8);
+    expect_valid((o >= layout.characters) && (o <= size) && (n <= size - o), r, "invalid string");
+  }
+
+  for (uint64_t i = 0; i < layout.member_count; ++i) {
+    auto r = layout.members + member_record_size * i;
+    auto o = read_le<uint64_t>(p + r + 8);
+    auto n = read_le<uint64_t>(p + r + 16);
+    expect_valid(read_le<uint32_t>(p + r) < layout.string_count, r, "invalid member");
+    expect_valid((o <= size) && (n <= size - o), r, "invalid member");
+  }
+
+  for (uint64_t i = 0; i < layout.entry_count; ++i) {
+    auto r = layout.entries + entry_record_size * i;
+    auto s = read_le<uint32_t>(p + r + 4);
+    auto m = read_le<uint32_t>(p + r + 8);
+    expect_valid(
+      (read_le<uint32_t>(p + r) < layout.string_count) &&
+      ((s == no_signature) || (s < layout.string_count)) &&
+      (m < layout.member_count) &&
+      (read_le<uint32_t>(p + r + 16) <= static_cast<uint32_t>(raw_value(tag::Definition::module))),
+      r, "invalid index entry");
+
+    auto member_size = read_le<uint64_t>(p + layout.members + member_record_size * m + 16);
+    auto start = read_le<uint64_t>(p + r + 24);
+    auto end = read_le<uint64_t>(p + r + 32);
+    expect_valid((start <= end) && (end <= member_size), r, "invalid index entry");
+  }
+
+  auto prelude = std::make_shared<Prelude const>(mapping, bytes, layout);
+  return Bundle(std::move(mapping), std::move(prelude), layout);
+}
+
+Bundle::Bundle(
+  std::shared_ptr<MappedFile const> mapping, std::shared_ptr<Prelude const> prelude,
+  Layout const& layout
+) :
+  mapping(std::move(mapping)), prelude(std::move(prelude)), bytes(this->mapping->contents()),
+  layout(layout)
+{}
+
+std::string_view Bundle::string(uint32_t i) const {
+  auto r = bytes.data() + layout.strings + string_record_size * i;
+  auto o = read_le<uint64_t>(r);
+  auto n = read_le<uint64_t>(r + 8);
+  return std::string_view(reinterpret_cast<char const*>(bytes.data() + o), n);
+}
+
+std::string_view Bundle::path(std::size_t i) const {
+  precondition(i < layout.member_count, "index is out of bounds");
+  return string(read_le<uint32_t>(bytes.data() + layout.members + member_record_size * i));
+}
+
+std::span<const uint8_t> Bundle::contents(std::size_t i) const {
+  precondition(i < layout.member_count, "index is out of bounds");
+  auto r = bytes.data() + layout.members + member_record_size * i;
+  return bytes.subspan(read_le<uint64_t>(r + 8), read_le<uint64_t>(r + 16));
+}
+
+std::size_t Bundle::lower_bound(
+  std::string_view top, std::optional<std::string_view> signature
+) const {
+  auto key = std::make_pair(top, signature);
+  std::size_t low = 0;
+  std::size_t high = layout.entry_count;
+  while (low < high) {
+    auto middle = low + (high - low) / 2;
+    auto r = bytes.data() + layout.entries + entry_record_size * middle;
+    auto s = read_le<uint32_t>(r + 4);
+    auto k = std::make_pair(
+      string(read_le<uint32_t>(r)),
+      (s == no_signature) ? std::nullopt : std::optional<std::string_view>(string(s)));
+    if (k < key) { low = middle + 1; } else { high = middle; }
+  }
+  return low;
+}
+
+std::optional<Bundle::Location> Bundle::find(Symbol const& name) const {
+  auto [top, signature] = key_of(name);
+  auto i = lower_bound(top, signature);
+  if (i == layout.entry_count) { return std::nullopt; }
+
+  auto r = bytes.data() + layout.entries + entry_record_size * i;
+  auto s = read_le<uint32_t>(r + 4);
+  if (string(read_le<uint32_t>(r)) != top) { return std::nullopt; }
+  if ((s == no_signature) != !signature.has_value()) { return std::nullopt; }
+  if (signature.has_value() && (string(s) != *signature)) { return std::nullopt; }
+
+  return Location{
+    read_le<uint32_t>(r + 8),
+    read_le<uint32_t>(r + 12),
+    static_cast<tag::Definition>(read_le<uint32_t>(r + 16)),
+    read_le<uint64_t>(r + 24),
+    read_le<uint64_t>(r + 32)
+  };
+}
+
+File Bundle::load(std::size_t i, DecodingOptions const& options) const {
+  // The decoder keeps the prelude alive, along with the mapping and the strings it interns.
+  return File::from_decoder(Decoder(prelude, contents(i)), options, &prelude->deserializer);
+}
+
+LazyFile Bundle::load_lazily(std::size_t i) const {
+  return LazyFile(Decoder(prelude, contents(i)), &prelude->deserializer);
+}
+
+} // nir
@@ -1,53 +1,137 @@
 #include "Decoder.hh"
+#include "LEB128.hh"
+#include "MappedFile.hh"
 
 #include <algorithm>
+#include <cerrno>
 #include <fstream>
 
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#define NIRC_HAS_POSIX_IO 1
+#endif
+
 namespace nir {
 
-Decoder::Decoder(std::string const& path) : position{0}, byte_order{std::endian::native} {
-  std::ifstream f(path, std::ios::binary);
-  if (f.fail()) { throw std::ios_base::failure("file could not be opened"); }
+std::string description(DecoderFailure f) {
+  switch (f) {
+    case DecoderFailure::none:
+      return "no failure";
+    case DecoderFailure::not_enough_bytes:
+      return "not enough bytes";
+    case DecoderFailure::signed_leb128_overflow:
+      return "signed LEB128 too big for a 64-bit signed integer";
+    case DecoderFailure::unsigned_leb128_overflow:
+      return "unsigned LEB128 too big for a 64-bit unsigned integer";
+    case DecoderFailure::invalid_reference:
+      return "invalid back-reference";
+    case DecoderFailure::local_overflow:
+      return "local identifier too big to be represented";
+    default:
+      fatal_error("unreachable");
+  }
+}
 
-  // Don't skip leading whitespaces.
-  f.unsetf(std::ios::skipws);
+Decoder::Decoder(std::shared_ptr<void const> storage, std::span<const uint8_t> source) :
+  storage(std::move(storage)), source(source), position{0}, window_offset{0},
+  failure{DecoderFailure::none}, failure_position{0},
+  byte_order{std::endian::native}
+{}
+
+Decoder::Decoder(std::string const& path) :
+  position{0}, window_offset{0}, failure{DecoderFailure::none}, failure_position{0},
+  byte_order{std::endian::native}
+{
+  std::ifstream f(path, std::ios::binary | std::ios::ate);
+  if (f.fail()) { throw std::ios_base::failure("file could not be opened"); }
 
   // Get the size of the file.
-  f.seekg(0, std::ios::end);
-  auto byte_count = f.tellg();
+  auto byte_count = static_cast<std::size_t>(f.tellg());
   f.seekg(0, std::ios::beg);
 
   // Copy the bytes.
-  std::istream_iterator<uint8_t> b(f), e;
-  source.reserve(byte_count);
-  source.insert(source.begin(), b, e);
-}
-
-/// Reads enough bytes from `source` starting at `position` to form an instance of `T`, which
-/// denotes a fixed-width binary numeric, interpreting bytes with the given `byte_order`.
-template<typename T>
-Result<T> numeric(
-  const std::vector<uint8_t>& source, std::size_t& position, std::endian byte_order
-) {
-  if ((position + sizeof(T)) > source.size()) {
-    return Result<T>::failure(DecoderError(position, "not enough bytes"));
-  }
+  auto bytes = std::make_shared<std::vector<uint8_t>>(byte_count);
+  f.read(reinterpret_cast<char*>(bytes->data()), static_cast<std::streamsize>(byte_count));
+  if (f.fail()) { throw std::ios_base::failure("file could not be read"); }
+
+  source = std::span<const uint8_t>(bytes->data(), bytes->size());
+  storage = std::move(bytes);
+}
 
-  alignas(T) uint8_t bytes[sizeof(T)];
-  for (std::size_t i = 0; i < sizeof(T); ++i) {
-    bytes[i] = source[position + i];
+Decoder::Decoder(std::span<const uint8_t> bytes) : Decoder(nullptr, bytes) {}
+
+Decoder::Decoder(std::vector<uint8_t>&& bytes) : Decoder(nullptr, {}) {
+  auto b = std::make_shared<std::vector<uint8_t>>(std::move(bytes));
+  source = std::span<const uint8_t>(b->data(), b->size());
+  storage = std::move(b);
+}
+
+Decoder Decoder::mapping_contents_of(std::string const& path) {
+  auto m = std::make_shared<MappedFile const>(path);
+  auto s = m->contents();
+  return Decoder(std::move(m), s);
+}
+
+Decoder Decoder::streaming(Refill refill, std::size_t capacity) {
+  precondition(capacity >= 64, "window is too small");
+  Decoder result(nullptr, {});
+  result.refill = std::move(refill);
+  result.window.resize(capacity);
+  result.source = std::span<const uint8_t>(result.window.data(), 0);
+  return result;
+}
+
+Decoder Decoder::streaming_contents_of(int fd, std::size_t capacity) {
+#ifdef NIRC_HAS_POSIX_IO
+  return streaming([fd](uint8_t* o, std::size_t n) -> std::size_t {
+    while (true) {
+      auto m = ::read(fd, o, n);
+      if (m >= 0) { return static_cast<std::size_t>(m); }
+      if (errno != EINTR) { throw std::ios_base::failure("file could not be read"); }
+    }
+  }, capacity);
+#else
+  (void)fd;
+  (void)capacity;
+  throw std::ios_base::failure("file descriptors are not supported on this platform");
+#endif
+}
+
+Decoder Decoder::fork() const {
+  precondition(!is_streaming(), "streaming decoders can't be forked");
+  Decoder result(storage, source);
+  result.position = position;
+  result.byte_order = byte_order;
+  return result;
+}
+
+bool Decoder::fill(std::size_t n) {
+  auto remaining = source.size() - position;
+  if (remaining >= n) { return true; }
+  if (!refill) { return false; }
+  precondition(n <= window.size(), "window is too small");
+
+  // Discard the bytes that have been consumed.
+  if (position > 0) {
+    std::memmove(window.data(), window.data() + position, remaining);
+    window_offset += position;
+    position = 0;
   }
 
-  if (byte_order != std::endian::native) {
-    std::reverse(std::begin(bytes), std::end(bytes));
+  // Read as many bytes as the window can hold, stopping early only at the end of the stream.
+  auto filled = remaining;
+  while (filled < n) {
+    auto m = refill(window.data() + filled, window.size() - filled);
+    if (m == 0) { break; }
+    filled += m;
   }
 
-  position += sizeof(T);
-  return Result<T>::success(*static_cast<T*>(static_cast<void*>(bytes)));
+  source = std::span<const uint8_t>(window.data(), filled);
+  return filled >= n;
 }
 
 std::optional<int8_t> Decoder::peek() {
-  if (position < source.size()) {
+  if ((position < source.size()) || fill(1)) {
     return source[position];
   } else {
     return std::nullopt;
@@ -55,74 +139,144 @@ std::optional<int8_t> Decoder::peek() {
 }
 
 Result<uint8_t> Decoder::u8() {
-  return numeric<uint8_t>(source, position, byte_order);
+  return checked<uint8_t>([this]() { return read_u8(); });
 }
 
 Result<int8_t> Decoder::i8() {
-  return numeric<int8_t>(source, position, byte_order);
+  return checked<int8_t>([this]() { return read_i8(); });
 }
 
 Result<uint32_t> Decoder::u32() {
-  return numeric<uint32_t>(source, position, byte_order);
+  return checked<uint32_t>([this]() { return read_u32(); });
 }
 
 Result<int32_t> Decoder::i32() {
-  return numeric<int32_t>(source, position, byte_order);
+  return checked<int32_t>([this]() { return read_i32(); });
 }
 
 Result<float> Decoder::f32() {
-  return numeric<float>(source, position, byte_order);
+  return checked<float>([this]() { return read_f32(); });
 }
 
 Result<double> Decoder::f64() {
-  return numeric<double>(source, position, byte_order);
+  return checked<double>([this]() { return read_f64(); });
 }
 
 Result<int64_t> Decoder::signed_leb128() {
-  int64_t value = 0;
-  int64_t shift = 0;
+  return checked<int64_t>([this]() { return read_signed_leb128(); });
+}
 
-  while (true) {
-    const auto b = u8();
-    if (!b.is_success()) { return fail<int64_t>("ill-formed signed LEB128"); }
+Result<uint64_t> Decoder::unsigned_leb128() {
+  return checked<uint64_t>([this]() { return read_unsigned_leb128(); });
+}
+
+/// The maximum number of bytes in the LEB128 encoding of a 64-bit integer.
+constexpr std::size_t max_leb128_size = 10;
+
+int64_t Decoder::read_signed_leb128_slow() {
+  fill(max_leb128_size);
+
+  // Fast path: the value is encoded on at most 8 bytes, which can be decoded at once.
+  if ((source.size() - position) >= 8) {
+    int64_t v;
+    auto n = leb128::decode_short_signed(source.data() + position, v);
+    if (n != 0) {
+      position += n;
+      return v;
+    }
+  }
+
+  uint64_t value = 0;
+  unsigned shift = 0;
+  uint8_t b = 0;
+
+  // Bounds are checked once if the longest valid encoding fits in the remaining bytes. Otherwise,
+  // the window already holds all the bytes left in the stream.
+  const bool is_bounded = (source.size() - position) >= max_leb128_size;
 
-    int64_t slice = b.get() & 0x7f;
+  do {
+    if ((!is_bounded || (shift > 63)) && (position == source.size())) {
+      record(DecoderFailure::not_enough_bytes);
+      return 0;
+    }
+
+    b = source[position++];
+    uint64_t slice = b & 0x7f;
     if (
       (shift == 63 && slice != 0 && slice != 0x7f) ||
-      (shift > 63 && slice != (value < 0 ? 0x7f : 0x00))
-    ) { return fail<int64_t>("signed LEB128 too big for a 64-bit signed integer"); }
+      (shift > 63 && slice != ((static_cast<int64_t>(value) < 0) ? 0x7f : 0x00))
+    ) {
+      record(DecoderFailure::signed_leb128_overflow);
+      return 0;
+    }
 
-    value |= slice << shift;
+    if (shift < 64) { value |= slice << shift; }
     shift += 7;
+  } while (b & 0x80);
 
-    if (((b.get() & 0x80) >> 7) == 0) {
-      if ((shift < 64) && (b.get() & 0x40)) {
-        return Result<int64_t>::success(value | -(1 << shift));
-      } else {
-        return Result<int64_t>::success(value);
-      }
+  // Sign-extend the result if necessary.
+  if ((shift < 64) && (b & 0x40)) { value |= ~uint64_t{0} << shift; }
+  return static_cast<int64_t>(value);
+}
+
+uint64_t Decoder::read_unsigned_leb128_slow() {
+  fill(max_leb128_size);
+
+  // Fast path: the value is encoded on at most 8 bytes, which can be decoded at once.
+  if ((source.size() - position) >= 8) {
+    uint64_t v;
+    auto n = leb128::decode_short_unsigned(source.data() + position, v);
+    if (n != 0) {
+      position += n;
+      return v;
     }
   }
-}
 
-Result<uint64_t> Decoder::unsigned_leb128() {
-  int64_t value = 0;
-  int64_t shift = 0;
+  uint64_t value = 0;
+  unsigned shift = 0;
+  uint8_t b = 0;
 
-  while (true) {
-    const auto b = u8();
-    if (!b.is_success()) { return fail<uint64_t>("ill-formed unsigned LEB128"); }
+  // Bounds are checked once if the longest valid encoding fits in the remaining bytes. Otherwise,
+  // the window already holds all the bytes left in the stream.
+  const bool is_bounded = (source.size() - position) >= max_leb128_size;
 
-    int64_t slice = b.get() & 0x7f;
-    if (
-      (shift == 63 && (slice << shift >> shift) != slice) ||
-      (shift > 63 && slice != 0)
-    ) { return fail<uint64_t>("unsigned LEB128 too big for a 64-bit unsigned integer"); }
+  do {
+    if ((!is_bounded || (shift > 63)) && (position == source.size())) {
+      record(DecoderFailure::not_enough_bytes);
+      return 0;
+    }
+
+    b = source[position++];
+    uint64_t slice = b & 0x7f;
+    if ((shift == 63 && slice > 1) || (shift > 63 && slice != 0)) {
+      record(DecoderFailure::unsigned_leb128_overflow);
+      return 0;
+    }
 
-    value += slice << shift;
-    if ((b.get() >> 7) == 0) { return Result<uint64_t>::success(value); }
+    if (shift < 64) { value |= slice << shift; }
     shift += 7;
+  } while (b & 0x80);
+
+  return value;
+}
+
+std::size_t Decoder::read_unsigned_leb128s(std::size_t n, uint64_t* o) {
+  std::size_t i = 0;
+  while (i < n) {
+    // Decode as many values as possible in bulk.
+    fill(leb128::slack);
+    auto p = source.data() + position;
+    i += leb128::decode_unsigned(p, source.data() + source.size(), n - i, o + i);
+    position = static_cast<std::size_t>(p - source.data());
+
+    // Decode the value on which bulk decoding stopped, if any, with the checked decoder.
+    if (i < n) {
+      auto v = read_unsigned_leb128();
+      if (has_failed()) { break; }
+      o[i++] = v;
+    }
   }
+  return i;
 }
 
 Result<std::string> Decoder::nullterminated_string() {
@@ -144,8 +298,47 @@ Result<std::string> Decoder::nullterminated_string() {
 
 std::size_t Decoder::bytes(std::size_t n, int8_t* o) {
   std::size_t m = 0;
-  while ((m < n) && !is_empty()) { o[m++] = source[position++]; }
+  while ((m < n) && ((position < source.size()) || fill(1))) {
+    auto k = std::min(n - m, source.size() - position);
+    std::memcpy(o + m, source.data() + position, k);
+    position += k;
+    m += k;
+  }
+  return m;
+}
+
+std::size_t Decoder::skip(std::size_t n) {
+  std::size_t m = 0;
+  while ((m < n) && ((position < source.size()) || fill(1))) {
+    auto k = std::min(n - m, source.size() - position);
+    position += k;
+    m += k;
+  }
   return m;
 }
 
+std::optional<std::span<const uint8_t>> Decoder::borrow(std::size_t n) {
+  if (is_streaming()) { return std::nullopt; }
+  if (n > source.size() - position) {
+    record(DecoderFailure::not_enough_bytes);
+    position = source.size();
+    return std::span<const uint8_t>();
+  }
+
+  auto result = source.subspan(position, n);
+  position += n;
+  return result;
+}
+
+void Decoder::skip_leb128s(std::size_t n) {
+  // Only the last byte of a value has its most significant bit cleared.
+  while (n > 0) {
+    if ((position == source.size()) && !fill(1)) {
+      record(DecoderFailure::not_enough_bytes);
+      return;
+    }
+    if (source[position++] < 0x80) { --n; }
+  }
+}
+
 } // nir
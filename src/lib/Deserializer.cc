@@ -3,6 +3,8 @@
 #include "Utilities/Assert.hh"
 
 #include <algorithm>
+#include <iterator>
+#include <string>
 
 // TODO: Debug
 #include <iostream>
@@ -20,7 +22,7 @@ template<typename T, typename U>
 std::vector<T> narrowed_sequence(std::vector<U> const& s) {
   std::vector<T> r;
   r.reserve(s.size());
-  std::transform(s.begin(), s.end(), r.begin(), [](auto const& e) {
+  std::transform(s.begin(), s.end(), std::back_inserter(r), [](auto const& e) {
     return e.template as<T>().value();
   });
   return r;
@@ -29,28 +31,49 @@ std::vector<T> narrowed_sequence(std::vector<U> const& s) {
 template<typename T, typename F>
 requires std::invocable<F, Deserializer&>
 std::vector<T> Deserializer::sequence(F&& decode) {
-  auto s = source.unsigned_leb128().get();
+  auto s = source.read_unsigned_leb128();
   std::vector<T> result;
-  result.reserve(s);
 
-  for (std::size_t i = 0; i < s; ++i) {
+  // Each element is encoded on at least one byte.
+  result.reserve(std::min<std::size_t>(s, source.source_size() - source.current_position()));
+
+  for (std::size_t i = 0; (i < s) && !source.has_failed(); ++i) {
     result.push_back(decode(*this));
   }
 
   return result;
 }
 
+/// Returns the entity of type `T` standing for a back-reference to an entry that doesn't exist.
+template<typename T>
+T placeholder();
+
+template<>
+Symbol placeholder<Symbol>() { return Symbol::none(); }
+
+template<>
+Type placeholder<Type>() { return Type::unit(); }
+
+template<>
+Value placeholder<Value>() { return Value(value::Unit()); }
+
 template<typename T, typename F>
 requires std::invocable<F, Deserializer&>
-T Deserializer::internable(std::vector<T>& memo, F&& decode) {
+T Deserializer::internable(InterningTable<T>& memo, F&& decode) {
   if (source.peek() == -1) {
-    source.u8();
-    return memo[source.unsigned_leb128().get()];
+    source.read_u8();
+    auto i = source.read_unsigned_leb128();
+    if (i < memo.size()) {
+      return memo[i];
+    } else {
+      source.record(DecoderFailure::invalid_reference);
+      return placeholder<T>();
+    }
   } else {
     auto p = source.current_position();
     auto v = decode(*this);
     if (source.current_position() > (p + 2)) {
-      memo.push_back(v);
+      memo.insert(v);
     }
     return v;
   }
@@ -66,9 +89,32 @@ std::optional<T> Deserializer::optional(F&& decode) {
   }
 }
 
+void Deserializer::extend(Deserializer const& prelude) {
+  interned_strings = prelude.interned_strings.extended();
+  interned_symbols = prelude.interned_symbols.extended();
+  interned_types = prelude.interned_types.extended();
+  interned_values = prelude.interned_values.extended();
+}
+
+Deserializer::Checkpoint Deserializer::checkpoint() const {
+  return Checkpoint{
+    interned_strings.size(),
+    interned_symbols.size(),
+    interned_types.size(),
+    interned_values.size()
+  };
+}
+
+void Deserializer::restore(Checkpoint const& c) {
+  interned_strings.truncate(c.strings);
+  interned_symbols.truncate(c.symbols);
+  interned_types.truncate(c.types);
+  interned_values.truncate(c.values);
+}
+
 Symbol Deserializer::symbol() {
   return internable<Symbol>(interned_symbols, [](auto& self) {
-    switch (self.source.u8().get()) {
+    switch (self.source.read_u8()) {
       case raw_value(tag::Symbol::none):
         return Symbol::none();
 
@@ -92,7 +138,13 @@ Signature Deserializer::signature() {
 }
 
 Definition Deserializer::definition() {
-  auto tag = source.u8().get();
+  auto result = unchecked_definition();
+  source.check();
+  return result;
+}
+
+Definition Deserializer::unchecked_definition() {
+  auto tag = source.read_u8();
   auto attributes = AttributeSet::contents_of(
     sequence<Attribute>([](auto& self) { return self.attribute(); }));
 
@@ -157,13 +209,76 @@ Definition Deserializer::definition() {
   }
 }
 
+std::pair<tag::Definition, Symbol> Deserializer::skim_definition() {
+  auto tag = source.read_u8();
+  sequence<Attribute>([](auto& self) { return self.attribute(); });
+  auto name = symbol();
+
+  switch (tag) {
+    case raw_value(tag::Definition::variable):
+    case raw_value(tag::Definition::constant):
+      type();
+      value();
+      break;
+
+    case raw_value(tag::Definition::declare):
+      type();
+      break;
+
+    case raw_value(tag::Definition::define): {
+      type();
+      auto count = source.read_unsigned_leb128();
+      for (std::size_t i = 0; (i < count) && !source.has_failed(); ++i) {
+        skip_instruction();
+      }
+      skip_debug();
+      break;
+    }
+
+    case raw_value(tag::Definition::trait):
+      sequence<Symbol>([](auto& self) { return self.symbol(); });
+      break;
+
+    case raw_value(tag::Definition::class_):
+    case raw_value(tag::Definition::module):
+      optional<Symbol>([](auto& self) { return self.symbol(); });
+      sequence<Symbol>([](auto& self) { return self.symbol(); });
+      break;
+
+    default:
+      fatal_error("unexpected tag");
+  }
+
+  skip_source_position();
+  return std::make_pair(static_cast<tag::Definition>(tag), name);
+}
+
 definition::Method::DebugInformation Deserializer::debug() {
+  if (strips_debug_information) {
+    skip_debug();
+    return definition::Method::DebugInformation{};
+  }
+
   return definition::Method::DebugInformation{
     local_name(),
     sequence<LexicalScope>([](auto& self) { return self.lexical_scope(); })
   };
 }
 
+void Deserializer::skip_debug() {
+  auto count = source.read_unsigned_leb128();
+  for (std::size_t i = 0; (i < count) && !source.has_failed(); ++i) {
+    source.skip_leb128s(1);
+    skip_string();
+  }
+
+  count = source.read_unsigned_leb128();
+  for (std::size_t i = 0; (i < count) && !source.has_failed(); ++i) {
+    source.skip_leb128s(2);
+    skip_source_position();
+  }
+}
+
 LexicalScope Deserializer::lexical_scope() {
   return LexicalScope{
     scope_identifier(),
@@ -172,21 +287,23 @@ LexicalScope Deserializer::lexical_scope() {
   };
 }
 
-std::unordered_map<Local, std::string> Deserializer::local_name() {
-  auto count = source.unsigned_leb128().get();
-  std::unordered_map<Local, std::string> r;
-  r.reserve(count);
-  while (count > 0) {
+std::unordered_map<Local, std::string_view> Deserializer::local_name() {
+  auto count = source.read_unsigned_leb128();
+  std::unordered_map<Local, std::string_view> r;
+
+  // Each entry is encoded on at least one byte.
+  r.reserve(std::min<std::size_t>(count, source.source_size() - source.current_position()));
+
+  for (std::size_t i = 0; (i < count) && !source.has_failed(); ++i) {
     auto k = local();
     auto v = string();
     r[k] = v;
-    count -= 1;
   }
   return r;
 }
 
 Instruction Deserializer::instruction() {
-  switch (source.u8().get()) {
+  switch (source.read_u8()) {
     case raw_value(tag::Instruction::label):
       return Instruction(instruction::Label{
         local(),
@@ -244,9 +361,74 @@ Instruction Deserializer::instruction() {
   }
 }
 
+void Deserializer::skip_instruction() {
+  switch (source.read_u8()) {
+    case raw_value(tag::Instruction::label):
+      local();
+      sequence<value::Local>([](auto& self) { return self.label_argument(); });
+      skip_source_position();
+      break;
+
+    case raw_value(tag::Instruction::let):
+      local();
+      skip_operation();
+      skip_next();
+      skip_source_position();
+      source.skip_leb128s(1);
+      break;
+
+    case raw_value(tag::Instruction::unwind):
+      fatal_error("unexpected tag");
+
+    case raw_value(tag::Instruction::return_):
+      value();
+      skip_source_position();
+      break;
+
+    case raw_value(tag::Instruction::jump):
+    case raw_value(tag::Instruction::unreachable):
+      skip_next();
+      skip_source_position();
+      break;
+
+    case raw_value(tag::Instruction::if_):
+      value();
+      skip_next();
+      skip_next();
+      skip_source_position();
+      break;
+
+    case raw_value(tag::Instruction::switch_): {
+      value();
+      auto count = source.read_unsigned_leb128();
+      for (std::size_t i = 0; (i < count) && !source.has_failed(); ++i) {
+        skip_next();
+      }
+      skip_source_position();
+      break;
+    }
+
+    case raw_value(tag::Instruction::throw_):
+      value();
+      skip_next();
+      skip_source_position();
+      break;
+
+    case raw_value(tag::Instruction::linktime_if):
+      linktime_condition();
+      skip_next();
+      skip_next();
+      skip_source_position();
+      break;
+
+    default:
+      fatal_error("unexpected tag");
+  }
+}
+
 Type Deserializer::type() {
   return internable<Type>(interned_types, [](auto& self) {
-    switch (self.source.u8().get()) {
+    switch (self.source.read_u8()) {
       case raw_value(tag::Type::vararg):
         return Type::vararg();
       case raw_value(tag::Type::boolean):
@@ -270,7 +452,7 @@ Type Deserializer::type() {
       case raw_value(tag::Type::array_value):
         return Type(type::ArrayValue{
           self.type(),
-          self.source.unsigned_leb128().get()
+          self.source.read_unsigned_leb128()
         });
 
       case raw_value(tag::Type::struct_value):
@@ -318,7 +500,7 @@ Type Deserializer::type() {
 
 Value Deserializer::value() {
   return internable<Value>(interned_values, [](auto& self) {
-    switch (self.source.u8().get()) {
+    switch (self.source.read_u8()) {
       case raw_value(tag::Value::true_):
         return Value(value::Boolean(true));
       case raw_value(tag::Value::false_):
@@ -328,35 +510,36 @@ Value Deserializer::value() {
       case raw_value(tag::Value::zero):
         return Value(value::Zero(self.type()));
       case raw_value(tag::Value::char_):
-        return Value((value::Char)(self.source.unsigned_leb128().get() & 0xffff));
+        return Value((value::Char)(self.source.read_unsigned_leb128() & 0xffff));
       case raw_value(tag::Value::byte):
-        return Value((value::Byte)(self.source.i8().get()));
+        return Value((value::Byte)(self.source.read_i8()));
       case raw_value(tag::Value::short_):
-        return Value((value::Short)(self.source.signed_leb128().get() & 0xffff));
+        return Value((value::Short)(self.source.read_signed_leb128() & 0xffff));
       case raw_value(tag::Value::int_):
-        return Value((value::Int)(self.source.signed_leb128().get() & 0xffffffff));
+        return Value((value::Int)(self.source.read_signed_leb128() & 0xffffffff));
       case raw_value(tag::Value::long_):
-        return Value((value::Long)(self.source.signed_leb128().get()));
+        return Value((value::Long)(self.source.read_signed_leb128()));
       case raw_value(tag::Value::float_):
-        return Value(value::Float(self.source.f32().get()));
+        return Value(value::Float(self.source.read_f32()));
       case raw_value(tag::Value::double_):
-        return Value(value::Double(self.source.f64().get()));
+        return Value(value::Double(self.source.read_f64()));
       case raw_value(tag::Value::struct_):
         return Value(value::Struct({
           self.template sequence<Value>([](auto& self) { return self.value(); })
         }));
       case raw_value(tag::Value::array):
-        return Value(value::ArrayValue({
-          self.type(),
-          self.template sequence<Value>([](auto& self) { return self.value(); })
-        }));
+        return Value(self.array_value());
       case raw_value(tag::Value::byte_string):
         return Value(value::ByteString(self.bytes()));
-      case raw_value(tag::Value::local):
-        return Value(value::Local{
-          self.local(),
-          self.type()
-        });
+      case raw_value(tag::Value::local): {
+        auto l = self.local();
+        auto t = self.type();
+        if (l >= value::Local::identifier_limit) {
+          self.source.record(DecoderFailure::local_overflow);
+          return Value(value::Unit());
+        }
+        return Value(value::Local{l, t});
+      }
       case raw_value(tag::Value::symbol):
         return Value(value::Symbol({
           self.symbol(),
@@ -369,25 +552,73 @@ Value Deserializer::value() {
       case raw_value(tag::Value::string):
         return Value(value::String(self.string()));
       case raw_value(tag::Value::virtual_):
-        return Value(value::Virtual(self.source.unsigned_leb128().get()));
+        return Value(value::Virtual(self.source.read_unsigned_leb128()));
       case raw_value(tag::Value::class_of):
         return Value(value::ClassOf(self.symbol().template as<symbol::Top>().value()));
       case raw_value(tag::Value::linktime_condition):
         fatal_error("unexpected tag");
       case raw_value(tag::Value::size):
-        return Value(value::Size(self.source.unsigned_leb128().get()));
+        return Value(value::Size(self.source.read_unsigned_leb128()));
       default:
         fatal_error("unexpected tag");
     }
   });
 }
 
+value::ArrayValue Deserializer::array_value() {
+  auto t = type();
+  if (t == Type::u16()) {
+    return numeric_array_value<value::Char>(t);
+  } else if (t == Type::i8()) {
+    return numeric_array_value<value::Byte>(t);
+  } else if (t == Type::i16()) {
+    return numeric_array_value<value::Short>(t);
+  } else if (t == Type::i32()) {
+    return numeric_array_value<value::Int>(t);
+  } else if (t == Type::i64()) {
+    return numeric_array_value<value::Long>(t);
+  } else if (t == Type::f32()) {
+    return numeric_array_value<value::Float>(t);
+  } else if (t == Type::f64()) {
+    return numeric_array_value<value::Double>(t);
+  } else {
+    return value::ArrayValue(t, sequence<Value>([](auto& self) { return self.value(); }));
+  }
+}
+
+template<typename T>
+value::ArrayValue Deserializer::numeric_array_value(Type const& element_type) {
+  auto s = source.read_unsigned_leb128();
+  std::vector<T> result;
+
+  // Each element is encoded on at least one byte.
+  result.reserve(std::min<std::size_t>(s, source.source_size() - source.current_position()));
+
+  for (std::size_t i = 0; (i < s) && !source.has_failed(); ++i) {
+    auto v = value();
+    if (auto n = v.as<T>()) {
+      result.push_back(*n);
+      continue;
+    }
+
+    // The element is not a number (e.g., it is a zero), so the array is stored as `Value`s.
+    std::vector<Value> values(result.begin(), result.end());
+    values.push_back(std::move(v));
+    for (++i; (i < s) && !source.has_failed(); ++i) {
+      values.push_back(value());
+    }
+    return value::ArrayValue(element_type, std::move(values));
+  }
+
+  return value::ArrayValue(std::move(result));
+}
+
 value::Local Deserializer::label_argument() {
   return value().as<value::Local>().value();
 }
 
 Next Deserializer::next() {
-  switch (source.u8().get()) {
+  switch (source.read_u8()) {
     case raw_value(tag::Next::none):
       return Next::none();
     case raw_value(tag::Next::unwind):
@@ -404,8 +635,29 @@ Next Deserializer::next() {
   }
 }
 
+void Deserializer::skip_next() {
+  switch (source.read_u8()) {
+    case raw_value(tag::Next::none):
+      break;
+    case raw_value(tag::Next::unwind):
+      label_argument();
+      skip_next();
+      break;
+    case raw_value(tag::Next::case_):
+      value();
+      skip_next();
+      break;
+    case raw_value(tag::Next::label):
+      local();
+      sequence<Value>([](auto& self) { return self.value(); });
+      break;
+    default:
+      fatal_error("unexpected tag");
+  }
+}
+
 Operation Deserializer::operation() {
-  switch (source.u8().get()) {
+  switch (source.read_u8()) {
     case raw_value(tag::Operation::call):
       return Operation(operation::Call{
         type().as<type::Function>().value(),
@@ -427,26 +679,26 @@ Operation Deserializer::operation() {
       return Operation(operation::Element{
         type(),
         value(),
-        sequence<uint32_t>([](auto& self) { return self.uint32(); })
+        uint32_sequence()
       });
 
     case raw_value(tag::Operation::extract):
       return Operation(operation::Extract{
         value(),
-        sequence<uint32_t>([](auto& self) { return self.uint32(); })
+        uint32_sequence()
       });
 
     case raw_value(tag::Operation::insert):
       return Operation(operation::Insert{
         value(),
         value(),
-        sequence<uint32_t>([](auto& self) { return self.uint32(); })
+        uint32_sequence()
       });
 
     case raw_value(tag::Operation::stackalloc):
       return Operation(operation::StackAllocate{
         type(),
-        source.unsigned_leb128().get()
+        source.read_unsigned_leb128()
       });
 
     case raw_value(tag::Operation::binary):
@@ -588,12 +840,178 @@ Operation Deserializer::operation() {
   }
 }
 
+void Deserializer::skip_operation() {
+  switch (source.read_u8()) {
+    case raw_value(tag::Operation::call):
+      type();
+      value();
+      sequence<Value>([](auto& self) { return self.value(); });
+      break;
+
+    case raw_value(tag::Operation::load):
+      type();
+      value();
+      memory_order();
+      break;
+
+    case raw_value(tag::Operation::store):
+      type();
+      value();
+      value();
+      memory_order();
+      break;
+
+    case raw_value(tag::Operation::element):
+      type();
+      value();
+      skip_uint32_sequence();
+      break;
+
+    case raw_value(tag::Operation::extract):
+      value();
+      skip_uint32_sequence();
+      break;
+
+    case raw_value(tag::Operation::insert):
+      value();
+      value();
+      skip_uint32_sequence();
+      break;
+
+    case raw_value(tag::Operation::stackalloc):
+      type();
+      source.read_unsigned_leb128();
+      break;
+
+    case raw_value(tag::Operation::binary):
+      binary_operator();
+      type();
+      value();
+      value();
+      break;
+
+    case raw_value(tag::Operation::compare):
+      comparison_operator();
+      type();
+      value();
+      value();
+      break;
+
+    case raw_value(tag::Operation::convert):
+      conversion_operator();
+      type();
+      value();
+      break;
+
+    case raw_value(tag::Operation::fence):
+      memory_order();
+      break;
+
+    case raw_value(tag::Operation::classalloc):
+      symbol();
+      optional<Value>([](auto& self) { return self.value(); });
+      break;
+
+    case raw_value(tag::Operation::fieldload):
+      type();
+      value();
+      symbol();
+      break;
+
+    case raw_value(tag::Operation::fieldstore):
+      type();
+      value();
+      symbol();
+      value();
+      break;
+
+    case raw_value(tag::Operation::field):
+      value();
+      symbol();
+      break;
+
+    case raw_value(tag::Operation::method):
+    case raw_value(tag::Operation::dynmethod):
+      value();
+      signature();
+      break;
+
+    case raw_value(tag::Operation::module):
+      symbol();
+      break;
+
+    case raw_value(tag::Operation::as):
+    case raw_value(tag::Operation::is):
+    case raw_value(tag::Operation::box):
+    case raw_value(tag::Operation::unbox):
+      type();
+      value();
+      break;
+
+    case raw_value(tag::Operation::copy):
+    case raw_value(tag::Operation::varload):
+    case raw_value(tag::Operation::arraylength):
+      value();
+      break;
+
+    case raw_value(tag::Operation::size_of):
+    case raw_value(tag::Operation::alignment_of):
+    case raw_value(tag::Operation::var):
+      type();
+      break;
+
+    case raw_value(tag::Operation::varstore):
+      value();
+      value();
+      break;
+
+    case raw_value(tag::Operation::arrayalloc):
+      type();
+      value();
+      optional<Value>([](auto& self){ return self.value(); });
+      break;
+
+    case raw_value(tag::Operation::arrayload):
+      type();
+      value();
+      uint32();
+      break;
+
+    case raw_value(tag::Operation::arraystore):
+      type();
+      value();
+      uint32();
+      value();
+      break;
+
+    default:
+      fatal_error("unexpected tag");
+  }
+}
+
 LinktimeCondition Deserializer::linktime_condition() {
-  fatal_error("not implemented");
+  switch (source.read_u8()) {
+    case raw_value(tag::LinktimeCondition::simple): {
+      auto lhs = string();
+      auto relation = comparison_operator();
+      auto rhs = value();
+      return LinktimeCondition(
+        linktime::SimpleCondition{std::string(lhs), rhs, relation, source_position()});
+    }
+    case raw_value(tag::LinktimeCondition::complex): {
+      auto relation = logical_operator();
+      auto lhs = linktime_condition();
+      auto rhs = linktime_condition();
+      return LinktimeCondition(
+        linktime::ComplexCondition{lhs, rhs, relation, source_position()});
+    }
+    default:
+      fatal_error("unexpected tag");
+  }
 }
 
 BinaryOperator Deserializer::binary_operator() {
-  switch (source.u8().get()) {
+  switch (source.read_u8()) {
     case raw_value(tag::BinaryOperator::iadd):
       return BinaryOperator::iadd;
     case raw_value(tag::BinaryOperator::fadd):
@@ -636,7 +1054,7 @@ BinaryOperator Deserializer::binary_operator() {
 }
 
 ComparisonOperator Deserializer::comparison_operator() {
-  switch (source.u8().get()) {
+  switch (source.read_u8()) {
     case raw_value(tag::ComparisonOperator::ieq):
       return ComparisonOperator::ieq;
     case raw_value(tag::ComparisonOperator::ine):
@@ -674,8 +1092,19 @@ ComparisonOperator Deserializer::comparison_operator() {
   }
 }
 
+LogicalOperator Deserializer::logical_operator() {
+  switch (binary_operator()) {
+    case BinaryOperator::and_:
+      return LogicalOperator::and_;
+    case BinaryOperator::or_:
+      return LogicalOperator::or_;
+    default:
+      fatal_error("unexpected tag");
+  }
+}
+
 ConversionOperator Deserializer::conversion_operator() {
-  switch (source.u8().get()) {
+  switch (source.read_u8()) {
     case raw_value(tag::ConversionOperator::trunc):
       return ConversionOperator::trunc;
     case raw_value(tag::ConversionOperator::zext):
@@ -710,19 +1139,19 @@ ConversionOperator Deserializer::conversion_operator() {
 }
 
 MemoryOrder Deserializer::memory_order() {
-  auto v = source.u8().get();
+  auto v = source.read_u8();
   precondition((v >= 0) && (v <= 5), "unexpected tag");
   return static_cast<MemoryOrder>(v);
 }
 
 Local Deserializer::local() {
-  return Local(source.unsigned_leb128().get());
+  return Local(source.read_unsigned_leb128());
 }
 
 Attribute Deserializer::attribute() {
   using namespace attribute;
 
-  switch (source.u8().get()) {
+  switch (source.read_u8()) {
     case raw_value(tag::Attribute::may_inline):
       return Attribute(Kind::may_inline);
     case raw_value(tag::Attribute::inline_hint):
@@ -771,8 +1200,8 @@ Attribute Deserializer::attribute() {
       return Attribute(Kind::uses_intrinsic);
 
     case raw_value(tag::Attribute::align): {
-      auto s = source.signed_leb128().get();
-      auto g = optional<std::string>([](auto& self) { return self.string(); });
+      auto s = source.read_signed_leb128();
+      auto g = optional<std::string_view>([](auto& self) { return self.string(); });
       return Attribute(Alignment{s, g});
     }
 
@@ -782,48 +1211,146 @@ Attribute Deserializer::attribute() {
 }
 
 SourcePosition Deserializer::source_position() {
+  if (strips_debug_information) {
+    skip_source_position();
+    return SourcePosition::invalid();
+  }
+
   auto p = string();
+  if (p.empty()) {
+    return SourcePosition{
+      SourceFile(),
+      static_cast<uint32_t>(source.read_unsigned_leb128()), // line index
+      static_cast<uint32_t>(source.read_unsigned_leb128()) // column index
+    };
+  }
+
+  // Positions read one after the other are likely to refer to the same file.
+  auto& [q, f] = last_source_file;
+  if ((p.data() != q.data()) || (p.size() != q.size())) {
+    q = p;
+    f = SourceFile(p);
+  }
+
   return SourcePosition{
-    (p == "") ? SourceFile() : SourceFile(p), // source
-    source.unsigned_leb128().get(), // line index
-    source.unsigned_leb128().get() // column index
+    f, // source
+    static_cast<uint32_t>(source.read_unsigned_leb128()), // line index
+    static_cast<uint32_t>(source.read_unsigned_leb128()) // column index
   };
 }
 
+void Deserializer::skip_source_position() {
+  skip_string();
+  source.skip_leb128s(2);
+}
+
 ScopeIdentifier Deserializer::scope_identifier() {
-  return ScopeIdentifier{source.unsigned_leb128().get()};
+  if (strips_debug_information) {
+    source.skip_leb128s(1);
+    return ScopeIdentifier::top_level();
+  }
+
+  return ScopeIdentifier{source.read_unsigned_leb128()};
+}
+
+/// The largest number of bytes read from a stream into a string pool before they have arrived.
+inline constexpr std::size_t stream_chunk_size = 1 << 16;
+
+/// Returns a view of `prefix` followed by the next `n` bytes of `source`, stored in `pool`.
+///
+/// If there are fewer than `n` bytes left, a failure is recorded and the result ends with the bytes
+/// that were left. Long payloads are read by chunks into storage that grows as they arrive, so that
+/// a corrupt size doesn't cause a huge allocation.
+inline std::string_view streamed_string(
+  Decoder& source, StringPool& pool, std::string_view prefix, std::size_t n
+) {
+  if (n <= stream_chunk_size) {
+    auto p = pool.allocate(prefix, n);
+    auto m = source.bytes(n, reinterpret_cast<int8_t*>(p + prefix.size()));
+    if (m != n) { source.record(DecoderFailure::not_enough_bytes); }
+    return std::string_view(p, prefix.size() + m);
+  }
+
+  std::string contents(prefix);
+  for (std::size_t m = 0; m < n;) {
+    auto k = std::min(n - m, stream_chunk_size);
+    contents.resize(prefix.size() + m + k);
+    auto l = source.bytes(k, reinterpret_cast<int8_t*>(contents.data() + prefix.size() + m));
+    m += l;
+    if (l != k) {
+      contents.resize(prefix.size() + m);
+      source.record(DecoderFailure::not_enough_bytes);
+      break;
+    }
+  }
+  return pool.insert(contents);
 }
 
-std::string Deserializer::inline_string() {
-  auto n = source.unsigned_leb128().get();
-  char points[n];
-  auto r = source.bytes(n, static_cast<int8_t*>(static_cast<void*>(points)));
-  precondition(n == r, "invalid string");
-  return std::string(points, n);
+std::string_view Deserializer::inline_string(std::string_view prefix) {
+  auto n = source.read_unsigned_leb128();
+  if (prefix.empty()) {
+    if (auto s = source.borrow(n)) {
+      return std::string_view(reinterpret_cast<char const*>(s->data()), s->size());
+    }
+  }
+
+  if (!source.is_streaming() && (n > source.source_size() - source.current_position())) {
+    source.record(DecoderFailure::not_enough_bytes);
+    return std::string_view();
+  }
+
+  // Read the contents of the string directly into the pool.
+  return streamed_string(source, *strings, prefix, n);
 }
 
-std::string Deserializer::string() {
-  switch (source.u8().get()) {
+/// Returns the first `n` characters of the `i`-th string interned by `self`, or records a failure
+/// in `self.source` if there is no such string.
+inline std::string_view interned_prefix(Deserializer& self, uint64_t n, uint64_t i) {
+  if (i < self.interned_strings.size()) {
+    return self.interned_strings[i].substr(0, n);
+  } else {
+    self.source.record(DecoderFailure::invalid_reference);
+    return std::string_view();
+  }
+}
+
+std::string_view Deserializer::string() {
+  switch (source.read_u8()) {
     case raw_value(tag::String::empty):
-      return std::string();
+      return std::string_view();
 
     case raw_value(tag::String::contained): {
-      auto n = source.unsigned_leb128().get();
-      auto i = source.unsigned_leb128().get();
-      return std::string(interned_strings[i], 0, n);
+      auto n = source.read_unsigned_leb128();
+      auto i = source.read_unsigned_leb128();
+      return interned_prefix(*this, n, i);
     }
 
     case raw_value(tag::String::inserted): {
+      // The string has already been stored if it's being decoded again.
+      if (auto s = interned_strings.truncated_entry()) {
+        source.skip(source.read_unsigned_leb128());
+        interned_strings.insert(*s);
+        return *s;
+      }
+
       auto s = inline_string();
-      interned_strings.push_back(s);
+      interned_strings.insert(s);
       return s;
     }
 
     case raw_value(tag::String::appended): {
-      auto n = source.unsigned_leb128().get();
-      auto i = source.unsigned_leb128().get();
-      auto s = std::string(interned_strings[i], 0, n) + inline_string();
-      interned_strings.push_back(s);
+      auto n = source.read_unsigned_leb128();
+      auto i = source.read_unsigned_leb128();
+
+      // The string has already been stored if it's being decoded again.
+      if (auto s = interned_strings.truncated_entry()) {
+        source.skip(source.read_unsigned_leb128());
+        interned_strings.insert(*s);
+        return *s;
+      }
+
+      auto s = inline_string(interned_prefix(*this, n, i));
+      interned_strings.insert(s);
       return s;
     }
 
@@ -832,23 +1359,60 @@ std::string Deserializer::string() {
   }
 }
 
-std::vector<value::Byte> Deserializer::bytes() {
-  auto count = source.unsigned_leb128().get();
-  std::vector<value::Byte> result;
-  result.reserve(count);
-  while (count > 0) {
-    result.push_back(source.i8().get());
-    count -= 1;
+void Deserializer::skip_string() {
+  // Only the strings written inline must be decoded, so that they can be interned.
+  if (source.next_byte_is(raw_value(tag::String::contained))) {
+    source.read_u8();
+    source.skip_leb128s(2);
+  } else {
+    string();
   }
-  return result;
+}
+
+std::span<value::Byte const> Deserializer::bytes() {
+  auto n = source.read_unsigned_leb128();
+  if (auto s = source.borrow(n)) {
+    auto p = reinterpret_cast<value::Byte const*>(s->data());
+    return std::span<value::Byte const>(p, s->size());
+  }
+
+  // The bytes of a stream are discarded once read.
+  auto s = streamed_string(source, *strings, std::string_view(), n);
+  return std::span<value::Byte const>(reinterpret_cast<value::Byte const*>(s.data()), s.size());
 }
 
 bool Deserializer::boolean() {
-  return source.u8().get() != 0;
+  return source.read_u8() != 0;
 }
 
 uint32_t Deserializer::uint32() {
-  return (uint32_t)(source.unsigned_leb128().get() & 0xffffffff);
+  return (uint32_t)(source.read_unsigned_leb128() & 0xffffffff);
+}
+
+std::vector<uint32_t> Deserializer::uint32_sequence() {
+  auto count = source.read_unsigned_leb128();
+  std::vector<uint32_t> result;
+  result.reserve(std::min<std::size_t>(count, source.source_size() - source.current_position()));
+
+  // Decode the elements in batches to amortize the cost of bulk decoding.
+  uint64_t batch[32];
+  while ((count > 0) && !source.has_failed()) {
+    auto n = source.read_unsigned_leb128s(std::min<std::size_t>(count, 32), batch);
+    for (std::size_t i = 0; i < n; ++i) {
+      result.push_back((uint32_t)(batch[i] & 0xffffffff));
+    }
+    count -= n;
+  }
+
+  return result;
+}
+
+void Deserializer::skip_uint32_sequence() {
+  auto count = source.read_unsigned_leb128();
+  uint64_t batch[32];
+  while ((count > 0) && !source.has_failed()) {
+    count -= source.read_unsigned_leb128s(std::min<std::size_t>(count, 32), batch);
+  }
 }
 
 } // nir
@@ -1,9 +1,13 @@
 #include "AttributeSet.hh"
 #include "Deserializer.hh"
 #include "File.hh"
+#include "Serializer.hh"
 #include "Utilities/Assert.hh"
+#include "Utilities/Concurrency.hh"
 
 #include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <concepts>
 #include <unordered_map>
 
@@ -20,40 +24,211 @@ template<typename T, typename U>
 std::vector<T> narrowed_sequence(std::vector<U> const& s) {
   std::vector<T> r;
   r.reserve(s.size());
-  std::transform(s.begin(), s.end(), r.begin(), [](auto const& e) {
+  std::transform(s.begin(), s.end(), std::back_inserter(r), [](auto const& e) {
     return e.template as<T>().value();
   });
   return r;
 }
 
 Header Header::decode(Decoder& source) {
+  source.byte_order = std::endian::big;
   const auto m = source.i32();
   if (m != file_identifier) {
     throw DecoderError(source.current_position(), "invalid file format");
   }
 
-  auto major = source.i32().get();
-  auto minor = source.i32().get();
+  auto major = source.read_i32();
+  auto minor = source.read_i32();
+  source.check();
   // auto has_entry_points = source.u8().get() != 0; TODO
+
+  // The contents of the file are encoded in little-endian.
+  source.byte_order = std::endian::little;
   return Header { major, minor, true };
 }
 
-File File::from_contents_of(std::string const& path) {
-  Decoder source(path);
+/// Reads the definitions in `source` sequentially with the given options, storing their strings in
+/// `strings` and allocating their nodes in `arenas[0]` if `arenas` is not empty.
+///
+/// The definitions may refer to the entities interned by `prelude`, if any.
+inline std::vector<Definition> decode_definitions(
+  Decoder& source, DecodingOptions const& options, std::shared_ptr<StringPool> const& strings,
+  std::vector<std::unique_ptr<Arena>> const& arenas, Deserializer const* prelude
+) {
+  std::optional<ArenaScope> scope;
+  if (!arenas.empty()) { scope.emplace(*arenas[0]); }
 
-  // Read the header.
-  source.byte_order = std::endian::big;
-  auto header = Header::decode(source);
-
-  // Read the header.
-  source.byte_order = std::endian::little;
-  Deserializer deserializer(source);
+  Deserializer deserializer(source, strings);
+  if (prelude != nullptr) { deserializer.extend(*prelude); }
+  deserializer.strips_debug_information = options.strip_debug_information;
   std::vector<Definition> definitions;
   while (!deserializer.source.is_empty()) {
     definitions.push_back(deserializer.definition());
   }
+  return definitions;
+}
+
+/// Reads the definitions in `source` on `thread_count` threads with the given options, storing
+/// their strings in `strings` and allocating the nodes decoded by the `k`-th thread in `arenas[k]`
+/// if `arenas` is not empty.
+///
+/// The definitions may refer to the entities interned by `prelude`, if any.
+inline std::vector<Definition> decode_definitions(
+  Decoder& source, std::size_t thread_count, DecodingOptions const& options,
+  std::shared_ptr<StringPool> const& strings, std::vector<std::unique_ptr<Arena>> const& arenas,
+  Deserializer const* prelude
+) {
+  // Skim the definitions to intern the entities they share and find their boundaries. All strings
+  // are stored in the pool during this pass, so that the threads decoding definitions only read
+  // from it.
+  Deserializer skimmer(source, strings);
+  if (prelude != nullptr) { skimmer.extend(*prelude); }
+  skimmer.strips_debug_information = options.strip_debug_information;
+  std::vector<std::size_t> starts;
+  std::vector<Deserializer::Checkpoint> checkpoints;
+  while (!source.is_empty()) {
+    starts.push_back(source.current_position());
+    checkpoints.push_back(skimmer.checkpoint());
+    skimmer.skim_definition();
+    source.check();
+  }
+
+  // Decode consecutive definitions in batches, so that the tables of a deserializer need only be
+  // restored at the start of each batch.
+  const std::size_t batch_size = 16;
+  std::vector<std::optional<Definition>> slots(starts.size());
+  std::atomic<std::size_t> next_batch{0};
+
+  concurrently(std::min(thread_count, starts.size()), [&](std::size_t k) {
+    std::optional<ArenaScope> scope;
+    if (!arenas.empty()) { scope.emplace(*arenas[k]); }
+
+    auto fork = source.fork();
+    Deserializer deserializer(fork, skimmer);
+    while (true) {
+      auto i = next_batch.fetch_add(batch_size, std::memory_order_relaxed);
+      if (i >= starts.size()) { return; }
+
+      fork.move_at(starts[i]);
+      deserializer.restore(checkpoints[i]);
+      for (auto j = i; j < std::min(i + batch_size, starts.size()); ++j) {
+        slots[j].emplace(deserializer.definition());
+      }
+    }
+  });
+
+  std::vector<Definition> definitions;
+  definitions.reserve(slots.size());
+  for (auto& d : slots) {
+    definitions.push_back(std::move(*d));
+  }
+  return definitions;
+}
+
+/// Creates a file reading its contents from `source`, whose definitions may refer to the entities
+/// interned by `prelude`, if any.
+inline File decode_file(
+  Decoder& source, DecodingOptions const& options, Deserializer const* prelude
+) {
+  auto header = Header::decode(source);
+  auto thread_count = (options.thread_count == 0) ? hardware_thread_count() : options.thread_count;
+
+  std::vector<std::unique_ptr<Arena>> arenas;
+  if (options.use_arena) {
+    for (std::size_t k = 0; k < thread_count; ++k) {
+      arenas.push_back(std::make_unique<Arena>());
+    }
+  }
+
+  auto strings = std::make_shared<StringPool>();
+  auto contents = source.shared_contents();
+  if (thread_count > 1) {
+    auto definitions = decode_definitions(
+      source, thread_count, options, strings, arenas, prelude);
+    return File(
+      header, std::move(definitions), std::move(strings), std::move(arenas), std::move(contents));
+  } else {
+    auto definitions = decode_definitions(source, options, strings, arenas, prelude);
+    return File(
+      header, std::move(definitions), std::move(strings), std::move(arenas), std::move(contents));
+  }
+}
+
+File File::from_contents_of(std::string const& path, DecodingOptions const& options) {
+  auto source = Decoder::mapping_contents_of(path);
+  return decode_file(source, options, nullptr);
+}
+
+File File::from_decoder(
+  Decoder&& source, DecodingOptions const& options, Deserializer const* prelude
+) {
+  precondition(!source.is_streaming(), "source must be held in memory");
+  return decode_file(source, options, prelude);
+}
+
+File File::from_bytes(std::span<const uint8_t> bytes, DecodingOptions const& options) {
+  Decoder source(bytes);
+  return decode_file(source, options, nullptr);
+}
+
+File File::from_buffer(std::vector<uint8_t>&& bytes, DecodingOptions const& options) {
+  Decoder source(std::move(bytes));
+  return decode_file(source, options, nullptr);
+}
+
+File File::from_descriptor(int fd, DecodingOptions const& options) {
+  auto stream = DefinitionStream::from_descriptor(fd, options);
+  std::vector<Definition> definitions;
+  while (auto d = stream.next()) {
+    definitions.push_back(std::move(*d));
+  }
+
+  std::vector<std::unique_ptr<Arena>> arenas;
+  if (auto a = stream.take_arena()) { arenas.push_back(std::move(a)); }
+  return File(stream.header, std::move(definitions), stream.strings(), std::move(arenas));
+}
 
-  return File{header, definitions};
+std::vector<uint8_t> File::serialized() const {
+  std::vector<uint8_t> result;
+  Serializer serializer(result);
+  serializer.header(header);
+  for (auto const& d : definitions) { serializer.definition(d); }
+  return result;
+}
+
+DefinitionStream::DefinitionStream(Decoder&& s, DecodingOptions const& options) :
+  arena(options.use_arena ? std::make_unique<Arena>() : nullptr),
+  source(std::make_unique<Decoder>(std::move(s))),
+  deserializer(std::make_unique<Deserializer>(*source)),
+  header(Header::decode(*source))
+{
+  deserializer->strips_debug_information = options.strip_debug_information;
+}
+
+DefinitionStream DefinitionStream::from_descriptor(int fd, DecodingOptions const& options) {
+  return DefinitionStream(Decoder::streaming_contents_of(fd), options);
+}
+
+DefinitionStream::DefinitionStream(DefinitionStream&&) = default;
+
+DefinitionStream::~DefinitionStream() = default;
+
+std::shared_ptr<StringPool const> DefinitionStream::strings() const {
+  return deserializer->strings;
+}
+
+std::unique_ptr<Arena> DefinitionStream::take_arena() {
+  return std::move(arena);
+}
+
+std::optional<Definition> DefinitionStream::next() {
+  if (source->is_empty()) {
+    return std::nullopt;
+  } else {
+    std::optional<ArenaScope> scope;
+    if (arena != nullptr) { scope.emplace(*arena); }
+    return deserializer->definition();
+  }
 }
 
 } // nir
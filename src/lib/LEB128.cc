@@ -0,0 +1,123 @@
+#include "LEB128.hh"
+
+#ifdef NIRC_HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace nir::leb128 {
+
+/// A function decoding up to `n` unsigned LEB128s.
+///
+/// See `decode_unsigned` for a description of the parameters.
+using Kernel = std::size_t (*)(const uint8_t*&, const uint8_t*, std::size_t, uint64_t*);
+
+std::size_t decode_unsigned_scalar(
+  const uint8_t*& p, const uint8_t* end, std::size_t n, uint64_t* o
+) {
+  std::size_t i = 0;
+  while ((i < n) && (static_cast<std::size_t>(end - p) >= slack)) {
+    auto m = decode_short_unsigned(p, o[i]);
+    if (m == 0) { break; }
+    p += m;
+    ++i;
+  }
+  return i;
+}
+
+#ifdef NIRC_HAS_X86_KERNELS
+
+std::size_t decode_unsigned_sse2(
+  const uint8_t*& p, const uint8_t* end, std::size_t n, uint64_t* o
+) {
+  std::size_t i = 0;
+  while ((i < n) && (static_cast<std::size_t>(end - p) >= slack)) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto continuations = static_cast<uint32_t>(_mm_movemask_epi8(v));
+
+    // Fast path: the next 16 bytes are single-byte values.
+    if ((continuations == 0) && (n - i >= 16)) {
+      for (std::size_t j = 0; j < 16; ++j) { o[i + j] = p[j]; }
+      p += 16;
+      i += 16;
+      continue;
+    }
+
+    // Decode the values whose terminator is among the next 16 bytes.
+    std::size_t offset = 0;
+    auto terminators = ~continuations & 0xffff;
+    while ((terminators != 0) && (i < n)) {
+      auto m = static_cast<std::size_t>(std::countr_zero(terminators)) + 1 - offset;
+      if (m > 8) { p += offset; return i; }
+      o[i++] = compress_payloads(load_word(p + offset), m);
+      offset += m;
+      terminators &= terminators - 1;
+    }
+
+    // Bail out if the next value is longer than 16 bytes.
+    if (offset == 0) { return i; }
+    p += offset;
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+std::size_t decode_unsigned_avx2(
+  const uint8_t*& p, const uint8_t* end, std::size_t n, uint64_t* o
+) {
+  std::size_t i = 0;
+  while ((i < n) && (static_cast<std::size_t>(end - p) >= slack)) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    auto continuations = static_cast<uint32_t>(_mm256_movemask_epi8(v));
+
+    // Fast path: the next 32 bytes are single-byte values.
+    if ((continuations == 0) && (n - i >= 32)) {
+      for (std::size_t j = 0; j < 32; j += 4) {
+        uint32_t q;
+        std::memcpy(&q, p + j, sizeof(q));
+        auto w = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(static_cast<int>(q)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(o + i + j), w);
+      }
+      p += 32;
+      i += 32;
+      continue;
+    }
+
+    // Decode the values whose terminator is among the next 32 bytes. A value may start less than
+    // 8 bytes before the end of these bytes, in which case decoding stops before it unless its word
+    // is known to be readable.
+    std::size_t offset = 0;
+    auto terminators = ~continuations;
+    auto available = static_cast<std::size_t>(end - p);
+    while ((terminators != 0) && (i < n) && (offset + 8 <= available)) {
+      auto m = static_cast<std::size_t>(std::countr_zero(terminators)) + 1 - offset;
+      if (m > 8) { p += offset; return i; }
+      o[i++] = compress_payloads(load_word(p + offset), m);
+      offset += m;
+      terminators &= terminators - 1;
+    }
+
+    // Bail out if the next value is longer than 32 bytes.
+    if (offset == 0) { return i; }
+    p += offset;
+  }
+  return i;
+}
+
+#endif
+
+/// Returns the fastest kernel supported by the host.
+inline Kernel select_kernel() {
+#ifdef NIRC_HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) { return &decode_unsigned_avx2; }
+  if (__builtin_cpu_supports("sse2")) { return &decode_unsigned_sse2; }
+#endif
+  return &decode_unsigned_scalar;
+}
+
+std::size_t decode_unsigned(const uint8_t*& p, const uint8_t* end, std::size_t n, uint64_t* o) {
+  static const Kernel kernel = select_kernel();
+  return kernel(p, end, n, o);
+}
+
+} // nir::leb128
@@ -0,0 +1,59 @@
+#include "LazyFile.hh"
+#include "Utilities/Assert.hh"
+
+#include <utility>
+
+namespace nir {
+
+LazyFile::LazyFile(Decoder&& s, Deserializer const* prelude) :
+  source(std::make_unique<Decoder>(std::move(s))),
+  deserializer(std::make_unique<Deserializer>(*source)),
+  header(Header::decode(*source))
+{
+  precondition(!source->is_streaming(), "source must be held in memory");
+  if (prelude != nullptr) { deserializer->extend(*prelude); }
+
+  // Skim the file to build the index and the interning tables.
+  while (!source->is_empty()) {
+    auto start = source->current_position();
+    auto checkpoint = deserializer->checkpoint();
+    auto [tag, name] = deserializer->skim_definition();
+    source->check();
+
+    index.emplace(name, _entries.size());
+    _entries.push_back(Entry{tag, name, start, source->current_position()});
+    checkpoints.push_back(checkpoint);
+  }
+
+  decoded.resize(_entries.size());
+}
+
+LazyFile LazyFile::from_contents_of(std::string const& path) {
+  return LazyFile(Decoder::mapping_contents_of(path));
+}
+
+LazyFile LazyFile::from_bytes(std::span<const uint8_t> bytes) {
+  return LazyFile(Decoder(bytes));
+}
+
+LazyFile::LazyFile(LazyFile&&) = default;
+
+LazyFile::~LazyFile() = default;
+
+Definition const& LazyFile::at(std::size_t i) {
+  precondition(i < _entries.size(), "index is out of bounds");
+  if (decoded[i] == nullptr) {
+    // Decode the definition with the interning tables as they were when it was skimmed.
+    source->move_at(_entries[i].start);
+    deserializer->restore(checkpoints[i]);
+    decoded[i] = std::make_unique<Definition>(deserializer->definition());
+  }
+  return *decoded[i];
+}
+
+Definition const* LazyFile::definition(Symbol const& name) {
+  auto i = index.find(name);
+  return (i != index.end()) ? &at(i->second) : nullptr;
+}
+
+} // nir
@@ -0,0 +1,325 @@
+#include "LazyWorkspace.hh"
+#include "MappedFile.hh"
+#include "Workspace.hh"
+#include "Utilities/Concurrency.hh"
+#include "Utilities/LittleEndian.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <ios>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace nir {
+
+/// The first bytes of a table of filters.
+inline constexpr char filters_identifier[8] = {'N', 'I', 'R', 'F', 'L', 'T', 'R', '\0'};
+
+/// The version of the format of the tables of filters written by this implementation.
+inline constexpr uint32_t filters_version = 2;
+
+/// The size of the header of a table of filters in bytes.
+inline constexpr std::size_t filters_header_size = 16;
+
+/// The size of the record preceding the path and filter of each file in a table of filters.
+inline constexpr std::size_t filters_record_size = 32;
+
+/// The description of a file in a table of filters.
+struct FilterRecord {
+
+  /// The path of the file.
+  std::string path;
+
+  /// The state of the file from which the filter was built.
+  LazyWorkspace::FileState state;
+
+  /// The filter of the top-level symbols defined in the file.
+  SymbolFilter filter;
+
+};
+
+/// Returns the records of the table at `table`, or an empty vector if that table doesn't exist or
+/// isn't valid.
+inline std::vector<FilterRecord> read_filters(std::filesystem::path const& table) {
+  std::optional<MappedFile> mapping;
+  try {
+    if (!std::filesystem::is_regular_file(table)) { return {}; }
+    mapping.emplace(table.string());
+  } catch (std::exception const&) {
+    return {};
+  }
+
+  auto bytes = mapping->contents();
+  auto p = bytes.data();
+  if (bytes.size() < filters_header_size) { return {}; }
+  if (std::memcmp(p, filters_identifier, sizeof(filters_identifier)) != 0) { return {}; }
+  if (read_le<uint32_t>(p + 8) != filters_version) { return {}; }
+  std::size_t count = read_le<uint32_t>(p + 12);
+
+  std::vector<FilterRecord> result;
+  std::size_t offset = filters_header_size;
+  for (std::size_t k = 0; k < count; ++k) {
+    if (bytes.size() - offset < filters_record_size) { return {}; }
+    std::size_t path_size = read_le<uint32_t>(p + offset);
+    std::size_t word_count = read_le<uint32_t>(p + offset + 4);
+    LazyWorkspace::FileState state{
+      read_le<uint64_t>(p + offset + 8),
+      static_cast<int64_t>(read_le<uint64_t>(p + offset + 16)),
+      read_le<uint64_t>(p + offset + 24)
+    };
+    offset += filters_record_size;
+
+    if ((word_count == 0) || ((bytes.size() - offset) / 8 < word_count)) { return {}; }
+    if (bytes.size() - offset - 8 * word_count < path_size) { return {}; }
+    std::string path(reinterpret_cast<char const*>(p + offset), path_size);
+    offset += path_size;
+
+    std::vector<uint64_t> words(word_count);
+    for (std::size_t i = 0; i < word_count; ++i) {
+      words[i] = read_le<uint64_t>(p + offset + 8 * i);
+    }
+    offset += 8 * word_count;
+    result.push_back({std::move(path), state, SymbolFilter(std::move(words))});
+  }
+
+  if (offset != bytes.size()) { return {}; }
+  return result;
+}
+
+/// Returns a hash of `bytes`, which identifies the contents of a file in a table of filters.
+inline uint64_t contents_hash(std::span<uint8_t const> bytes) {
+  // 64-bit FNV-1a.
+  uint64_t h = 0xcbf29ce484222325;
+  for (auto b : bytes) { h = (h ^ b) * 0x100000001b3; }
+  return h;
+}
+
+/// Returns the size and modification time of the file at `path`, with a null hash.
+inline LazyWorkspace::FileState metadata_of(std::filesystem::path const& path) {
+  return {
+    std::filesystem::file_size(path),
+    std::filesystem::last_write_time(path).time_since_epoch().count(),
+    0
+  };
+}
+
+/// Returns the filter of the top-level symbols defined in the file whose contents are `bytes`.
+inline SymbolFilter filter_of(std::span<uint8_t const> bytes) {
+  auto f = LazyFile::from_bytes(bytes);
+
+  // The members of a top-level symbol are usually defined along with that symbol, so there are
+  // typically far fewer distinct identifiers than definitions.
+  std::vector<uint64_t> hashes;
+  for (auto const& e : f.entries()) {
+    if (auto h = SymbolFilter::hash(e.name)) { hashes.push_back(*h); }
+  }
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+  SymbolFilter result(hashes.size());
+  for (auto h : hashes) { result.insert(h); }
+  return result;
+}
+
+LazyWorkspace::LazyWorkspace(
+  std::vector<std::filesystem::path>&& paths, std::vector<SymbolFilter>&& filters,
+  std::vector<FileState>&& states, std::vector<bool>&& checked, std::size_t reused_filter_count,
+  std::size_t thread_count
+) :
+  _paths(std::move(paths)),
+  filters(std::move(filters)),
+  files(_paths.size()),
+  states(std::move(states)),
+  checked(std::move(checked)),
+  _reused_filter_count(reused_filter_count),
+  thread_count(thread_count)
+{}
+
+LazyWorkspace::LazyWorkspace(LazyWorkspace&&) = default;
+
+LazyWorkspace::~LazyWorkspace() = default;
+
+LazyWorkspace LazyWorkspace::open(
+  std::vector<std::filesystem::path> const& roots,
+  std::optional<std::filesystem::path> const& table,
+  std::size_t thread_count
+) {
+  if (thread_count == 0) { thread_count = hardware_thread_count(); }
+  std::vector<std::filesystem::path> paths;
+  for (auto& f : enumerate_files(roots, thread_count)) { paths.push_back(std::move(f.path)); }
+
+  std::vector<FilterRecord> records;
+  if (table.has_value()) { records = read_filters(*table); }
+  std::unordered_map<std::string_view, FilterRecord*> recorded;
+  for (auto& r : records) { recorded.emplace(r.path, &r); }
+
+  // The state of a file is read before its contents so that a file modified in the meantime is
+  // read again the next time the workspace is opened.
+  struct Slot { SymbolFilter filter; FileState state; bool checked; bool reused; };
+  std::vector<std::optional<Slot>> slots(paths.size());
+  std::atomic<std::size_t> next{0};
+  concurrently(std::min(thread_count, paths.size()), [&](std::size_t) {
+    for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < paths.size();
+         i = next.fetch_add(1, std::memory_order_relaxed)) {
+      auto state = metadata_of(paths[i]);
+      auto r = recorded.find(paths[i].string());
+      auto record = (r != recorded.end()) ? r->second : nullptr;
+      if ((record != nullptr) &&
+          (record->state.size == state.size) && (record->state.time == state.time)) {
+        state.hash = record->state.hash;
+        slots[i].emplace(std::move(record->filter), state, false, true);
+        continue;
+      }
+
+      MappedFile contents(paths[i].string());
+      state.hash = contents_hash(contents.contents());
+      if ((record != nullptr) && (record->state.hash == state.hash)) {
+        slots[i].emplace(std::move(record->filter), state, true, true);
+      } else {
+        slots[i].emplace(filter_of(contents.contents()), state, true, false);
+      }
+    }
+  });
+
+  // The table is rewritten unless it describes exactly the files of the workspace, in the same
+  // states.
+  auto up_to_date = records.size() == paths.size();
+  std::vector<SymbolFilter> filters;
+  std::vector<FileState> states;
+  std::vector<bool> checked;
+  std::size_t reused_filter_count = 0;
+  for (auto& s : slots) {
+    up_to_date = up_to_date && s->reused && !s->checked;
+    reused_filter_count += s->reused ? 1 : 0;
+    filters.push_back(std::move(s->filter));
+    states.push_back(s->state);
+    checked.push_back(s->checked);
+  }
+
+  LazyWorkspace result(
+    std::move(paths), std::move(filters), std::move(states), std::move(checked),
+    reused_filter_count, thread_count);
+  if (table.has_value() && !up_to_date) { result.save_filters(*table); }
+  return result;
+}
+
+LazyFile& LazyWorkspace::file(std::size_t i) {
+  if (files[i] == nullptr) {
+    files[i] = std::make_unique<LazyFile>(LazyFile::from_contents_of(_paths[i].string()));
+  }
+  return *files[i];
+}
+
+Definition const* LazyWorkspace::definition(std::size_t i, Symbol const& name, uint64_t h) {
+  if (!filters[i].may_contain(h)) {
+    ++_statistics.skipped_count;
+    return nullptr;
+  }
+
+  ++_statistics.candidate_count;
+  auto& f = file(i);
+  if (auto d = f.definition(name)) { return d; }
+  ++_statistics.miss_count;
+
+  auto const& entries = f.entries();
+  if (std::none_of(entries.begin(), entries.end(), [&](auto const& e) {
+    return SymbolFilter::hash(e.name) == h;
+  })) {
+    ++_statistics.false_positive_count;
+  }
+  return nullptr;
+}
+
+std::vector<std::size_t> LazyWorkspace::check_filters() {
+  std::vector<std::size_t> unchecked;
+  for (std::size_t i = 0; i < _paths.size(); ++i) {
+    if (!checked[i]) { unchecked.push_back(i); }
+  }
+
+  std::vector<uint64_t> hashes(unchecked.size());
+  std::vector<std::optional<SymbolFilter>> rebuilt(unchecked.size());
+  std::atomic<std::size_t> next{0};
+  concurrently(std::min(thread_count, unchecked.size()), [&](std::size_t) {
+    for (auto k = next.fetch_add(1, std::memory_order_relaxed); k < unchecked.size();
+         k = next.fetch_add(1, std::memory_order_relaxed)) {
+      auto i = unchecked[k];
+      MappedFile contents(_paths[i].string());
+      hashes[k] = contents_hash(contents.contents());
+      if (hashes[k] != states[i].hash) { rebuilt[k].emplace(filter_of(contents.contents())); }
+    }
+  });
+
+  std::vector<std::size_t> result;
+  for (std::size_t k = 0; k < unchecked.size(); ++k) {
+    auto i = unchecked[k];
+    checked[i] = true;
+    if (rebuilt[k].has_value()) {
+      filters[i] = std::move(*rebuilt[k]);
+      states[i].hash = hashes[k];
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+Definition const* LazyWorkspace::definition(Symbol const& name) {
+  ++_statistics.query_count;
+  auto h = SymbolFilter::hash(name);
+  if (!h.has_value()) { return nullptr; }
+
+  for (std::size_t i = 0; i < _paths.size(); ++i) {
+    if (auto d = definition(i, name, *h)) { return d; }
+  }
+
+  // A filter reused as is may be stale if its file was replaced by a copy with the same size and
+  // modification time, in which case it may exclude a symbol that the file defines. Only the
+  // files whose filter changed can define `name` at this point.
+  for (auto i : check_filters()) {
+    if (auto d = definition(i, name, *h)) { return d; }
+  }
+  return nullptr;
+}
+
+void LazyWorkspace::save_filters(std::filesystem::path const& table) const {
+  auto size = filters_header_size;
+  for (std::size_t i = 0; i < _paths.size(); ++i) {
+    size += filters_record_size + _paths[i].string().size() + 8 * filters[i].words().size();
+  }
+
+  std::vector<uint8_t> bytes(size);
+  auto p = bytes.data();
+  std::memcpy(p, filters_identifier, sizeof(filters_identifier));
+  write_le(p + 8, filters_version);
+  write_le(p + 12, static_cast<uint32_t>(_paths.size()));
+
+  std::size_t offset = filters_header_size;
+  for (std::size_t i = 0; i < _paths.size(); ++i) {
+    auto s = _paths[i].string();
+    auto words = filters[i].words();
+    write_le(p + offset, static_cast<uint32_t>(s.size()));
+    write_le(p + offset + 4, static_cast<uint32_t>(words.size()));
+    write_le(p + offset + 8, states[i].size);
+    write_le(p + offset + 16, static_cast<uint64_t>(states[i].time));
+    write_le(p + offset + 24, states[i].hash);
+    offset += filters_record_size;
+    std::memcpy(p + offset, s.data(), s.size());
+    offset += s.size();
+    for (auto w : words) {
+      write_le(p + offset, w);
+      offset += 8;
+    }
+  }
+
+  std::ofstream f(table, std::ios::binary | std::ios::trunc);
+  if (f.fail()) { throw std::ios_base::failure("filter table could not be created"); }
+  f.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (f.fail()) { throw std::ios_base::failure("filter table could not be written"); }
+}
+
+} // nir
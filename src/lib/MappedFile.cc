@@ -0,0 +1,78 @@
+#include "MappedFile.hh"
+
+#include <fstream>
+#include <ios>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NIRC_HAS_MMAP 1
+#endif
+
+namespace nir {
+
+/// Copies the contents of the file at `path` into `buffer`.
+inline void copy_contents_of(std::string const& path, std::vector<uint8_t>& buffer) {
+  std::ifstream f(path, std::ios::binary | std::ios::ate);
+  if (f.fail()) { throw std::ios_base::failure("file could not be opened"); }
+
+  buffer.resize(static_cast<std::size_t>(f.tellg()));
+  f.seekg(0, std::ios::beg);
+  f.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+  if (f.fail()) { throw std::ios_base::failure("file could not be read"); }
+}
+
+#ifdef NIRC_HAS_MMAP
+
+MappedFile::MappedFile(std::string const& path) : base(nullptr), size(0) {
+  auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) { throw std::ios_base::failure("file could not be opened"); }
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::ios_base::failure("file could not be opened");
+  }
+
+  // Empty files can't be mapped.
+  size = static_cast<std::size_t>(info.st_size);
+  if (size == 0) {
+    ::close(fd);
+    return;
+  }
+
+  // Prefault the pages since the whole file is about to be decoded.
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE;
+#endif
+
+  auto p = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+  ::close(fd);
+
+  if (p == MAP_FAILED) {
+    size = 0;
+    copy_contents_of(path, fallback);
+  } else {
+    base = p;
+    ::madvise(base, size, MADV_SEQUENTIAL);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (base != nullptr) { ::munmap(base, size); }
+}
+
+#else
+
+MappedFile::MappedFile(std::string const& path) : base(nullptr), size(0) {
+  copy_contents_of(path, fallback);
+}
+
+MappedFile::~MappedFile() {}
+
+#endif
+
+} // nir
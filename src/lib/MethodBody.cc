@@ -0,0 +1,286 @@
+#include "MethodBody.hh"
+#include "Utilities/Assert.hh"
+
+#include <type_traits>
+
+namespace nir {
+
+/// Returns `o` encoded as an immediate.
+inline uint64_t encoded(std::optional<MemoryOrder> const& o) {
+  return o.has_value() ? static_cast<uint64_t>(*o) + 1 : 0;
+}
+
+/// Returns `n`, which is the size of one of the arrays of a method body, as a 32-bit index.
+inline uint32_t index_of(std::size_t n) {
+  precondition(n <= UINT32_MAX, "method body is too large");
+  return static_cast<uint32_t>(n);
+}
+
+MethodBody::MethodBody(std::vector<Instruction> const& instructions) {
+  opcodes.reserve(instructions.size());
+  results.reserve(instructions.size());
+  positions.reserve(instructions.size());
+  scopes.reserve(instructions.size());
+  type_starts.reserve(instructions.size() + 1);
+  operand_starts.reserve(instructions.size() + 1);
+  immediate_starts.reserve(instructions.size() + 1);
+  successor_starts.reserve(instructions.size() + 1);
+
+  LocalConstants locals;
+  for (auto const& i : instructions) {
+    type_starts.push_back(index_of(types.size()));
+    operand_starts.push_back(index_of(operands.size()));
+    immediate_starts.push_back(index_of(immediates.size()));
+    successor_starts.push_back(index_of(successors.size()));
+    append(i, locals);
+  }
+
+  type_starts.push_back(index_of(types.size()));
+  operand_starts.push_back(index_of(operands.size()));
+  immediate_starts.push_back(index_of(immediates.size()));
+  successor_starts.push_back(index_of(successors.size()));
+}
+
+uint32_t MethodBody::constant(Value const& v, LocalConstants& locals) {
+  if (auto l = v.as<value::Local>()) {
+    auto [i, inserted] = locals.emplace(l->id, index_of(constants.size()));
+    if (!inserted) { return i->second; }
+  }
+  auto i = index_of(constants.size());
+  constants.push_back(v);
+  return i;
+}
+
+void MethodBody::push_successor(Next const& n, LocalConstants& locals) {
+  Successor s{Successor::Kind::none, Successor::no_target, index_of(arguments.size()), 0};
+
+  // Unwrap the continuation until its label, collecting arguments on the way.
+  Next const* m = &n;
+  while (true) {
+    if (auto u = std::get_if<next::Unwind>(&m->wrapped)) {
+      if (s.kind == Successor::Kind::none) { s.kind = Successor::Kind::unwind; }
+      arguments.push_back(constant(Value(u->exception), locals));
+      m = &*u->next;
+    } else if (auto c = std::get_if<next::Case>(&m->wrapped)) {
+      if (s.kind == Successor::Kind::none) { s.kind = Successor::Kind::case_; }
+      arguments.push_back(constant(c->value, locals));
+      m = &*c->next;
+    } else if (auto l = std::get_if<next::Label>(&m->wrapped)) {
+      if (s.kind == Successor::Kind::none) { s.kind = Successor::Kind::label; }
+      s.target = l->id;
+      for (auto const& a : l->arguments) { arguments.push_back(constant(a, locals)); }
+      break;
+    } else {
+      break;
+    }
+  }
+
+  s.argument_count = index_of(arguments.size()) - s.first_argument;
+  successors.push_back(s);
+}
+
+void MethodBody::append(Instruction const& i, LocalConstants& locals) {
+  if (auto l = std::get_if<instruction::Let>(&i.wrapped)) {
+    append(*l, locals);
+    return;
+  }
+
+  std::visit([&](auto&& self) {
+    using T = std::decay_t<decltype(self)>;
+    results.push_back(no_result);
+    positions.push_back(self.position);
+    scopes.push_back(ScopeIdentifier::top_level());
+    push_type(Type::unit());
+
+    if constexpr (std::is_same_v<T, instruction::Label>) {
+      opcodes.push_back(Opcode::label);
+      results.back() = self.id;
+      for (auto const& p : self.parameters) { push_operand(Value(p), locals); }
+    } else if constexpr (std::is_same_v<T, instruction::Return>) {
+      opcodes.push_back(Opcode::return_);
+      push_operand(self.value, locals);
+    } else if constexpr (std::is_same_v<T, instruction::Jump>) {
+      opcodes.push_back(Opcode::jump);
+      push_successor(self.target, locals);
+    } else if constexpr (std::is_same_v<T, instruction::If>) {
+      opcodes.push_back(Opcode::if_);
+      push_operand(self.condition, locals);
+      push_successor(self.success, locals);
+      push_successor(self.failure, locals);
+    } else if constexpr (std::is_same_v<T, instruction::Switch>) {
+      opcodes.push_back(Opcode::switch_);
+      push_operand(self.value, locals);
+      for (auto const& t : self.targets) { push_successor(t, locals); }
+    } else if constexpr (std::is_same_v<T, instruction::Throw>) {
+      opcodes.push_back(Opcode::throw_);
+      push_operand(self.exception, locals);
+      push_successor(self.unwind, locals);
+    } else if constexpr (std::is_same_v<T, instruction::Unreachable>) {
+      opcodes.push_back(Opcode::unreachable);
+      push_successor(self.unwind, locals);
+    } else if constexpr (std::is_same_v<T, instruction::LinktimeJump>) {
+      opcodes.push_back(Opcode::linktime_jump);
+      push_immediate(conditions.size());
+      conditions.push_back(self.condition);
+      push_successor(self.success, locals);
+      push_successor(self.failure, locals);
+    }
+  }, i.wrapped);
+}
+
+void MethodBody::append(instruction::Let const& i, LocalConstants& locals) {
+  results.push_back(i.id);
+  positions.push_back(i.position);
+  scopes.push_back(i.scope);
+  push_type(i.operation.result_type());
+
+  std::visit([&](auto&& self) {
+    using T = std::decay_t<decltype(self)>;
+
+    if constexpr (std::is_same_v<T, operation::Call>) {
+      opcodes.push_back(Opcode::call);
+      push_type(Type(self.callee_type));
+      push_operand(self.callee, locals);
+      for (auto const& a : self.arguments) { push_operand(a, locals); }
+    } else if constexpr (std::is_same_v<T, operation::Load>) {
+      opcodes.push_back(Opcode::load);
+      push_type(self.type);
+      push_operand(self.source, locals);
+      push_immediate(encoded(self.ordering));
+    } else if constexpr (std::is_same_v<T, operation::Store>) {
+      opcodes.push_back(Opcode::store);
+      push_type(self.type);
+      push_operand(self.target, locals);
+      push_operand(self.source, locals);
+      push_immediate(encoded(self.ordering));
+    } else if constexpr (std::is_same_v<T, operation::Element>) {
+      opcodes.push_back(Opcode::element);
+      push_type(self.whole_type);
+      push_operand(self.whole, locals);
+      for (auto p : self.path) { push_immediate(p); }
+    } else if constexpr (std::is_same_v<T, operation::Extract>) {
+      opcodes.push_back(Opcode::extract);
+      push_operand(self.whole, locals);
+      for (auto p : self.path) { push_immediate(p); }
+    } else if constexpr (std::is_same_v<T, operation::Insert>) {
+      opcodes.push_back(Opcode::insert);
+      push_operand(self.whole, locals);
+      push_operand(self.part, locals);
+      for (auto p : self.path) { push_immediate(p); }
+    } else if constexpr (std::is_same_v<T, operation::StackAllocate>) {
+      opcodes.push_back(Opcode::stack_allocate);
+      push_type(self.type);
+      push_immediate(self.count);
+    } else if constexpr (std::is_same_v<T, operation::BinaryApply>) {
+      opcodes.push_back(Opcode::binary_apply);
+      push_immediate(static_cast<uint64_t>(self.callee));
+      push_type(self.operand_type);
+      push_operand(self.lhs, locals);
+      push_operand(self.rhs, locals);
+    } else if constexpr (std::is_same_v<T, operation::Compare>) {
+      opcodes.push_back(Opcode::compare);
+      push_immediate(static_cast<uint64_t>(self.callee));
+      push_type(self.operand_type);
+      push_operand(self.lhs, locals);
+      push_operand(self.rhs, locals);
+    } else if constexpr (std::is_same_v<T, operation::Convert>) {
+      opcodes.push_back(Opcode::convert);
+      push_immediate(static_cast<uint64_t>(self.callee));
+      push_type(self.target);
+      push_operand(self.source, locals);
+    } else if constexpr (std::is_same_v<T, operation::Fence>) {
+      opcodes.push_back(Opcode::fence);
+      push_immediate(static_cast<uint64_t>(self.ordering));
+    } else if constexpr (std::is_same_v<T, operation::ClassAllocate>) {
+      opcodes.push_back(Opcode::class_allocate);
+      push_immediate(self.name.raw_value());
+      push_immediate(self.zone.has_value());
+      if (self.zone) { push_operand(*self.zone, locals); }
+    } else if constexpr (std::is_same_v<T, operation::FieldLoad>) {
+      opcodes.push_back(Opcode::field_load);
+      push_type(self.type);
+      push_operand(self.owner, locals);
+      push_immediate(self.name.raw_value());
+    } else if constexpr (std::is_same_v<T, operation::FieldStore>) {
+      opcodes.push_back(Opcode::field_store);
+      push_type(self.type);
+      push_operand(self.owner, locals);
+      push_immediate(self.name.raw_value());
+      push_operand(self.source, locals);
+    } else if constexpr (std::is_same_v<T, operation::Field>) {
+      opcodes.push_back(Opcode::field);
+      push_operand(self.owner, locals);
+      push_immediate(self.name.raw_value());
+    } else if constexpr (
+      std::is_same_v<T, operation::Method> || std::is_same_v<T, operation::DynamicMethod>
+    ) {
+      opcodes.push_back(
+        std::is_same_v<T, operation::Method> ? Opcode::method : Opcode::dynamic_method);
+      push_operand(self.owner, locals);
+      push_immediate(signatures.size());
+      signatures.push_back(self.signature);
+    } else if constexpr (std::is_same_v<T, operation::Module>) {
+      opcodes.push_back(Opcode::module);
+      push_immediate(self.name.raw_value());
+    } else if constexpr (std::is_same_v<T, operation::As>) {
+      opcodes.push_back(Opcode::as);
+      push_type(self.target);
+      push_operand(self.source, locals);
+    } else if constexpr (std::is_same_v<T, operation::Is>) {
+      opcodes.push_back(Opcode::is);
+      push_type(self.target);
+      push_operand(self.source, locals);
+    } else if constexpr (std::is_same_v<T, operation::Copy>) {
+      opcodes.push_back(Opcode::copy);
+      push_operand(self.source, locals);
+    } else if constexpr (std::is_same_v<T, operation::SizeOf>) {
+      opcodes.push_back(Opcode::size_of);
+      push_type(self.operand);
+    } else if constexpr (std::is_same_v<T, operation::AlignmentOf>) {
+      opcodes.push_back(Opcode::alignment_of);
+      push_type(self.operand);
+    } else if constexpr (std::is_same_v<T, operation::Box>) {
+      opcodes.push_back(Opcode::box);
+      push_type(self.box_type);
+      push_operand(self.contents, locals);
+    } else if constexpr (std::is_same_v<T, operation::Unbox>) {
+      opcodes.push_back(Opcode::unbox);
+      push_type(self.box_type);
+      push_operand(self.box, locals);
+    } else if constexpr (std::is_same_v<T, operation::Var>) {
+      opcodes.push_back(Opcode::var);
+      push_type(self.type);
+    } else if constexpr (std::is_same_v<T, operation::VarLoad>) {
+      opcodes.push_back(Opcode::var_load);
+      push_operand(self.slot, locals);
+    } else if constexpr (std::is_same_v<T, operation::VarStore>) {
+      opcodes.push_back(Opcode::var_store);
+      push_operand(self.slot, locals);
+      push_operand(self.source, locals);
+    } else if constexpr (std::is_same_v<T, operation::ArrayAllocate>) {
+      opcodes.push_back(Opcode::array_allocate);
+      push_type(self.element);
+      push_operand(self.initializer, locals);
+      push_immediate(self.zone.has_value());
+      if (self.zone) { push_operand(*self.zone, locals); }
+    } else if constexpr (std::is_same_v<T, operation::ArrayLoad>) {
+      opcodes.push_back(Opcode::array_load);
+      push_type(self.type);
+      push_operand(self.owner, locals);
+      push_immediate(self.position);
+    } else if constexpr (std::is_same_v<T, operation::ArrayStore>) {
+      opcodes.push_back(Opcode::array_store);
+      push_type(self.type);
+      push_operand(self.owner, locals);
+      push_immediate(self.position);
+      push_operand(self.source, locals);
+    } else if constexpr (std::is_same_v<T, operation::ArrayLength>) {
+      opcodes.push_back(Opcode::array_length);
+      push_operand(self.operand, locals);
+    }
+  }, i.operation.wrapped);
+
+  push_successor(i.next, locals);
+}
+
+} // nir
@@ -0,0 +1,978 @@
+#include "AttributeSet.hh"
+#include "Serializer.hh"
+#include "Tags.hh"
+#include "Utilities/Assert.hh"
+#include "Utilities/LittleEndian.hh"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace nir {
+
+/// The first byte of a back-reference to an interned entity.
+inline constexpr uint8_t back_reference = 0xff;
+
+/// Returns the number of bytes in the unsigned LEB128 encoding of `v`.
+inline std::size_t unsigned_leb128_size(uint64_t v) {
+  return (static_cast<std::size_t>(std::bit_width(v | 1)) + 6) / 7;
+}
+
+/// Returns the length of the longest common prefix of `a` and `b`.
+inline std::size_t common_prefix_size(std::string_view a, std::string_view b) {
+  auto n = std::min(a.size(), b.size());
+  auto i = std::mismatch(a.begin(), a.begin() + n, b.begin()).first;
+  return static_cast<std::size_t>(i - a.begin());
+}
+
+/// Returns the key of the edge from the node at index `n` in a radix tree of strings to the child
+/// whose label starts with `c`.
+inline uint64_t prefix_edge(uint32_t n, char c) {
+  return (uint64_t{n} << 8) | static_cast<uint8_t>(c);
+}
+
+/// Returns a hash combining `seed` with `h`.
+inline std::size_t combined(std::size_t seed, std::size_t h) {
+  return seed ^ (h + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+/// Appends `v` to `target` in little-endian.
+template<typename T>
+void append_le(std::vector<uint8_t>& target, T v) {
+  auto n = target.size();
+  target.resize(n + sizeof(T));
+  write_le(target.data() + n, v);
+}
+
+/// Returns the tag identifying the kind of `w` in the encoding of values.
+template<typename T>
+tag::Value value_tag(T const& w) {
+  if constexpr (std::is_same_v<T, value::Null>) { return tag::Value::null; }
+  else if constexpr (std::is_same_v<T, value::Unit>) { return tag::Value::unit; }
+  else if constexpr (std::is_same_v<T, value::Zero>) { return tag::Value::zero; }
+  else if constexpr (std::is_same_v<T, value::Boolean>) {
+    return w ? tag::Value::true_ : tag::Value::false_;
+  }
+  else if constexpr (std::is_same_v<T, value::Size>) { return tag::Value::size; }
+  else if constexpr (std::is_same_v<T, value::Char>) { return tag::Value::char_; }
+  else if constexpr (std::is_same_v<T, value::Byte>) { return tag::Value::byte; }
+  else if constexpr (std::is_same_v<T, value::Short>) { return tag::Value::short_; }
+  else if constexpr (std::is_same_v<T, value::Int>) { return tag::Value::int_; }
+  else if constexpr (std::is_same_v<T, value::Long>) { return tag::Value::long_; }
+  else if constexpr (std::is_same_v<T, value::Float>) { return tag::Value::float_; }
+  else if constexpr (std::is_same_v<T, value::Double>) { return tag::Value::double_; }
+  else if constexpr (std::is_same_v<T, value::ArrayValue>) { return tag::Value::array; }
+  else if constexpr (std::is_same_v<T, value::Struct>) { return tag::Value::struct_; }
+  else if constexpr (std::is_same_v<T, value::ByteString>) { return tag::Value::byte_string; }
+  else if constexpr (std::is_same_v<T, value::Local>) { return tag::Value::local; }
+  else if constexpr (std::is_same_v<T, value::Symbol>) { return tag::Value::symbol; }
+  else if constexpr (std::is_same_v<T, value::Constant>) { return tag::Value::constant; }
+  else if constexpr (std::is_same_v<T, value::String>) { return tag::Value::string; }
+  else if constexpr (std::is_same_v<T, value::Virtual>) { return tag::Value::virtual_; }
+  else {
+    static_assert(std::is_same_v<T, value::ClassOf>, "not a value");
+    return tag::Value::class_of;
+  }
+}
+
+/// Returns the tag of `t`, which is a predefined type or the type of a Scala primitive.
+inline tag::Type primitive_tag(Type const& t) {
+  if (auto p = t.as<type::Predefined>()) {
+    switch (*p) {
+      case type::Predefined::null:
+        return tag::Type::null;
+      case type::Predefined::unit:
+        return tag::Type::unit;
+      case type::Predefined::pointer:
+        return tag::Type::pointer;
+      case type::Predefined::size:
+        return tag::Type::size;
+      case type::Predefined::vararg:
+        return tag::Type::vararg;
+      case type::Predefined::nothing:
+        return tag::Type::nothing;
+      case type::Predefined::virtual_:
+        return tag::Type::virtual_;
+    }
+  } else if (t == Type::u1()) {
+    return tag::Type::boolean;
+  } else if (t == Type::u16()) {
+    return tag::Type::char_;
+  } else if (t == Type::i8()) {
+    return tag::Type::byte;
+  } else if (t == Type::i16()) {
+    return tag::Type::short_;
+  } else if (t == Type::i32()) {
+    return tag::Type::int_;
+  } else if (t == Type::i64()) {
+    return tag::Type::long_;
+  } else if (t == Type::f32()) {
+    return tag::Type::float_;
+  } else if (t == Type::f64()) {
+    return tag::Type::double_;
+  }
+  fatal_error("type has no encoding");
+}
+
+std::size_t Serializer::ValueIdentity::operator()(Value const& v) const {
+  return v.visit([&](auto const& w) -> std::size_t {
+    using T = std::decay_t<decltype(w)>;
+    auto h = static_cast<std::size_t>(raw_value(value_tag(w)));
+
+    if constexpr (std::is_same_v<T, value::Null> || std::is_same_v<T, value::Unit>) {
+      return h;
+    } else if constexpr (std::is_same_v<T, value::Zero>) {
+      return combined(h, std::hash<Type>{}(w.type()));
+    } else if constexpr (std::is_same_v<T, value::Float>) {
+      return combined(h, std::bit_cast<uint32_t>(w));
+    } else if constexpr (std::is_same_v<T, value::Double>) {
+      return combined(h, std::bit_cast<uint64_t>(w));
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      return combined(h, static_cast<std::size_t>(w));
+    } else if constexpr (std::is_same_v<T, value::Size>) {
+      return combined(h, w.raw_value);
+    } else if constexpr (std::is_same_v<T, value::ArrayValue>) {
+      h = combined(h, std::hash<Type>{}(w.element_type));
+      w.for_each([&](Value const& e) { h = combined(h, (*this)(e)); });
+      return h;
+    } else if constexpr (std::is_same_v<T, value::Struct>) {
+      for (auto const& e : *w.elements) { h = combined(h, (*this)(e)); }
+      return h;
+    } else if constexpr (std::is_same_v<T, value::ByteString>) {
+      auto s = std::string_view(reinterpret_cast<char const*>(w.bytes.data()), w.bytes.size());
+      return combined(h, std::hash<std::string_view>{}(s));
+    } else if constexpr (std::is_same_v<T, value::Local>) {
+      return combined(combined(h, w.id), std::hash<Type>{}(w.type()));
+    } else if constexpr (std::is_same_v<T, value::Symbol>) {
+      return combined(combined(h, std::hash<Symbol>{}(w.name)), std::hash<Type>{}(w.type()));
+    } else if constexpr (std::is_same_v<T, value::Constant>) {
+      return combined(h, (*this)(*w.value));
+    } else if constexpr (std::is_same_v<T, value::String>) {
+      return combined(h, std::hash<std::string_view>{}(w.value));
+    } else if constexpr (std::is_same_v<T, value::Virtual>) {
+      return combined(h, w.key);
+    } else {
+      return combined(h, std::hash<symbol::Top>{}(w.name));
+    }
+  });
+}
+
+bool Serializer::ValueIdentity::operator()(Value const& a, Value const& b) const {
+  return a.visit([&](auto const& x) -> bool {
+    using T = std::decay_t<decltype(x)>;
+    auto y = b.as<T>();
+    if (!y) { return false; }
+
+    if constexpr (std::is_same_v<T, value::Zero>) {
+      return x.type() == y->type();
+    } else if constexpr (std::is_same_v<T, value::Float>) {
+      return std::bit_cast<uint32_t>(x) == std::bit_cast<uint32_t>(*y);
+    } else if constexpr (std::is_same_v<T, value::Double>) {
+      return std::bit_cast<uint64_t>(x) == std::bit_cast<uint64_t>(*y);
+    } else if constexpr (std::is_same_v<T, value::ArrayValue>) {
+      if ((x.element_type != y->element_type) || (x.size() != y->size())) { return false; }
+      auto xs = x.template elements_as<Value>();
+      auto ys = y->template elements_as<Value>();
+      if (xs.has_value() && ys.has_value()) {
+        return std::equal(xs->begin(), xs->end(), ys->begin(), ys->end(), *this);
+      }
+      for (std::size_t i = 0; i < x.size(); ++i) {
+        if (!(*this)(x[i], (*y)[i])) { return false; }
+      }
+      return true;
+    } else if constexpr (std::is_same_v<T, value::Struct>) {
+      return std::equal(
+        x.elements->begin(), x.elements->end(), y->elements->begin(), y->elements->end(), *this);
+    } else if constexpr (std::is_same_v<T, value::Constant>) {
+      return (*this)(*x.value, *y->value);
+    } else {
+      return x == *y;
+    }
+  });
+}
+
+void Serializer::header(Header const& h) {
+  // The header is encoded in big-endian.
+  for (auto v : {file_identifier, int32_t{h.compatibility_level}, int32_t{h.revision}}) {
+    auto u = static_cast<uint32_t>(v);
+    for (int s = 24; s >= 0; s -= 8) { u8(static_cast<uint8_t>(u >> s)); }
+  }
+}
+
+template<typename C, typename F>
+void Serializer::sequence(C const& elements, F&& encode) {
+  unsigned_leb128(std::size(elements));
+  for (auto const& e : elements) { encode(*this, e); }
+}
+
+template<typename T, typename F>
+void Serializer::optional(std::optional<T> const& v, F&& encode) {
+  boolean(v.has_value());
+  if (v.has_value()) { encode(*this, *v); }
+}
+
+template<typename T, typename M, typename F>
+void Serializer::internable(M& memo, T const& v, F&& encode) {
+  if (auto i = memo.find(v); i != memo.end()) {
+    u8(back_reference);
+    unsigned_leb128(i->second);
+  } else {
+    // Entities are interned under the same condition as in `Deserializer::internable`, after the
+    // entities that they contain.
+    auto p = target.size();
+    encode(*this, v);
+    if (target.size() > (p + 2)) {
+      auto n = memo.size();
+      memo.emplace(v, n);
+    }
+  }
+}
+
+void Serializer::symbol(Symbol const& s) {
+  internable(interned_symbols, s, [](Serializer& self, Symbol const& s) {
+    if (auto t = s.as<symbol::Top>()) {
+      self.u8(raw_value(tag::Symbol::top));
+      self.string(t->id());
+    } else if (auto m = s.as<symbol::Member>()) {
+      self.u8(raw_value(tag::Symbol::member));
+      self.symbol(Symbol(m->top()));
+      self.signature(m->signature());
+    } else {
+      self.u8(raw_value(tag::Symbol::none));
+    }
+  });
+}
+
+void Serializer::signature(Signature const& s) {
+  string(s.mangled_name);
+}
+
+void Serializer::definition(Definition const& d) {
+  std::visit([&](auto const& w) {
+    using T = std::decay_t<decltype(w)>;
+
+    // Most definitions have no attribute, in which case there is no need to list them.
+    auto attributes = [&]() {
+      if (w.attributes.size() == 0) {
+        unsigned_leb128(0);
+      } else {
+        sequence(w.attributes.elements(), [](auto& self, auto const& a) { self.attribute(a); });
+      }
+    };
+    auto top = [](auto& self, symbol::Top const& s) { self.symbol(Symbol(s)); };
+
+    if constexpr (std::is_same_v<T, definition::Binding>) {
+      u8(raw_value(w.is_constant ? tag::Definition::constant : tag::Definition::variable));
+      attributes();
+      symbol(Symbol(w.name));
+      type(w.type);
+      value(w.initializer);
+    } else if constexpr (std::is_same_v<T, definition::Forward>) {
+      u8(raw_value(tag::Definition::declare));
+      attributes();
+      symbol(Symbol(w.name));
+      type(Type(w.type));
+    } else if constexpr (std::is_same_v<T, definition::Method>) {
+      u8(raw_value(tag::Definition::define));
+      attributes();
+      symbol(Symbol(w.name));
+      type(Type(w.type));
+      sequence(w.instructions, [](auto& self, auto const& i) { self.instruction(i); });
+      debug(w.debug);
+    } else if constexpr (std::is_same_v<T, definition::Trait>) {
+      u8(raw_value(tag::Definition::trait));
+      attributes();
+      symbol(Symbol(w.name));
+      sequence(w.bases, top);
+    } else {
+      u8(raw_value(
+        std::is_same_v<T, definition::Class> ? tag::Definition::class_ : tag::Definition::module));
+      attributes();
+      symbol(Symbol(w.name));
+      optional(w.parent, top);
+      sequence(w.traits, top);
+    }
+    source_position(w.position);
+  }, d.wrapped);
+}
+
+void Serializer::debug(definition::Method::DebugInformation const& d) {
+  local_name(d.local_name);
+  sequence(d.scopes, [](auto& self, auto const& s) { self.lexical_scope(s); });
+}
+
+void Serializer::local_name(std::unordered_map<Local, std::string_view> const& m) {
+  // The entries are sorted so that the encoding doesn't depend on the order of the map.
+  std::vector<std::pair<Local, std::string_view>> entries(m.begin(), m.end());
+  std::sort(entries.begin(), entries.end(), [](auto const& a, auto const& b) {
+    return a.first < b.first;
+  });
+
+  unsigned_leb128(entries.size());
+  for (auto const& [k, v] : entries) {
+    local(k);
+    string(v);
+  }
+}
+
+void Serializer::lexical_scope(LexicalScope const& s) {
+  scope_identifier(s.id);
+  scope_identifier(s.parent);
+  source_position(s.position);
+}
+
+void Serializer::instruction(Instruction const& i) {
+  std::visit([&](auto const& w) {
+    using T = std::decay_t<decltype(w)>;
+
+    if constexpr (std::is_same_v<T, instruction::Label>) {
+      u8(raw_value(tag::Instruction::label));
+      local(w.id);
+      sequence(w.parameters, [](auto& self, auto const& p) { self.value(Value(p)); });
+      source_position(w.position);
+    } else if constexpr (std::is_same_v<T, instruction::Let>) {
+      u8(raw_value(tag::Instruction::let));
+      local(w.id);
+      operation(w.operation);
+      next(w.next);
+      source_position(w.position);
+      scope_identifier(w.scope);
+    } else if constexpr (std::is_same_v<T, instruction::Return>) {
+      u8(raw_value(tag::Instruction::return_));
+      value(w.value);
+      source_position(w.position);
+    } else if constexpr (std::is_same_v<T, instruction::Jump>) {
+      u8(raw_value(tag::Instruction::jump));
+      next(w.target);
+      source_position(w.position);
+    } else if constexpr (std::is_same_v<T, instruction::If>) {
+      u8(raw_value(tag::Instruction::if_));
+      value(w.condition);
+      next(w.success);
+      next(w.failure);
+      source_position(w.position);
+    } else if constexpr (std::is_same_v<T, instruction::Switch>) {
+      u8(raw_value(tag::Instruction::switch_));
+      value(w.value);
+      sequence(w.targets, [](auto& self, auto const& n) { self.next(n); });
+      source_position(w.position);
+    } else if constexpr (std::is_same_v<T, instruction::Throw>) {
+      u8(raw_value(tag::Instruction::throw_));
+      value(w.exception);
+      next(w.unwind);
+      source_position(w.position);
+    } else if constexpr (std::is_same_v<T, instruction::Unreachable>) {
+      u8(raw_value(tag::Instruction::unreachable));
+      next(w.unwind);
+      source_position(w.position);
+    } else {
+      static_assert(std::is_same_v<T, instruction::LinktimeJump>);
+      u8(raw_value(tag::Instruction::linktime_if));
+      linktime_condition(w.condition);
+      next(w.success);
+      next(w.failure);
+      source_position(w.position);
+    }
+  }, i.wrapped);
+}
+
+void Serializer::type(Type const& t) {
+  internable(interned_types, t, [](Serializer& self, Type const& t) {
+    if (auto a = t.as<type::ArrayValue>()) {
+      self.u8(raw_value(tag::Type::array_value));
+      self.type(a->element);
+      self.unsigned_leb128(a->size);
+    } else if (auto s = t.as<type::Struct>()) {
+      self.u8(raw_value(tag::Type::struct_value));
+      self.sequence(s->elements, [](auto& self, auto const& e) { self.type(e); });
+    } else if (auto f = t.as<type::Function>()) {
+      self.u8(raw_value(tag::Type::function));
+      self.sequence(f->parameters, [](auto& self, auto const& p) { self.type(p); });
+      self.type(f->return_value);
+    } else if (auto v = t.as<type::Var>()) {
+      self.u8(raw_value(tag::Type::var));
+      self.type(v->type);
+    } else if (auto a = t.as<type::ArrayReference>()) {
+      self.u8(raw_value(tag::Type::array));
+      self.type(a->element);
+      self.boolean(a->is_nullable);
+    } else if (auto r = t.as<type::Reference>()) {
+      self.u8(raw_value(tag::Type::reference));
+      self.symbol(Symbol(r->name));
+      self.boolean(r->is_exact);
+      self.boolean(r->is_nullable);
+    } else {
+      self.u8(raw_value(primitive_tag(t)));
+    }
+  });
+}
+
+void Serializer::value(Value const& v) {
+  internable(interned_values, v, [](Serializer& self, Value const& v) {
+    v.visit([&](auto const& w) {
+      using T = std::decay_t<decltype(w)>;
+      self.u8(raw_value(value_tag(w)));
+
+      if constexpr (std::is_same_v<T, value::Zero>) {
+        self.type(w.type());
+      } else if constexpr (std::is_same_v<T, value::Size>) {
+        self.unsigned_leb128(w.raw_value);
+      } else if constexpr (std::is_same_v<T, value::Char>) {
+        self.unsigned_leb128(w);
+      } else if constexpr (std::is_same_v<T, value::Byte>) {
+        self.u8(static_cast<uint8_t>(w));
+      } else if constexpr (
+        std::is_same_v<T, value::Short> || std::is_same_v<T, value::Int> ||
+        std::is_same_v<T, value::Long>
+      ) {
+        self.signed_leb128(w);
+      } else if constexpr (std::is_same_v<T, value::Float>) {
+        append_le(self.target, std::bit_cast<uint32_t>(w));
+      } else if constexpr (std::is_same_v<T, value::Double>) {
+        append_le(self.target, std::bit_cast<uint64_t>(w));
+      } else if constexpr (std::is_same_v<T, value::ArrayValue>) {
+        self.array_value(w);
+      } else if constexpr (std::is_same_v<T, value::Struct>) {
+        self.sequence(*w.elements, [](auto& self, auto const& e) { self.value(e); });
+      } else if constexpr (std::is_same_v<T, value::ByteString>) {
+        self.bytes(w.bytes);
+      } else if constexpr (std::is_same_v<T, value::Local>) {
+        self.local(w.id);
+        self.type(w.type());
+      } else if constexpr (std::is_same_v<T, value::Symbol>) {
+        self.symbol(w.name);
+        self.type(w.type());
+      } else if constexpr (std::is_same_v<T, value::Constant>) {
+        self.value(*w.value);
+      } else if constexpr (std::is_same_v<T, value::String>) {
+        self.string(w.value);
+      } else if constexpr (std::is_same_v<T, value::Virtual>) {
+        self.unsigned_leb128(w.key);
+      } else if constexpr (std::is_same_v<T, value::ClassOf>) {
+        self.symbol(Symbol(w.name));
+      }
+    });
+  });
+}
+
+void Serializer::array_value(value::ArrayValue const& v) {
+  // Elements are written as values whatever their storage, as `Deserializer::array_value` reads
+  // them.
+  type(v.element_type);
+  unsigned_leb128(v.size());
+  v.for_each([&](Value const& e) { value(e); });
+}
+
+void Serializer::next(Next const& n) {
+  std::visit([&](auto const& w) {
+    using T = std::decay_t<decltype(w)>;
+
+    if constexpr (std::is_same_v<T, next::None>) {
+      u8(raw_value(tag::Next::none));
+    } else if constexpr (std::is_same_v<T, next::Unwind>) {
+      u8(raw_value(tag::Next::unwind));
+      value(Value(w.exception));
+      next(*w.next);
+    } else if constexpr (std::is_same_v<T, next::Case>) {
+      u8(raw_value(tag::Next::case_));
+      value(w.value);
+      next(*w.next);
+    } else {
+      u8(raw_value(tag::Next::label));
+      local(w.id);
+      sequence(w.arguments, [](auto& self, auto const& a) { self.value(a); });
+    }
+  }, n.wrapped);
+}
+
+void Serializer::linktime_condition(LinktimeCondition const& c) {
+  std::visit([&](auto&& w) {
+    using T = std::decay_t<decltype(w)>;
+
+    if constexpr (std::is_same_v<T, linktime::SimpleCondition>) {
+      u8(raw_value(tag::LinktimeCondition::simple));
+      string(w.lhs);
+      comparison_operator(w.relation);
+      value(w.rhs);
+      source_position(w.position);
+    } else {
+      static_assert(std::is_same_v<T, linktime::ComplexCondition>);
+      u8(raw_value(tag::LinktimeCondition::complex));
+      logical_operator(w.relation);
+      linktime_condition(*w.lhs);
+      linktime_condition(*w.rhs);
+      source_position(w.position);
+    }
+  }, c.wrapped);
+}
+
+void Serializer::operation(Operation const& o) {
+  auto values = [](auto& self, auto const& v) { self.value(v); };
+
+  std::visit([&](auto const& w) {
+    using T = std::decay_t<decltype(w)>;
+
+    if constexpr (std::is_same_v<T, operation::Call>) {
+      u8(raw_value(tag::Operation::call));
+      type(Type(w.callee_type));
+      value(w.callee);
+      sequence(w.arguments, values);
+    } else if constexpr (std::is_same_v<T, operation::Load>) {
+      precondition(w.ordering.has_value(), "load has no memory order");
+      u8(raw_value(tag::Operation::load));
+      type(w.type);
+      value(w.source);
+      memory_order(*w.ordering);
+    } else if constexpr (std::is_same_v<T, operation::Store>) {
+      precondition(w.ordering.has_value(), "store has no memory order");
+      u8(raw_value(tag::Operation::store));
+      type(w.type);
+      value(w.target);
+      value(w.source);
+      memory_order(*w.ordering);
+    } else if constexpr (std::is_same_v<T, operation::Element>) {
+      u8(raw_value(tag::Operation::element));
+      type(w.whole_type);
+      value(w.whole);
+      uint32_sequence(w.path);
+    } else if constexpr (std::is_same_v<T, operation::Extract>) {
+      u8(raw_value(tag::Operation::extract));
+      value(w.whole);
+      uint32_sequence(w.path);
+    } else if constexpr (std::is_same_v<T, operation::Insert>) {
+      u8(raw_value(tag::Operation::insert));
+      value(w.whole);
+      value(w.part);
+      uint32_sequence(w.path);
+    } else if constexpr (std::is_same_v<T, operation::StackAllocate>) {
+      u8(raw_value(tag::Operation::stackalloc));
+      type(w.type);
+      unsigned_leb128(w.count);
+    } else if constexpr (std::is_same_v<T, operation::BinaryApply>) {
+      u8(raw_value(tag::Operation::binary));
+      binary_operator(w.callee);
+      type(w.operand_type);
+      value(w.lhs);
+      value(w.rhs);
+    } else if constexpr (std::is_same_v<T, operation::Compare>) {
+      u8(raw_value(tag::Operation::compare));
+      comparison_operator(w.callee);
+      type(w.operand_type);
+      value(w.lhs);
+      value(w.rhs);
+    } else if constexpr (std::is_same_v<T, operation::Convert>) {
+      u8(raw_value(tag::Operation::convert));
+      conversion_operator(w.callee);
+      type(w.target);
+      value(w.source);
+    } else if constexpr (std::is_same_v<T, operation::Fence>) {
+      u8(raw_value(tag::Operation::fence));
+      memory_order(w.ordering);
+    } else if constexpr (std::is_same_v<T, operation::ClassAllocate>) {
+      u8(raw_value(tag::Operation::classalloc));
+      symbol(Symbol(w.name));
+      optional(w.zone, values);
+    } else if constexpr (std::is_same_v<T, operation::FieldLoad>) {
+      u8(raw_value(tag::Operation::fieldload));
+      type(w.type);
+      value(w.owner);
+      symbol(Symbol(w.name));
+    } else if constexpr (std::is_same_v<T, operation::FieldStore>) {
+      u8(raw_value(tag::Operation::fieldstore));
+      type(w.type);
+      value(w.owner);
+      symbol(Symbol(w.name));
+      value(w.source);
+    } else if constexpr (std::is_same_v<T, operation::Field>) {
+      u8(raw_value(tag::Operation::field));
+      value(w.owner);
+      symbol(Symbol(w.name));
+    } else if constexpr (std::is_same_v<T, operation::Method>) {
+      u8(raw_value(tag::Operation::method));
+      value(w.owner);
+      signature(w.signature);
+    } else if constexpr (std::is_same_v<T, operation::DynamicMethod>) {
+      u8(raw_value(tag::Operation::dynmethod));
+      value(w.owner);
+      signature(w.signature);
+    } else if constexpr (std::is_same_v<T, operation::Module>) {
+      u8(raw_value(tag::Operation::module));
+      symbol(Symbol(w.name));
+    } else if constexpr (std::is_same_v<T, operation::As>) {
+      u8(raw_value(tag::Operation::as));
+      type(w.target);
+      value(w.source);
+    } else if constexpr (std::is_same_v<T, operation::Is>) {
+      u8(raw_value(tag::Operation::is));
+      type(w.target);
+      value(w.source);
+    } else if constexpr (std::is_same_v<T, operation::Copy>) {
+      u8(raw_value(tag::Operation::copy));
+      value(w.source);
+    } else if constexpr (std::is_same_v<T, operation::SizeOf>) {
+      u8(raw_value(tag::Operation::size_of));
+      type(w.operand);
+    } else if constexpr (std::is_same_v<T, operation::AlignmentOf>) {
+      u8(raw_value(tag::Operation::alignment_of));
+      type(w.operand);
+    } else if constexpr (std::is_same_v<T, operation::Box>) {
+      u8(raw_value(tag::Operation::box));
+      type(w.box_type);
+      value(w.contents);
+    } else if constexpr (std::is_same_v<T, operation::Unbox>) {
+      u8(raw_value(tag::Operation::unbox));
+      type(w.box_type);
+      value(w.box);
+    } else if constexpr (std::is_same_v<T, operation::Var>) {
+      u8(raw_value(tag::Operation::var));
+      type(w.type);
+    } else if constexpr (std::is_same_v<T, operation::VarLoad>) {
+      u8(raw_value(tag::Operation::varload));
+      value(w.slot);
+    } else if constexpr (std::is_same_v<T, operation::VarStore>) {
+      u8(raw_value(tag::Operation::varstore));
+      value(w.slot);
+      value(w.source);
+    } else if constexpr (std::is_same_v<T, operation::ArrayAllocate>) {
+      u8(raw_value(tag::Operation::arrayalloc));
+      type(w.element);
+      value(w.initializer);
+      optional(w.zone, values);
+    } else if constexpr (std::is_same_v<T, operation::ArrayLoad>) {
+      u8(raw_value(tag::Operation::arrayload));
+      type(w.type);
+      value(w.owner);
+      uint32(w.position);
+    } else if constexpr (std::is_same_v<T, operation::ArrayStore>) {
+      u8(raw_value(tag::Operation::arraystore));
+      type(w.type);
+      value(w.owner);
+      uint32(w.position);
+      value(w.source);
+    } else {
+      static_assert(std::is_same_v<T, operation::ArrayLength>);
+      u8(raw_value(tag::Operation::arraylength));
+      value(w.operand);
+    }
+  }, o.wrapped);
+}
+
+void Serializer::binary_operator(BinaryOperator o) {
+  switch (o) {
+    case BinaryOperator::iadd:
+      return u8(raw_value(tag::BinaryOperator::iadd));
+    case BinaryOperator::fadd:
+      return u8(raw_value(tag::BinaryOperator::fadd));
+    case BinaryOperator::isub:
+      return u8(raw_value(tag::BinaryOperator::isub));
+    case BinaryOperator::fsub:
+      return u8(raw_value(tag::BinaryOperator::fsub));
+    case BinaryOperator::imul:
+      return u8(raw_value(tag::BinaryOperator::imul));
+    case BinaryOperator::fmul:
+      return u8(raw_value(tag::BinaryOperator::fmul));
+    case BinaryOperator::sdiv:
+      return u8(raw_value(tag::BinaryOperator::sdiv));
+    case BinaryOperator::udiv:
+      return u8(raw_value(tag::BinaryOperator::udiv));
+    case BinaryOperator::fdiv:
+      return u8(raw_value(tag::BinaryOperator::fdiv));
+    case BinaryOperator::srem:
+      return u8(raw_value(tag::BinaryOperator::srem));
+    case BinaryOperator::urem:
+      return u8(raw_value(tag::BinaryOperator::urem));
+    case BinaryOperator::frem:
+      return u8(raw_value(tag::BinaryOperator::frem));
+    case BinaryOperator::shl:
+      return u8(raw_value(tag::BinaryOperator::shl));
+    case BinaryOperator::lshr:
+      return u8(raw_value(tag::BinaryOperator::lshr));
+    case BinaryOperator::ashr:
+      return u8(raw_value(tag::BinaryOperator::ashr));
+    case BinaryOperator::and_:
+      return u8(raw_value(tag::BinaryOperator::and_));
+    case BinaryOperator::or_:
+      return u8(raw_value(tag::BinaryOperator::or_));
+    case BinaryOperator::xor_:
+      return u8(raw_value(tag::BinaryOperator::xor_));
+  }
+  fatal_error("unexpected operator");
+}
+
+void Serializer::comparison_operator(ComparisonOperator o) {
+  switch (o) {
+    case ComparisonOperator::ieq:
+      return u8(raw_value(tag::ComparisonOperator::ieq));
+    case ComparisonOperator::ine:
+      return u8(raw_value(tag::ComparisonOperator::ine));
+    case ComparisonOperator::ugt:
+      return u8(raw_value(tag::ComparisonOperator::ugt));
+    case ComparisonOperator::uge:
+      return u8(raw_value(tag::ComparisonOperator::uge));
+    case ComparisonOperator::ult:
+      return u8(raw_value(tag::ComparisonOperator::ult));
+    case ComparisonOperator::ule:
+      return u8(raw_value(tag::ComparisonOperator::ule));
+    case ComparisonOperator::sgt:
+      return u8(raw_value(tag::ComparisonOperator::sgt));
+    case ComparisonOperator::sge:
+      return u8(raw_value(tag::ComparisonOperator::sge));
+    case ComparisonOperator::slt:
+      return u8(raw_value(tag::ComparisonOperator::slt));
+    case ComparisonOperator::sle:
+      return u8(raw_value(tag::ComparisonOperator::sle));
+    case ComparisonOperator::feq:
+      return u8(raw_value(tag::ComparisonOperator::feq));
+    case ComparisonOperator::fne:
+      return u8(raw_value(tag::ComparisonOperator::fne));
+    case ComparisonOperator::fgt:
+      return u8(raw_value(tag::ComparisonOperator::fgt));
+    case ComparisonOperator::fge:
+      return u8(raw_value(tag::ComparisonOperator::fge));
+    case ComparisonOperator::flt:
+      return u8(raw_value(tag::ComparisonOperator::flt));
+    case ComparisonOperator::fle:
+      return u8(raw_value(tag::ComparisonOperator::fle));
+  }
+  fatal_error("unexpected operator");
+}
+
+void Serializer::logical_operator(LogicalOperator o) {
+  binary_operator((o == LogicalOperator::and_) ? BinaryOperator::and_ : BinaryOperator::or_);
+}
+
+void Serializer::conversion_operator(ConversionOperator o) {
+  switch (o) {
+    case ConversionOperator::trunc:
+      return u8(raw_value(tag::ConversionOperator::trunc));
+    case ConversionOperator::zext:
+      return u8(raw_value(tag::ConversionOperator::zext));
+    case ConversionOperator::sext:
+      return u8(raw_value(tag::ConversionOperator::sext));
+    case ConversionOperator::fptrunc:
+      return u8(raw_value(tag::ConversionOperator::fptrunc));
+    case ConversionOperator::fpext:
+      return u8(raw_value(tag::ConversionOperator::fpext));
+    case ConversionOperator::fptoui:
+      return u8(raw_value(tag::ConversionOperator::fptoui));
+    case ConversionOperator::fptosi:
+      return u8(raw_value(tag::ConversionOperator::fptosi));
+    case ConversionOperator::uitofp:
+      return u8(raw_value(tag::ConversionOperator::uitofp));
+    case ConversionOperator::sitofp:
+      return u8(raw_value(tag::ConversionOperator::sitofp));
+    case ConversionOperator::ptrtoint:
+      return u8(raw_value(tag::ConversionOperator::ptrtoint));
+    case ConversionOperator::inttoptr:
+      return u8(raw_value(tag::ConversionOperator::inttoptr));
+    case ConversionOperator::bitcast:
+      return u8(raw_value(tag::ConversionOperator::bitcast));
+    case ConversionOperator::ssize_cast:
+      return u8(raw_value(tag::ConversionOperator::ssize_cast));
+    case ConversionOperator::zsize_cast:
+      return u8(raw_value(tag::ConversionOperator::zsize_cast));
+  }
+  fatal_error("unexpected operator");
+}
+
+void Serializer::memory_order(MemoryOrder o) {
+  u8(static_cast<uint8_t>(o));
+}
+
+void Serializer::local(Local l) {
+  unsigned_leb128(l);
+}
+
+void Serializer::attribute(Attribute const& a) {
+  using namespace attribute;
+
+  if (auto b = a.as<BailOpt>()) {
+    u8(raw_value(tag::Attribute::bail_opt));
+    string(b->message);
+  } else if (auto e = a.as<Extern>()) {
+    u8(raw_value(tag::Attribute::extern_));
+    boolean(e->is_blocking);
+  } else if (auto l = a.as<Link>()) {
+    u8(raw_value(tag::Attribute::link));
+    string(l->name);
+  } else if (auto d = a.as<Define>()) {
+    u8(raw_value(tag::Attribute::define));
+    string(d->name);
+  } else if (auto g = a.as<Alignment>()) {
+    u8(raw_value(tag::Attribute::align));
+    signed_leb128(g->size);
+    optional(g->group, [](auto& self, auto const& s) { self.string(s); });
+  } else {
+    switch (a.kind()) {
+      case Kind::may_inline:
+        return u8(raw_value(tag::Attribute::may_inline));
+      case Kind::inline_hint:
+        return u8(raw_value(tag::Attribute::inline_hint));
+      case Kind::no_inline:
+        return u8(raw_value(tag::Attribute::no_inline));
+      case Kind::always_inline:
+        return u8(raw_value(tag::Attribute::always_inline));
+
+      case Kind::may_specialize:
+        return u8(raw_value(tag::Attribute::may_specialize));
+      case Kind::no_specialize:
+        return u8(raw_value(tag::Attribute::no_specialize));
+
+      case Kind::un_opt:
+        return u8(raw_value(tag::Attribute::un_opt));
+      case Kind::no_opt:
+        return u8(raw_value(tag::Attribute::no_opt));
+      case Kind::did_opt:
+        return u8(raw_value(tag::Attribute::did_opt));
+
+      case Kind::dyn:
+        return u8(raw_value(tag::Attribute::dyn));
+      case Kind::stub:
+        return u8(raw_value(tag::Attribute::stub));
+      case Kind::abstract:
+        return u8(raw_value(tag::Attribute::abstract));
+      case Kind::volatile_:
+        return u8(raw_value(tag::Attribute::volatile_));
+      case Kind::final:
+        return u8(raw_value(tag::Attribute::final));
+      case Kind::safe_publish:
+        return u8(raw_value(tag::Attribute::safe_publish));
+
+      case Kind::link_time_resolved:
+        return u8(raw_value(tag::Attribute::link_time_resolved));
+      case Kind::uses_intrinsic:
+        return u8(raw_value(tag::Attribute::uses_intrinsic));
+
+      default:
+        fatal_error("unexpected attribute");
+    }
+  }
+}
+
+void Serializer::source_position(SourcePosition const& p) {
+  // A virtual source file is encoded as an empty path.
+  string(p.scala_source.path());
+  unsigned_leb128(p.line_index);
+  unsigned_leb128(p.column_index);
+}
+
+void Serializer::scope_identifier(ScopeIdentifier const& s) {
+  unsigned_leb128(s.raw_value);
+}
+
+void Serializer::string(std::string_view s) {
+  if (s.empty()) {
+    u8(raw_value(tag::String::empty));
+    return;
+  }
+
+  // Walk down the radix tree along `s` to find the longest prefix that `s` shares with an interned
+  // string, stopping either at a node or in the middle of the edge leading to `child`.
+  uint32_t node = 0;
+  uint32_t child = 0;
+  std::size_t n = 0;
+  std::size_t m = 0;
+  while (true) {
+    auto e = prefix_edges.find(prefix_edge(node, s[n]));
+    if (e == prefix_edges.end()) { break; }
+
+    auto const& c = prefix_nodes[e->second];
+    m = common_prefix_size(c.label, s.substr(n));
+    if (n + m == s.size()) {
+      u8(raw_value(tag::String::contained));
+      unsigned_leb128(s.size());
+      unsigned_leb128(c.string);
+      return;
+    } else if (m < c.label.size()) {
+      child = e->second;
+      n += m;
+      break;
+    } else {
+      node = e->second;
+      n += m;
+    }
+  }
+  auto base = prefix_nodes[(child != 0) ? child : node].string;
+
+  precondition(
+    interned_strings.size() < std::numeric_limits<uint32_t>::max(), "too many interned strings");
+  auto i = static_cast<uint32_t>(interned_strings.size());
+  auto copy = strings.insert(s);
+  interned_strings.push_back(copy);
+
+  // Split the edge leading to `child` where `s` branches off, then add a leaf for `s`.
+  if (child != 0) {
+    auto label = prefix_nodes[child].label;
+    auto middle = static_cast<uint32_t>(prefix_nodes.size());
+    prefix_nodes.push_back(PrefixNode{label.substr(0, m), prefix_nodes[child].string});
+    prefix_nodes[child].label = label.substr(m);
+    prefix_edges[prefix_edge(node, label[0])] = middle;
+    prefix_edges.emplace(prefix_edge(middle, label[m]), child);
+    node = middle;
+  }
+  prefix_edges.emplace(prefix_edge(node, s[n]), static_cast<uint32_t>(prefix_nodes.size()));
+  prefix_nodes.push_back(PrefixNode{copy.substr(n), i});
+
+  auto inserted_size = unsigned_leb128_size(s.size()) + s.size();
+  auto appended_size = unsigned_leb128_size(n) + unsigned_leb128_size(base)
+    + unsigned_leb128_size(s.size() - n) + (s.size() - n);
+  if ((n > 0) && (appended_size < inserted_size)) {
+    u8(raw_value(tag::String::appended));
+    unsigned_leb128(n);
+    unsigned_leb128(base);
+    s.remove_prefix(n);
+  } else {
+    u8(raw_value(tag::String::inserted));
+  }
+  unsigned_leb128(s.size());
+  target.insert(target.end(), s.begin(), s.end());
+}
+
+void Serializer::bytes(std::span<value::Byte const> bs) {
+  unsigned_leb128(bs.size());
+  auto p = reinterpret_cast<uint8_t const*>(bs.data());
+  target.insert(target.end(), p, p + bs.size());
+}
+
+void Serializer::boolean(bool b) {
+  u8(b ? 1 : 0);
+}
+
+void Serializer::uint32(uint32_t v) {
+  unsigned_leb128(v);
+}
+
+void Serializer::uint32_sequence(std::span<uint32_t const> vs) {
+  unsigned_leb128(vs.size());
+  for (auto v : vs) { unsigned_leb128(v); }
+}
+
+void Serializer::u8(uint8_t v) {
+  target.push_back(v);
+}
+
+void Serializer::unsigned_leb128(uint64_t v) {
+  while (v >= 0x80) {
+    target.push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  target.push_back(static_cast<uint8_t>(v));
+}
+
+void Serializer::signed_leb128(int64_t v) {
+  while (true) {
+    auto b = static_cast<uint8_t>(v & 0x7f);
+    v >>= 7;
+    if (((v == 0) && !(b & 0x40)) || ((v == -1) && (b & 0x40))) {
+      target.push_back(b);
+      return;
+    }
+    target.push_back(b | 0x80);
+  }
+}
+
+} // nir
@@ -11,7 +11,7 @@ std::ostream& operator<<(std::ostream& s, const Signature& self) {
 namespace std {
 
 size_t hash<nir::Signature>::operator()(nir::Signature const& self) const {
-  return hash<string>{}(self.mangled_name);
+  return hash<string_view>{}(self.mangled_name);
 }
 
 } // std
@@ -0,0 +1,46 @@
+#include "SourcePosition.hh"
+#include "SourceFileTable.hh"
+#include "Utilities/Assert.hh"
+
+namespace nir {
+
+SourceFile::SourceFile(std::string_view path) : raw(SourceFileTable::global().intern(path) + 1) {}
+
+std::string_view SourceFile::path() const {
+  return (raw == 0) ? std::string_view() : SourceFileTable::global()[raw - 1].path;
+}
+
+SourceFileTable& SourceFileTable::global() {
+  // The table is never destroyed so that positions can be used during static destruction.
+  static auto* table = new SourceFileTable();
+  return *table;
+}
+
+uint32_t SourceFileTable::intern(std::string_view path) {
+  std::lock_guard<std::mutex> guard(lock);
+
+  auto i = indices.find(path);
+  if (i != indices.end()) { return i->second; }
+
+  auto p = paths.insert(path);
+  auto r = entries.push_back(Entry{p, std::hash<std::string_view>{}(path)});
+  precondition(r < std::numeric_limits<uint32_t>::max(), "too many source files");
+  indices.emplace(p, r);
+  return r;
+}
+
+} // nir
+
+namespace std {
+
+size_t hash<nir::SourceFile>::operator()(nir::SourceFile const& self) const {
+  return (self.raw == 0) ? 0 : nir::SourceFileTable::global()[self.raw - 1].hash;
+}
+
+size_t hash<nir::SourcePosition>::operator()(nir::SourcePosition const& self) const {
+  auto h = hash<nir::SourceFile>{}(self.scala_source);
+  auto c = (uint64_t{self.line_index} << 32) | uint64_t{self.column_index};
+  return h ^ (c * 0x9e3779b97f4a7c15);
+}
+
+} // std
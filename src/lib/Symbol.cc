@@ -1,15 +1,34 @@
 #include "Symbol.hh"
+#include "SymbolTable.hh"
 #include "Utilities/Assert.hh"
 
 namespace nir::symbol {
 
+Top::Top(std::string_view id) : raw(SymbolTable::global().intern_top(id)) {}
+
+std::string_view Top::id() const {
+  return SymbolTable::global().top(raw).id;
+}
+
 std::ostream& operator<<(std::ostream& s, const Top& self) {
-  return s << self.id;
+  return s << self.id();
+}
+
+Member::Member(Top top, Signature const& signature) :
+  raw(SymbolTable::global().intern_member(top, signature.mangled_name))
+{}
+
+Top Member::top() const {
+  return SymbolTable::global().member(raw).top;
+}
+
+Signature const& Member::signature() const {
+  return SymbolTable::global().member(raw).signature;
 }
 
 std::ostream& operator<<(std::ostream& s, const Member& self) {
   // TODO: Should be the mangled name.
-  return s << self.top << "." << self.signature;
+  return s << self.top() << "." << self.signature();
 }
 
 } // nir::symbol
@@ -17,34 +36,83 @@ std::ostream& operator<<(std::ostream& s, const Member& self) {
 namespace nir {
 
 std::ostream& operator<<(std::ostream& s, const Symbol& self) {
-  switch (self.wrapped.index()) {
-    case 0: return s << "null";
-    case 1: return s << std::get<1>(self.wrapped);
-    case 2: return s << std::get<2>(self.wrapped);
-    default:
-      nir::fatal_error("unreachable");
+  if (auto t = self.as<symbol::Top>()) {
+    return s << *t;
+  } else if (auto m = self.as<symbol::Member>()) {
+    return s << *m;
+  } else {
+    return s << "null";
   }
 }
 
+/// Returns a hash of the top-level symbol identified by `id`.
+inline std::size_t top_hash(std::string_view id) {
+  return std::hash<std::string_view>{}(id);
+}
+
+/// Returns a hash of the member of the symbol whose hash is `top` having `signature`.
+///
+/// The hashes are mixed rather than xored so that the members of different owners sharing a
+/// signature, which are common, don't collide whenever their owners' hashes differ in few bits.
+inline std::size_t member_hash(std::size_t top, std::string_view signature) {
+  auto h = std::hash<std::string_view>{}(signature);
+  return top ^ (h + 0x9e3779b97f4a7c15 + (top << 6) + (top >> 2));
+}
+
+SymbolTable& SymbolTable::global() {
+  // The table is never destroyed so that symbols can be used during static destruction.
+  static auto* table = new SymbolTable();
+  return *table;
+}
+
+uint32_t SymbolTable::intern_top(std::string_view id) {
+  auto h = top_hash(id);
+  auto& s = shards[h % shard_count];
+  std::lock_guard<std::mutex> guard(s.lock);
+
+  auto i = s.tops.find(id);
+  if (i != s.tops.end()) { return i->second; }
+
+  auto r = top_entries.push_back(TopEntry{s.names.insert(id), h});
+  precondition(r < (uint32_t{1} << 31) - 1, "too many symbols");
+  s.tops.emplace(top_entries[r].id, r);
+  return r;
+}
+
+uint32_t SymbolTable::intern_member(symbol::Top top, std::string_view signature) {
+  auto h = member_hash(std::hash<symbol::Top>{}(top), signature);
+  auto& s = shards[h % shard_count];
+  std::lock_guard<std::mutex> guard(s.lock);
+
+  auto i = s.members.find({top.raw_value(), signature});
+  if (i != s.members.end()) { return i->second; }
+
+  auto n = s.names.insert(signature);
+  auto r = member_entries.push_back(MemberEntry{top, Signature{n}, h});
+  precondition(r < (uint32_t{1} << 31), "too many symbols");
+  s.members.emplace(std::make_pair(top.raw_value(), n), r);
+  return r;
+}
+
 } // nir
 
 namespace std {
 
 size_t hash<nir::symbol::Top>::operator()(nir::symbol::Top const& self) const {
-  return std::hash<string>{}(self.id);
+  return nir::SymbolTable::global().top(self.raw).hash;
 }
 
 size_t hash<nir::symbol::Member>::operator()(nir::symbol::Member const& self) const {
-  return hash<nir::symbol::Top>{}(self.top) ^ hash<nir::Signature>{}(self.signature);
+  return nir::SymbolTable::global().member(self.raw).hash;
 }
 
 size_t hash<nir::Symbol>::operator()(nir::Symbol const& self) const {
-  switch (self.wrapped.index()) {
-    case 0: return hash<int>{}(0);
-    case 1: return hash<nir::symbol::Top>{}(std::get<1>(self.wrapped));
-    case 2: return hash<nir::symbol::Member>{}(std::get<2>(self.wrapped));
-    default:
-      nir::fatal_error("unreachable");
+  if (auto t = self.as<nir::symbol::Top>()) {
+    return hash<nir::symbol::Top>{}(*t);
+  } else if (auto m = self.as<nir::symbol::Member>()) {
+    return hash<nir::symbol::Member>{}(*m);
+  } else {
+    return hash<int>{}(0);
   }
 }
 
@@ -0,0 +1,66 @@
+#include "SymbolFilter.hh"
+#include "Utilities/Assert.hh"
+
+#include <algorithm>
+
+namespace nir {
+
+/// Returns the index of the `i`-th bit of the identifier whose hash is `h`, in a filter of `n`
+/// bits.
+///
+/// The bits are computed by double hashing, deriving all of them from the two halves of `h`, and
+/// mapped to the range [`0`, `n`) without a division.
+inline uint64_t probe(uint64_t h, std::size_t i, uint64_t n) {
+  auto a = static_cast<uint32_t>(h);
+  auto b = static_cast<uint32_t>(h >> 32) | 1;
+  return (uint64_t{static_cast<uint32_t>(a + i * b)} * n) >> 32;
+}
+
+SymbolFilter::SymbolFilter(std::size_t count, std::size_t bits_per_identifier) :
+  _words(std::max<std::size_t>((count * bits_per_identifier + 63) / 64, 1), 0)
+{}
+
+SymbolFilter::SymbolFilter(std::vector<uint64_t>&& words) : _words(std::move(words)) {
+  precondition(!_words.empty(), "empty filter");
+}
+
+uint64_t SymbolFilter::hash(std::string_view id) {
+  // 64-bit FNV-1a, followed by the finalizer of SplitMix64 so that both halves of the result are
+  // well distributed.
+  uint64_t h = 0xcbf29ce484222325;
+  for (auto c : id) {
+    h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+  }
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+  return h ^ (h >> 31);
+}
+
+std::optional<uint64_t> SymbolFilter::hash(Symbol const& name) {
+  if (auto t = name.as<symbol::Top>()) {
+    return hash(t->id());
+  } else if (auto m = name.as<symbol::Member>()) {
+    return hash(m->top().id());
+  } else {
+    return std::nullopt;
+  }
+}
+
+void SymbolFilter::insert(uint64_t h) {
+  auto n = _words.size() * 64;
+  for (std::size_t i = 0; i < probe_count; ++i) {
+    auto b = probe(h, i, n);
+    _words[b / 64] |= uint64_t{1} << (b % 64);
+  }
+}
+
+bool SymbolFilter::may_contain(uint64_t h) const {
+  auto n = _words.size() * 64;
+  for (std::size_t i = 0; i < probe_count; ++i) {
+    auto b = probe(h, i, n);
+    if (!(_words[b / 64] & (uint64_t{1} << (b % 64)))) { return false; }
+  }
+  return true;
+}
+
+} // nir
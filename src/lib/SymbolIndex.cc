@@ -0,0 +1,240 @@
+#include "SymbolIndex.hh"
+#include "Utilities/Assert.hh"
+#include "Utilities/Concurrency.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <tuple>
+
+namespace nir {
+
+/// The number of keys in each partition of an index, on average.
+inline constexpr std::size_t partition_size = 4096;
+
+/// The number of keys in each bucket of a partition, on average.
+inline constexpr std::size_t bucket_size = 4;
+
+/// The number of pilots tried for a bucket before choosing another seed for its partition.
+inline constexpr uint32_t pilot_limit = uint32_t{1} << 20;
+
+/// Returns `x` mixed so that each bit of the result depends on every bit of `x`.
+inline uint64_t mix(uint64_t x) {
+  // The finalizer of SplitMix64.
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+/// Returns a value in the range [`0`, `n`) computed from `x` without a division.
+inline uint32_t reduce(uint32_t x, uint32_t n) {
+  return static_cast<uint32_t>((uint64_t{x} * n) >> 32);
+}
+
+/// Returns the hash of the symbol whose raw value is `key`.
+inline uint64_t key_hash(uint32_t key) {
+  return mix(key);
+}
+
+/// Returns the index of the partition of a key whose hash is `h`, in an index of `n` partitions.
+inline uint32_t partition_of(uint64_t h, uint32_t n) {
+  return reduce(static_cast<uint32_t>(h >> 32), n);
+}
+
+/// Returns the index of the bucket of a key whose hash is `h`, in a partition of `n` buckets.
+inline uint32_t bucket_of(uint64_t h, uint32_t n) {
+  return reduce(static_cast<uint32_t>(h), n);
+}
+
+/// Returns the index of the slot of a key whose hash is `h`, in a partition of `n` keys using
+/// `seed`, given the `pilot` of the key's bucket.
+inline uint32_t slot_of(uint64_t h, uint32_t seed, uint32_t pilot, uint32_t n) {
+  auto d = ((uint64_t{seed} << 32) | pilot) * 0x9e3779b97f4a7c15;
+  return reduce(static_cast<uint32_t>(mix(h ^ d) >> 32), n);
+}
+
+/// A definition to insert in an index.
+struct Candidate {
+
+  /// The hash of the symbol being defined.
+  uint64_t hash;
+
+  /// The raw value of the symbol being defined.
+  uint32_t key;
+
+  /// The location of the definition.
+  SymbolIndex::Location location;
+
+};
+
+/// Calls `action(i)` for each `i` in the range [`0`, `n`) on `thread_count` threads, each claiming
+/// the next index when it is done with its last one.
+template<typename F>
+void distribute(std::size_t n, std::size_t thread_count, F&& action) {
+  std::atomic<std::size_t> next{0};
+  concurrently(std::min(thread_count, n), [&](std::size_t) {
+    for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < n;
+         i = next.fetch_add(1, std::memory_order_relaxed)) {
+      action(i);
+    }
+  });
+}
+
+/// Assigns a distinct slot in the range [`0`, `keys.size()`) to each key in `keys`, which are
+/// distinct, writing the pilots of their buckets to `pilots`, and returns the seed with which the
+/// pilots were chosen.
+///
+/// `assign(k, s)` is called for each key `k` once all slots have been assigned, where `s` is the
+/// slot assigned to `k`.
+///
+/// Buckets are processed from the largest to the smallest, so that the buckets that are the
+/// hardest to place are placed while most slots are free.
+template<typename F>
+uint32_t place(std::span<Candidate const> keys, std::span<uint32_t> pilots, F&& assign) {
+  auto size = static_cast<uint32_t>(keys.size());
+  auto bucket_count = static_cast<uint32_t>(pilots.size());
+
+  // Group keys by bucket.
+  std::vector<uint32_t> starts(bucket_count + 1, 0);
+  for (auto const& k : keys) { ++starts[bucket_of(k.hash, bucket_count) + 1]; }
+  std::partial_sum(starts.begin(), starts.end(), starts.begin());
+  std::vector<uint32_t> members(size);
+  std::vector<uint32_t> cursors(starts.begin(), starts.end() - 1);
+  for (uint32_t i = 0; i < size; ++i) {
+    members[cursors[bucket_of(keys[i].hash, bucket_count)]++] = i;
+  }
+
+  std::vector<uint32_t> order(bucket_count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+    return (starts[a + 1] - starts[a]) > (starts[b + 1] - starts[b]);
+  });
+
+  std::vector<bool> taken(size);
+  std::vector<uint32_t> positions;
+  for (uint32_t seed = 0; ; ++seed) {
+    std::fill(taken.begin(), taken.end(), false);
+    std::fill(pilots.begin(), pilots.end(), 0);
+
+    auto placed = std::all_of(order.begin(), order.end(), [&](uint32_t b) {
+      auto bucket = std::span(members).subspan(starts[b], starts[b + 1] - starts[b]);
+      for (uint32_t pilot = 0; pilot < pilot_limit; ++pilot) {
+        positions.clear();
+        for (auto i : bucket) {
+          auto s = slot_of(keys[i].hash, seed, pilot, size);
+          if (taken[s] || (std::find(positions.begin(), positions.end(), s) != positions.end())) {
+            break;
+          }
+          positions.push_back(s);
+        }
+
+        if (positions.size() == bucket.size()) {
+          for (auto s : positions) { taken[s] = true; }
+          pilots[b] = pilot;
+          return true;
+        }
+      }
+      return false;
+    });
+
+    if (placed) {
+      for (auto const& k : keys) {
+        auto pilot = pilots[bucket_of(k.hash, bucket_count)];
+        assign(k, slot_of(k.hash, seed, pilot, size));
+      }
+      return seed;
+    }
+  }
+}
+
+SymbolIndex SymbolIndex::build(Workspace const& workspace, std::size_t thread_count) {
+  if (thread_count == 0) { thread_count = hardware_thread_count(); }
+  auto const& files = workspace.files();
+
+  auto n = workspace.definition_count();
+  precondition(n < std::numeric_limits<uint32_t>::max(), "too many definitions");
+  auto partition_count = static_cast<uint32_t>(
+    std::max<std::size_t>((n + partition_size - 1) / partition_size, 1));
+
+  // Definitions are distributed in partitions by chunks of consecutive files, so that the
+  // candidates of each partition can be gathered in the order of the workspace.
+  auto chunk_count = std::min(thread_count, files.size());
+  std::vector<std::vector<std::vector<Candidate>>> chunks(chunk_count);
+  concurrently(chunk_count, [&](std::size_t k) {
+    auto& partitions = chunks[k];
+    partitions.resize(partition_count);
+    for (auto i = files.size() * k / chunk_count; i < files.size() * (k + 1) / chunk_count; ++i) {
+      auto const& definitions = files[i].definitions;
+      for (std::size_t j = 0; j < definitions.size(); ++j) {
+        auto key = definitions[j].name().raw_value();
+        auto h = key_hash(key);
+        partitions[partition_of(h, partition_count)].push_back(Candidate{
+          h, key, Location{static_cast<uint32_t>(i), static_cast<uint32_t>(j)}
+        });
+      }
+    }
+  });
+
+  // Only the first definition of each symbol is kept.
+  std::vector<std::vector<Candidate>> keys(partition_count);
+  distribute(partition_count, thread_count, [&](std::size_t p) {
+    auto& ks = keys[p];
+    for (auto& c : chunks) {
+      ks.insert(ks.end(), c[p].begin(), c[p].end());
+      c[p] = {};
+    }
+    std::sort(ks.begin(), ks.end(), [](auto const& a, auto const& b) {
+      return std::tie(a.key, a.location.file, a.location.definition)
+        < std::tie(b.key, b.location.file, b.location.definition);
+    });
+    auto end = std::unique(ks.begin(), ks.end(), [](auto const& a, auto const& b) {
+      return a.key == b.key;
+    });
+    ks.erase(end, ks.end());
+  });
+  chunks.clear();
+
+  SymbolIndex result;
+  result.partitions.resize(partition_count);
+  uint32_t offset = 0;
+  uint32_t bucket_offset = 0;
+  for (uint32_t p = 0; p < partition_count; ++p) {
+    auto size = static_cast<uint32_t>(keys[p].size());
+    auto bucket_count = static_cast<uint32_t>((size + bucket_size - 1) / bucket_size);
+    result.partitions[p] = Partition{offset, size, bucket_offset, bucket_count, 0};
+    offset += size;
+    bucket_offset += bucket_count;
+  }
+  result.pilots.resize(bucket_offset);
+  result.slots.resize(offset);
+
+  distribute(partition_count, thread_count, [&](std::size_t p) {
+    auto& d = result.partitions[p];
+    if (d.size == 0) { return; }
+    auto pilots = std::span(result.pilots).subspan(d.bucket_offset, d.bucket_count);
+    d.seed = place(keys[p], pilots, [&](Candidate const& k, uint32_t s) {
+      result.slots[d.offset + s] = Slot{k.key, k.location};
+    });
+    keys[p] = {};
+  });
+
+  return result;
+}
+
+std::optional<SymbolIndex::Location> SymbolIndex::find(Symbol const& name) const {
+  if (slots.empty()) { return std::nullopt; }
+
+  auto key = name.raw_value();
+  auto h = key_hash(key);
+  auto const& p = partitions[partition_of(h, static_cast<uint32_t>(partitions.size()))];
+  if (p.size == 0) { return std::nullopt; }
+
+  auto pilot = pilots[p.bucket_offset + bucket_of(h, p.bucket_count)];
+  auto const& s = slots[p.offset + slot_of(h, p.seed, pilot, p.size)];
+  if (s.key != key) { return std::nullopt; }
+  return s.location;
+}
+
+} // nir
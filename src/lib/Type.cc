@@ -3,6 +3,7 @@
 #include "Utilities/Assert.hh"
 
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -54,35 +55,29 @@ std::ostream& operator<<(std::ostream& s, const Numeric& t) {
 }
 
 Type ArrayValue::normalized() const {
-  return Type(ArrayValue(element->normalized(), size));
+  return Type(ArrayValue(element.normalized(), size));
 }
 
 std::ostream& operator<<(std::ostream& s, const ArrayValue& t) {
-  return s << *t.element << "[" << t.size <<  "]";
+  return s << t.element << "[" << t.size <<  "]";
 }
 
 Type ArrayReference::normalized() const {
-  return Type(ArrayReference(element->normalized(), true));
+  return Type(ArrayReference(element.normalized(), true));
 }
 
 std::ostream& operator<<(std::ostream& s, const ArrayReference& t) {
-  s << "Array[" << *t.element << "]";
+  s << "Array[" << t.element << "]";
   if (t.is_nullable) { s << "?"; }
   return s;
 }
 
-Struct::Struct(std::vector<Type> const& es) {
-  std::transform(es.begin(), es.end(), elements.begin(), [](auto&& e) {
-    return indirect(e);
-  });
-}
-
 Type Struct::normalized() const {
   Struct r;
   r.elements.reserve(elements.size());
-  std::transform(elements.begin(), elements.end(), r.elements.begin(), [](auto&& e) {
-    return indirect(e->normalized());
-  });
+  std::transform(
+    elements.begin(), elements.end(), std::back_inserter(r.elements),
+    [](auto&& e) { return e.normalized(); });
   return Type(std::move(r));
 }
 
@@ -91,7 +86,7 @@ std::ostream& operator<<(std::ostream& s, const Struct& t) {
   auto first = true;
   for (auto& e : t.elements) {
     if (!first) { s << ", "; } else { first = false; }
-    s << *e;
+    s << e;
   }
   return s << "}";
 }
@@ -108,26 +103,19 @@ std::ostream& operator<<(std::ostream& s, const Reference& t) {
 }
 
 Type Var::normalized() const {
-  return Type(Var(type->normalized()));
+  return Type(Var(type.normalized()));
 }
 
 std::ostream& operator<<(std::ostream& s, const Var& t) {
-  return s << "var[" << *t.type << "]";
-}
-
-Function::Function(std::vector<Type> const& ps, Type const& rv) : return_value(rv) {
-  parameters.reserve(ps.size());
-  std::transform(ps.begin(), ps.end(), parameters.begin(), [](auto&& p) {
-    return indirect(p);
-  });
+  return s << "var[" << t.type << "]";
 }
 
 Type Function::normalized() const {
-  Function r{{}, return_value->normalized()};
+  Function r{{}, return_value.normalized()};
   r.parameters.reserve(parameters.size());
-  std::transform(parameters.begin(), parameters.end(), r.parameters.begin(), [](auto&& p) {
-    return indirect(p->normalized());
-  });
+  std::transform(
+    parameters.begin(), parameters.end(), std::back_inserter(r.parameters),
+    [](auto&& p) { return p.normalized(); });
   return Type(std::move(r));
 }
 
@@ -136,47 +124,122 @@ std::ostream& operator<<(std::ostream& s, const Function& t) {
   auto first = true;
   for (auto& p : t.parameters) {
     if (!first) { s << ", "; } else { first = false; }
-    s << *p;
+    s << p;
   }
-  return s << ") => " << *t.return_value;
+  return s << ") => " << t.return_value;
 }
 
 } // nir::type
 
 namespace nir {
 
+Type Type::null() {
+  static const Type t(type::Predefined::null);
+  return t;
+}
+
+Type Type::unit() {
+  static const Type t(type::Predefined::unit);
+  return t;
+}
+
+Type Type::pointer() {
+  static const Type t(type::Predefined::pointer);
+  return t;
+}
+
+Type Type::size() {
+  static const Type t(type::Predefined::size);
+  return t;
+}
+
+Type Type::vararg() {
+  static const Type t(type::Predefined::vararg);
+  return t;
+}
+
+Type Type::nothing() {
+  static const Type t(type::Predefined::nothing);
+  return t;
+}
+
+Type Type::virtual_() {
+  static const Type t(type::Predefined::virtual_);
+  return t;
+}
+
+Type Type::u1() {
+  static const Type t(type::Numeric::integer(1, false));
+  return t;
+}
+
+Type Type::i8() {
+  static const Type t(type::Numeric::integer(8, true));
+  return t;
+}
+
+Type Type::i16() {
+  static const Type t(type::Numeric::integer(16, true));
+  return t;
+}
+
+Type Type::u16() {
+  static const Type t(type::Numeric::integer(16, false));
+  return t;
+}
+
+Type Type::i32() {
+  static const Type t(type::Numeric::integer(32, true));
+  return t;
+}
+
+Type Type::i64() {
+  static const Type t(type::Numeric::integer(64, true));
+  return t;
+}
+
+Type Type::f32() {
+  static const Type t(type::Numeric::floating_point(32));
+  return t;
+}
+
+Type Type::f64() {
+  static const Type t(type::Numeric::floating_point(64));
+  return t;
+}
+
 /// Returns the name of class representing arrays of `t`.
 symbol::Top to_array_class(Type const& self) {
   if (self == Type::u1()) {
-    return runtime::BooleanArray.name;
+    return runtime::BooleanArray.class_name();
   } else if (self == Type::u16()) {
-    return runtime::CharArray.name;
+    return runtime::CharArray.class_name();
   } else if (self == Type::i8()) {
-    return runtime::ByteArray.name;
+    return runtime::ByteArray.class_name();
   } else if (self == Type::i16()) {
-    return runtime::ShortArray.name;
+    return runtime::ShortArray.class_name();
   } else if (self == Type::i32()) {
-    return runtime::IntArray.name;
+    return runtime::IntArray.class_name();
   } else if (self == Type::i64()) {
-    return runtime::LongArray.name;
+    return runtime::LongArray.class_name();
   } else if (self == Type::f32()) {
-    return runtime::FloatArray.name;
+    return runtime::FloatArray.class_name();
   } else if (self == Type::f64()) {
-    return runtime::DoubleArray.name;
+    return runtime::DoubleArray.class_name();
   } else {
-    return runtime::ObjectArray.name;
+    return runtime::ObjectArray.class_name();
   }
 }
 
 Type Type::element_at(uint32_t i) const {
   if (is<type::ArrayValue>()) {
-    auto& w = std::get<type::ArrayValue>(wrapped);
+    auto& w = std::get<type::ArrayValue>(wrapped());
     if (i >= w.size) { throw std::out_of_range("index is out of range"); }
-    return *(w.element);
+    return w.element;
   }
 
   else if (is<type::Struct>()) {
-    return *(std::get<type::Struct>(wrapped).elements.at(i));
+    return std::get<type::Struct>(wrapped()).elements.at(i);
   }
 
   else {
@@ -195,11 +258,11 @@ Type Type::element_at(uint32_t i) const {
 
 symbol::Top Type::class_name() const {
   if (is<type::Predefined>()) {
-    switch (std::get<type::Predefined>(wrapped)) {
+    switch (std::get<type::Predefined>(wrapped())) {
       case type::Predefined::null:
-        return runtime::BoxedNull.name;
+        return runtime::BoxedNull.class_name();
       case type::Predefined::unit:
-        return runtime::BoxedUnit.name;
+        return runtime::BoxedUnit.class_name();
       default: {
         no_class_name(*this);
       }
@@ -207,11 +270,11 @@ symbol::Top Type::class_name() const {
   }
 
   else if (is<type::ArrayReference>()) {
-    return to_array_class(*(std::get<type::ArrayReference>(wrapped).element));
+    return to_array_class(std::get<type::ArrayReference>(wrapped()).element);
   }
 
   else if (is<type::Reference>()) {
-    return std::get<type::Reference>(wrapped).name;
+    return std::get<type::Reference>(wrapped()).name;
   }
 
   else { no_class_name(*this); }
@@ -220,7 +283,7 @@ symbol::Top Type::class_name() const {
 std::optional<Type> Type::unboxed() const {
   if (!is<type::Reference>()) { return std::nullopt; }
 
-  auto n = as<type::Reference>().value().name.id;
+  auto n = as<type::Reference>().value().name.id();
   if (n == "scala.scalanative.unsafe.CArray") {
     return Type::pointer();
   } else if (n == "scala.scalanative.unsafe.CVarArgList") {
@@ -260,7 +323,7 @@ Type Type::normalized() const {
   return std::visit([](auto&& self) {
     using Self = std::decay_t<decltype(self)>;
     return type::TypeTrait<Self>::normalized(self);
-  }, wrapped);
+  }, wrapped());
 }
 
 bool Type::is_box_of(Type const& t) const {
@@ -273,7 +336,7 @@ bool Type::is_pointer_box() const {
 
 bool Type::is_reference() const {
   if (is<type::Predefined>()) {
-    switch (std::get<type::Predefined>(wrapped)) {
+    switch (std::get<type::Predefined>(wrapped())) {
       case type::Predefined::null:
       case type::Predefined::unit:
         return true;
@@ -287,22 +350,22 @@ bool Type::is_reference() const {
 
 bool Type::has_known_size() const {
   if (is<type::Predefined>()) {
-    auto& w = std::get<type::Predefined>(wrapped);
+    auto& w = std::get<type::Predefined>(wrapped());
     return (w == type::Predefined::null) || (w == type::Predefined::pointer);
   } else if (is<type::ArrayValue>()) {
-    auto& w = std::get<type::ArrayValue>(wrapped);
-    return w.element->has_known_size();
+    auto& w = std::get<type::ArrayValue>(wrapped());
+    return w.element.has_known_size();
   } else if (is<type::Struct>()) {
-    auto& w = std::get<type::Struct>(wrapped);
+    auto& w = std::get<type::Struct>(wrapped());
     return std::all_of(
-      w.elements.begin(), w.elements.end(), [](auto& e) { return e->has_known_size(); });
+      w.elements.begin(), w.elements.end(), [](auto& e) { return e.has_known_size(); });
   } else {
     return !is_reference();
   }
 }
 
 std::ostream& operator<<(std::ostream& s, const Type& wrapper) {
-  std::visit([&](auto&& self) { s << self; }, wrapper.wrapped);
+  std::visit([&](auto&& self) { s << self; }, wrapper.wrapped());
   return s;
 }
 
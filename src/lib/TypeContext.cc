@@ -0,0 +1,73 @@
+#include "Type.hh"
+
+namespace nir {
+
+/// Returns the combination of the hash `h` with the hash `x`.
+inline std::size_t combined(std::size_t h, std::size_t x) {
+  return h ^ (x + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2));
+}
+
+/// Returns a hash of the structure of `w`.
+///
+/// The hashes of the types contained in `w` are read from their nodes rather than computed again.
+std::size_t hash_of(type::Node::Representation const& w) {
+  using namespace type;
+
+  auto h = combined(0, w.index());
+  std::hash<Type> hash_type;
+
+  if (auto t = std::get_if<Predefined>(&w)) {
+    return combined(h, static_cast<std::size_t>(*t));
+  } else if (auto t = std::get_if<Numeric>(&w)) {
+    h = combined(h, t->bit_width());
+    return combined(h, (t->is_integer() ? 2 : 0) | (t->is_signed() ? 1 : 0));
+  } else if (auto t = std::get_if<ArrayValue>(&w)) {
+    return combined(combined(h, hash_type(t->element)), t->size);
+  } else if (auto t = std::get_if<ArrayReference>(&w)) {
+    return combined(combined(h, hash_type(t->element)), t->is_nullable);
+  } else if (auto t = std::get_if<Struct>(&w)) {
+    for (auto const& e : t->elements) { h = combined(h, hash_type(e)); }
+    return h;
+  } else if (auto t = std::get_if<Reference>(&w)) {
+    h = combined(h, std::hash<symbol::Top>{}(t->name));
+    return combined(h, (t->is_exact ? 2 : 0) | (t->is_nullable ? 1 : 0));
+  } else if (auto t = std::get_if<Var>(&w)) {
+    return combined(h, hash_type(t->type));
+  } else {
+    auto& f = std::get<Function>(w);
+    for (auto const& p : f.parameters) { h = combined(h, hash_type(p)); }
+    return combined(h, hash_type(f.return_value));
+  }
+}
+
+TypeContext& TypeContext::global() {
+  // The context is never destroyed so that types can be used during static destruction.
+  static auto* context = new TypeContext();
+  return *context;
+}
+
+type::Node const* TypeContext::intern(type::Node::Representation&& w) {
+  auto h = hash_of(w);
+  auto& s = shards[h % shard_count];
+  std::lock_guard<std::mutex> guard(s.lock);
+
+  auto [first, last] = s.index.equal_range(h);
+  for (auto i = first; i != last; ++i) {
+    if (i->second->wrapped == w) { return i->second; }
+  }
+
+  auto n = &s.nodes.emplace_back(std::move(w), h);
+  s.index.emplace(h, n);
+  return n;
+}
+
+std::size_t TypeContext::size() {
+  std::size_t result = 0;
+  for (auto& s : shards) {
+    std::lock_guard<std::mutex> guard(s.lock);
+    result += s.nodes.size();
+  }
+  return result;
+}
+
+} // nir
@@ -1,28 +1,63 @@
 #include "Value.hh"
 
 #include <algorithm>
+#include <iterator>
 
 namespace nir::value {
 
-ArrayValue::ArrayValue(Type const& t, std::vector<Value> const& es) : element_type(t) {
-  elements.reserve(es.size());
-  std::transform(es.begin(), es.end(), elements.begin(), [](auto const& e) {
-    return indirect<Value>(e);
-  });
+/// Returns `es` stored as instances of `T` if they all wrap an instance of `T`, or `std::nullopt`.
+template<typename T>
+inline std::optional<ArrayValue::Storage> packed(std::vector<Value> const& es) {
+  std::vector<T> r;
+  r.reserve(es.size());
+  for (auto const& e : es) {
+    if (auto v = e.as<T>()) {
+      r.push_back(*v);
+    } else {
+      return std::nullopt;
+    }
+  }
+  return ArrayValue::Storage(std::move(r));
 }
 
-Struct::Struct(std::vector<Value> const& es) {
-  elements.reserve(es.size());
-  std::transform(es.begin(), es.end(), elements.begin(), [](auto const& e) {
-    return indirect<Value>(e);
-  });
+/// Returns the storage of `es`, which are instances of `t`.
+inline ArrayValue::Storage storage_of(Type const& t, std::vector<Value>&& es) {
+  std::optional<ArrayValue::Storage> r;
+  if (t == Type::u16()) {
+    r = packed<Char>(es);
+  } else if (t == Type::i8()) {
+    r = packed<Byte>(es);
+  } else if (t == Type::i16()) {
+    r = packed<Short>(es);
+  } else if (t == Type::i32()) {
+    r = packed<Int>(es);
+  } else if (t == Type::i64()) {
+    r = packed<Long>(es);
+  } else if (t == Type::f32()) {
+    r = packed<Float>(es);
+  } else if (t == Type::f64()) {
+    r = packed<Double>(es);
+  }
+  return r.has_value() ? std::move(*r) : ArrayValue::Storage(std::move(es));
+}
+
+ArrayValue::ArrayValue(Type const& t, std::vector<Value>&& es) :
+  element_type(t), storage(storage_of(t, std::move(es)))
+{}
+
+std::size_t ArrayValue::size() const {
+  return std::visit([](auto const& es) { return es.size(); }, *storage);
+}
+
+Value ArrayValue::operator[](std::size_t i) const {
+  return std::visit([&](auto const& es) { return Value(es[i]); }, *storage);
 }
 
 Type Struct::type() const {
-  std::vector<indirect<Type>> es;
-  es.reserve(elements.size());
-  std::transform(elements.begin(), elements.end(), es.begin(), [](auto& e) {
-    return indirect<Type>(e->type());
+  std::vector<Type> es;
+  es.reserve(elements->size());
+  std::transform(elements->begin(), elements->end(), std::back_inserter(es), [](auto& e) {
+    return e.type();
   });
   return Type(type::Struct(std::move(es)));
 }
@@ -31,11 +66,77 @@ Type Struct::type() const {
 
 namespace nir {
 
+void Value::copy_from(Value const& other) {
+  header = other.header;
+  switch (other.kind()) {
+    case Kind::array:
+      new (&payload.array) shared<value::ArrayValue>(other.payload.array);
+      break;
+    case Kind::struct_:
+      new (&payload.struct_) value::Struct(other.payload.struct_);
+      break;
+    case Kind::constant:
+      new (&payload.constant) value::Constant(other.payload.constant);
+      break;
+    default:
+      payload.bits = other.payload.bits;
+      break;
+  }
+}
+
+void Value::move_from(Value& other) {
+  header = other.header;
+  switch (other.kind()) {
+    case Kind::array:
+      new (&payload.array) shared<value::ArrayValue>(std::move(other.payload.array));
+      break;
+    case Kind::struct_:
+      new (&payload.struct_) value::Struct(std::move(other.payload.struct_));
+      break;
+    case Kind::constant:
+      new (&payload.constant) value::Constant(std::move(other.payload.constant));
+      break;
+    default:
+      payload.bits = other.payload.bits;
+      return;
+  }
+
+  // Leave `other` without out-of-line parts.
+  other.release();
+  other.set_header(Kind::null);
+}
+
+void Value::release() {
+  switch (kind()) {
+    case Kind::array:
+      payload.array.~shared();
+      break;
+    case Kind::struct_:
+      payload.struct_.~Struct();
+      break;
+    case Kind::constant:
+      payload.constant.~Constant();
+      break;
+    default:
+      break;
+  }
+}
+
 Type Value::type() const {
-  return std::visit([](auto&& self) {
+  return visit([](auto&& self) {
     using T = std::decay_t<decltype(self)>;
     return value::ValueTrait<T>::type(self);
-  }, wrapped);
+  });
+}
+
+bool Value::operator==(Value const& rhs) const {
+  if (kind() != rhs.kind()) {
+    return false;
+  }
+  return visit([&](auto&& self) {
+    using T = std::decay_t<decltype(self)>;
+    return self == rhs.get<T>();
+  });
 }
 
 } // nir
@@ -0,0 +1,171 @@
+#include "Workspace.hh"
+#include "BatchReader.hh"
+#include "Utilities/Concurrency.hh"
+#include "Utilities/Defer.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <utility>
+
+namespace nir {
+
+std::vector<FoundFile> enumerate_files(
+  std::vector<std::filesystem::path> const& roots, std::size_t thread_count
+) {
+  // Each thread lists the entries of one directory at a time, so that the traversal of sibling
+  // subtrees is shared among all threads.
+  std::vector<FoundFile> result;
+  std::vector<std::filesystem::path> pending;
+  for (auto const& r : roots) {
+    if (std::filesystem::is_directory(r)) {
+      pending.push_back(r);
+    } else {
+      result.push_back({r, std::filesystem::file_size(r)});
+    }
+  }
+
+  // The threads stop once no directory is pending and none is being listed, since only the
+  // listing of a directory can add new ones.
+  std::mutex lock;
+  std::condition_variable changed;
+  std::size_t busy = 0;
+  bool failed = false;
+
+  concurrently(pending.empty() ? 0 : thread_count, [&](std::size_t) {
+    while (true) {
+      std::filesystem::path directory;
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [&]() { return !pending.empty() || (busy == 0) || failed; });
+        if (pending.empty() || failed) { return; }
+        directory = std::move(pending.back());
+        pending.pop_back();
+        ++busy;
+      }
+
+      std::vector<std::filesystem::path> subdirectories;
+      std::vector<FoundFile> files;
+      bool completed = false;
+      defer release([&]() {
+        std::lock_guard<std::mutex> guard(lock);
+        pending.insert(pending.end(), subdirectories.begin(), subdirectories.end());
+        result.insert(result.end(), files.begin(), files.end());
+        failed = failed || !completed;
+        --busy;
+        changed.notify_all();
+      });
+
+      for (auto const& e : std::filesystem::directory_iterator(directory)) {
+        if (e.is_directory() && !e.is_symlink()) {
+          subdirectories.push_back(e.path());
+        } else if (e.is_regular_file() && (e.path().extension() == ".nir")) {
+          files.push_back({e.path(), e.file_size()});
+        }
+      }
+      completed = true;
+    }
+  });
+
+  // Roots may overlap, in which case the same file is found more than once.
+  std::sort(result.begin(), result.end(), [](auto const& a, auto const& b) {
+    return a.path < b.path;
+  });
+  auto end = std::unique(result.begin(), result.end(), [](auto const& a, auto const& b) {
+    return a.path == b.path;
+  });
+  result.erase(end, result.end());
+  return result;
+}
+
+/// Returns the files decoded by the workers created by `make_worker` on `thread_count` threads, at
+/// the same indices as `sizes`, which are the sizes of their contents.
+///
+/// Each thread creates a worker, which is then called with the indices of batches of at most
+/// `batch_size` files and returns the files decoded at these indices, in the same order.
+template<typename F>
+std::vector<File> decode_concurrently(
+  std::vector<std::uintmax_t> const& sizes, std::size_t thread_count, std::size_t batch_size,
+  F&& make_worker
+) {
+  // Files are claimed from largest to smallest so that a large file doesn't start last and delay
+  // the completion of the whole workspace. Each thread claims the next batch of files when it is
+  // done with its last one, which balances the load without any other coordination.
+  std::vector<std::size_t> order(sizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+    return sizes[a] > sizes[b];
+  });
+
+  std::vector<std::optional<File>> slots(sizes.size());
+  std::atomic<std::size_t> next{0};
+  concurrently(std::min(thread_count, sizes.size()), [&](std::size_t) {
+    auto decode = make_worker();
+    while (true) {
+      auto i = next.fetch_add(batch_size, std::memory_order_relaxed);
+      if (i >= order.size()) { return; }
+
+      auto batch = std::span<std::size_t const>(order).subspan(
+        i, std::min(batch_size, order.size() - i));
+      auto files = decode(batch);
+      for (std::size_t k = 0; k < batch.size(); ++k) {
+        slots[batch[k]].emplace(std::move(files[k]));
+      }
+    }
+  });
+
+  std::vector<File> result;
+  result.reserve(slots.size());
+  for (auto& s : slots) { result.push_back(std::move(*s)); }
+  return result;
+}
+
+Workspace Workspace::load(
+  std::vector<std::filesystem::path> const& roots, WorkspaceOptions const& options
+) {
+  auto thread_count = (options.thread_count == 0) ? hardware_thread_count() : options.thread_count;
+  auto found = enumerate_files(roots, thread_count);
+
+  std::vector<std::filesystem::path> paths;
+  std::vector<std::uintmax_t> sizes;
+  paths.reserve(found.size());
+  sizes.reserve(found.size());
+  for (auto& f : found) {
+    paths.push_back(std::move(f.path));
+    sizes.push_back(f.size);
+  }
+
+  // The contents of a batch are read with as few system calls as possible, then decoded from
+  // buffers owned by the resulting files.
+  auto batch_size = std::max<std::size_t>(options.batch_size, 1);
+  auto files = decode_concurrently(sizes, thread_count, batch_size, [&]() {
+    return [&, reader = BatchReader(batch_size)](std::span<std::size_t const> batch) mutable {
+      std::vector<std::filesystem::path> ps;
+      std::vector<std::uintmax_t> ss;
+      for (auto i : batch) {
+        ps.push_back(paths[i]);
+        ss.push_back(sizes[i]);
+      }
+
+      std::vector<File> result;
+      for (auto& c : reader.read(ps, ss)) {
+        result.push_back(File::from_buffer(std::move(c), options.decoding));
+      }
+      return result;
+    };
+  });
+  return Workspace(std::move(paths), std::move(files));
+}
+
+std::size_t Workspace::definition_count() const {
+  std::size_t n = 0;
+  for (auto const& f : _files) { n += f.definitions.size(); }
+  return n;
+}
+
+} // nir
@@ -0,0 +1,34 @@
+#include "Bundle.hh"
+#include "Workspace.hh"
+#include "Utilities/Concurrency.hh"
+
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+/// Packs the NIR files at the paths given on the command line into a bundle.
+///
+/// Inputs are enumerated like the roots of a workspace (see `nir::enumerate_files`): directories
+/// are searched recursively for files whose extension is `.nir`, and the files are packed sorted
+/// by path so that bundles are reproducible.
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "usage: nirpack <output> <input>..." << std::endl;
+    return 1;
+  }
+
+  try {
+    std::vector<std::filesystem::path> roots(argv + 2, argv + argc);
+    std::vector<std::filesystem::path> inputs;
+    for (auto& f : nir::enumerate_files(roots, nir::hardware_thread_count())) {
+      inputs.push_back(std::move(f.path));
+    }
+
+    nir::Bundle::pack(inputs, argv[1]);
+  } catch (std::exception const& e) {
+    std::cerr << "error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+#include "Decoder.hh"
+#include "LEB128.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace nir;
+
+/// The number of expectations that did not hold.
+std::size_t failure_count = 0;
+
+/// Reports a failure described by `message` unless `condition` holds.
+void expect(bool condition, char const* message) {
+  if (!condition) {
+    std::cerr << "failure: " << message << std::endl;
+    ++failure_count;
+  }
+}
+
+/// A kernel decoding unsigned LEB128s, along with its name.
+struct Kernel {
+
+  /// The name of the kernel.
+  char const* name;
+
+  /// The function implementing the kernel.
+  std::size_t (*decode)(const uint8_t*&, const uint8_t*, std::size_t, uint64_t*);
+
+};
+
+/// Returns the kernels supported by the host.
+std::vector<Kernel> supported_kernels() {
+  std::vector<Kernel> result = {{"scalar", &leb128::decode_unsigned_scalar}};
+#ifdef NIRC_HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    result.push_back({"sse2", &leb128::decode_unsigned_sse2});
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    result.push_back({"avx2", &leb128::decode_unsigned_avx2});
+  }
+#endif
+  return result;
+}
+
+/// Returns a value whose unsigned LEB128 is encoded on `size` bytes.
+uint64_t value_of_size(std::size_t size, uint64_t seed) {
+  auto low = (size == 1) ? 0 : uint64_t{1} << (7 * (size - 1));
+  auto span = (size >= 10) ? ~uint64_t{0} - low : (uint64_t{1} << (7 * size)) - low;
+  return low + (seed % span);
+}
+
+/// Appends the unsigned LEB128 of `v` to `o`.
+void encode(uint64_t v, std::vector<uint8_t>& o) {
+  do {
+    uint8_t b = v & 0x7f;
+    v >>= 7;
+    o.push_back((v != 0) ? (b | 0x80) : b);
+  } while (v != 0);
+}
+
+/// Checks that each kernel decodes a prefix of the values whose encodings have the given `sizes`,
+/// from a buffer ending right after their last byte, and stops right after that prefix.
+void expect_consistent_kernels(std::vector<std::size_t> const& sizes, uint64_t seed) {
+  std::vector<uint64_t> values;
+  std::vector<std::size_t> ends;
+  std::vector<uint8_t> encoded;
+  for (auto s : sizes) {
+    values.push_back(value_of_size(s, seed++ * 0x9e3779b97f4a7c15));
+    encode(values.back(), encoded);
+    ends.push_back(encoded.size());
+  }
+
+  for (auto const& k : supported_kernels()) {
+    // The bytes are copied to an allocation of their exact size, so that reads past their end can
+    // be detected by sanitizers.
+    std::vector<uint8_t> bytes(encoded.begin(), encoded.end());
+    std::vector<uint64_t> decoded(values.size());
+    const uint8_t* p = bytes.data();
+    auto n = k.decode(p, bytes.data() + bytes.size(), values.size(), decoded.data());
+
+    bool matches = (n <= values.size());
+    for (std::size_t i = 0; matches && (i < n); ++i) { matches = decoded[i] == values[i]; }
+    auto end = (n == 0) ? 0 : ends[n - 1];
+    matches = matches && (static_cast<std::size_t>(p - bytes.data()) == end);
+    if (!matches) {
+      std::cerr << "kernel " << k.name << " disagrees on " << sizes.size() << " values";
+      std::cerr << std::endl;
+      expect(false, "kernels decode different values");
+    }
+  }
+}
+
+/// Checks that a decoder reports a missing value at the end of exactly sized bytes holding one
+/// 2-byte value followed by 1-byte values, ending less than 8 bytes after a vector boundary.
+void expect_truncated_sequence_failure() {
+  std::vector<uint8_t> encoded;
+  encode(300, encoded);
+  for (uint64_t v = 0; v < 30; ++v) { encode(v, encoded); }
+
+  std::vector<uint8_t> bytes(encoded.begin(), encoded.end());
+  std::vector<uint64_t> decoded(32);
+
+  Decoder complete(std::span<const uint8_t>(bytes.data(), bytes.size()));
+  complete.read_unsigned_leb128s(31, decoded.data());
+  expect(!complete.has_failed(), "a complete sequence is not decoded");
+  expect((decoded[0] == 300) && (decoded[30] == 29), "a complete sequence is decoded wrongly");
+
+  Decoder truncated(std::span<const uint8_t>(bytes.data(), bytes.size()));
+  truncated.read_unsigned_leb128s(32, decoded.data());
+  try {
+    truncated.check();
+    expect(false, "a truncated sequence is not reported");
+  } catch (DecoderError const& e) {
+    expect(
+      e.diagnostic == description(DecoderFailure::not_enough_bytes),
+      "a truncated sequence is reported with the wrong failure");
+  }
+}
+
+int main() {
+  // Sequences of 1-byte values preceded by a longer one, so that the values near the end of the
+  // bytes start at every offset in the last vector.
+  for (std::size_t first = 1; first <= 10; ++first) {
+    for (std::size_t count = 1; count <= 80; ++count) {
+      std::vector<std::size_t> sizes = {first};
+      sizes.resize(count, 1);
+      expect_consistent_kernels(sizes, count);
+    }
+  }
+
+  // Sequences of values of random sizes, most of which fit in a word.
+  std::mt19937_64 random(42);
+  std::uniform_int_distribution<std::size_t> size_of(1, 10);
+  std::uniform_int_distribution<std::size_t> count_of(1, 64);
+  for (std::size_t i = 0; i < 2000; ++i) {
+    std::vector<std::size_t> sizes(count_of(random));
+    for (auto& s : sizes) { s = (size_of(random) <= 7) ? (i % 3) + 1 : size_of(random); }
+    expect_consistent_kernels(sizes, random());
+  }
+
+  expect_truncated_sequence_failure();
+
+  if (failure_count > 0) {
+    std::cerr << failure_count << " failure(s)" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,428 @@
+#include "AttributeSet.hh"
+#include "Bundle.hh"
+#include "Deserializer.hh"
+#include "File.hh"
+#include "Serializer.hh"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace nir;
+
+/// The number of expectations that did not hold.
+std::size_t failure_count = 0;
+
+/// Reports a failure described by `message` unless `condition` holds.
+void expect(bool condition, char const* message) {
+  if (!condition) {
+    std::cerr << "failure: " << message << std::endl;
+    ++failure_count;
+  }
+}
+
+/// Returns a position in the source file at `path`.
+SourcePosition position(char const* path, uint32_t line) {
+  return SourcePosition{SourceFile(path), line, 4};
+}
+
+/// Returns every attribute, thin and fat.
+AttributeSet all_attributes() {
+  AttributeSet result;
+  for (uint32_t k = 1; k <= static_cast<uint32_t>(attribute::Kind::uses_intrinsic); k <<= 1) {
+    auto kind = static_cast<attribute::Kind>(k);
+    if ((kind != attribute::Kind::bail_opt) && (kind != attribute::Kind::extern_) &&
+        (kind != attribute::Kind::link) && (kind != attribute::Kind::define)) {
+      result.append(Attribute(kind));
+    }
+  }
+  result.append(Attribute(attribute::BailOpt{""}));
+  result.append(Attribute(attribute::Extern{true}));
+  result.append(Attribute(attribute::Link{"m"}));
+  result.append(Attribute(attribute::Define{"__linux__"}));
+  result.append(Attribute(attribute::Alignment{64, std::nullopt}));
+  return result;
+}
+
+/// Returns an instance of each type.
+std::vector<Type> all_types(symbol::Top const& owner) {
+  return {
+    Type::vararg(), Type::u1(), Type::pointer(), Type::u16(), Type::i8(), Type::i16(),
+    Type::i32(), Type::i64(), Type::f32(), Type::f64(), Type::null(), Type::nothing(),
+    Type::virtual_(), Type::unit(), Type::size(),
+    Type(type::ArrayValue(Type::i32(), 4)),
+    Type(type::Struct({Type::i32(), Type::f32()})),
+    Type(type::Function({Type::i32()}, Type::unit())),
+    Type(type::Var(Type::i64())),
+    Type(type::ArrayReference(Type::f64(), false)),
+    Type(type::Reference(owner, true, false)),
+  };
+}
+
+/// Returns an instance of each value that a file can contain.
+std::vector<Value> all_values(symbol::Top const& owner, symbol::Member const& member) {
+  static value::Byte const bytes[] = {1, -2, 3};
+  auto ref = Type(type::Reference(owner));
+  return {
+    Value(true), Value(false), Value(value::Null()),
+    Value(value::Zero(Type(type::Struct({Type::i32(), Type::i64()})))),
+    Value(value::Char(65)), Value(value::Byte(-3)), Value(value::Short(-300)),
+    Value(value::Int(123456)), Value(value::Long(int64_t{1} << 40)),
+    Value(value::Float(1.5f)), Value(value::Double(-0.0)),
+    Value(value::Struct({Value(value::Int(1)), Value(value::Double(2.5))})),
+    Value(value::ArrayValue(std::vector<value::Int>{1, 2, 300000, -5})),
+    Value(value::ArrayValue(ref, {Value(value::Null()), Value(value::Zero(ref))})),
+    Value(value::ByteString(bytes)),
+    Value(value::Local(7, ref)),
+    Value(value::Symbol(Symbol(member), Type::pointer())),
+    Value(value::Unit()),
+    Value(value::Constant(Value(value::Long(-1)))),
+    Value(value::String("hello")),
+    Value(value::Virtual(5)),
+    Value(value::ClassOf(owner)),
+    Value(value::Size(99)),
+  };
+}
+
+/// Returns an instance of each operation, with every operator and memory order.
+std::vector<Operation> all_operations(symbol::Top const& owner, symbol::Member const& member) {
+  auto ref = Type(type::Reference(owner));
+  auto callee = type::Function({ref, Type::i32()}, Type::f64());
+  auto self = Value(value::Local(1, ref));
+  auto slot = Value(value::Local(2, Type(type::Var(Type::i32()))));
+  auto array = Value(value::Local(3, Type(type::ArrayReference(Type::i32(), true))));
+  auto tuple = Type(type::Struct({Type::i32(), Type(type::Struct({Type::f32()}))}));
+  auto one = Value(value::Int(1));
+  auto field = Type::i32();
+
+  std::vector<Operation> result = {
+    operation::Call{callee, Value(value::Symbol(Symbol(member), Type(callee))), {self, one}},
+    operation::Element{tuple, Value(value::Zero(Type::pointer())), {1, 0, 300}},
+    operation::Extract{Value(value::Zero(tuple)), {1, 0}},
+    operation::Insert{Value(value::Zero(tuple)), one, {0}},
+    operation::StackAllocate{Type::i64(), 16},
+    operation::ClassAllocate{owner, std::nullopt},
+    operation::ClassAllocate{owner, Value(value::Local(4, Type::pointer()))},
+    operation::FieldLoad{field, self, member},
+    operation::FieldStore{field, self, member, one},
+    operation::Field{self, member},
+    operation::Method{self, Signature{"D3fooiiEO"}},
+    operation::DynamicMethod{self, Signature{"D3fooiiEO"}},
+    operation::Module{owner},
+    operation::As{ref, Value(value::Null())},
+    operation::Is{ref, self},
+    operation::Copy{one},
+    operation::SizeOf{tuple},
+    operation::AlignmentOf{tuple},
+    operation::Box{ref, one},
+    operation::Unbox{ref, self},
+    operation::Var{Type::i32()},
+    operation::VarLoad{slot},
+    operation::VarStore{slot, one},
+    operation::ArrayAllocate{Type::i32(), Value(value::Int(8)), std::nullopt},
+    operation::ArrayAllocate{Type::i32(), Value(value::Int(8)), Value(value::Null())},
+    operation::ArrayLoad{Type::i32(), array, 2},
+    operation::ArrayStore{Type::i32(), array, 2, one},
+    operation::ArrayLength{array},
+  };
+
+  for (int o = 0; o <= static_cast<int>(BinaryOperator::xor_); ++o) {
+    result.push_back(operation::BinaryApply{static_cast<BinaryOperator>(o), Type::i32(), one, one});
+  }
+  for (int o = 0; o <= static_cast<int>(ComparisonOperator::fle); ++o) {
+    result.push_back(operation::Compare{static_cast<ComparisonOperator>(o), Type::i32(), one, one});
+  }
+  for (int o = 0; o <= static_cast<int>(ConversionOperator::bitcast); ++o) {
+    result.push_back(operation::Convert{static_cast<ConversionOperator>(o), Type::i64(), one});
+  }
+  for (int o = 0; o <= static_cast<int>(MemoryOrder::sequentially_consistent); ++o) {
+    auto order = static_cast<MemoryOrder>(o);
+    result.push_back(operation::Load{Type::i32(), self, order});
+    result.push_back(operation::Store{Type::i32(), self, one, order});
+    result.push_back(operation::Fence{order});
+  }
+  return result;
+}
+
+/// Returns a method whose instructions include each instruction, continuation, operation, and
+/// value that a file can contain.
+Definition all_instructions(symbol::Top const& owner) {
+  auto member = symbol::Member(owner, Signature{"D3runiEO"});
+  auto ref = Type(type::Reference(owner));
+  auto p = value::Local(1, ref);
+  auto at = position("src/main/scala/example/Main.scala", 12);
+
+  std::vector<Instruction> is;
+  is.push_back(instruction::Label{0, {p, value::Local(2, Type::i32())}, at});
+
+  Local id = 10;
+  for (auto const& o : all_operations(owner, member)) {
+    is.push_back(instruction::Let{id++, o, Next::none(), SourcePosition::invalid(), {1}});
+  }
+  for (auto const& v : all_values(owner, member)) {
+    is.push_back(instruction::Let{id++, operation::Copy{v}, Next::none(), at, {0}});
+  }
+
+  auto unwind = Next(next::Unwind{value::Local(3, ref), Next(next::Label{5, {Value(p)}})});
+  is.push_back(instruction::Let{
+    id++, operation::Call{type::Function({}, Type::unit()), Value(value::Null()), {}}, unwind,
+    at, {1}
+  });
+  is.push_back(instruction::Jump{Next(next::Label{6, {}}), at});
+  is.push_back(instruction::If{
+    Value(true), Next(next::Label{6, {}}), Next(next::Label{7, {Value(value::Int(0))}}), at
+  });
+  is.push_back(instruction::Switch{
+    Value(value::Int(1)),
+    {Next(next::Case{Value(value::Int(1)), Next(next::Label{6, {}})}), Next(next::Label{7, {}})},
+    at
+  });
+  is.push_back(instruction::Throw{Value(p), unwind, at});
+  auto is_windows = LinktimeCondition(linktime::SimpleCondition{
+    "scala.scalanative.meta.linktimeinfo.isWindows", Value(true), ComparisonOperator::ieq, at
+  });
+  auto is_x86 = LinktimeCondition(linktime::SimpleCondition{
+    "os.arch", Value(value::String("x86_64")), ComparisonOperator::ine, at
+  });
+  auto is_recent = LinktimeCondition(linktime::SimpleCondition{
+    "os.version", Value(value::Int(3)), ComparisonOperator::sge, SourcePosition::invalid()
+  });
+  auto either = LinktimeCondition(linktime::ComplexCondition{
+    is_x86, is_recent, LogicalOperator::or_, at
+  });
+  is.push_back(instruction::LinktimeJump{
+    linktime::ComplexCondition{is_windows, either, LogicalOperator::and_, at},
+    Next(next::Label{6, {}}), Next(next::Label{7, {Value(value::Int(0))}}), at
+  });
+  is.push_back(instruction::Unreachable{Next::none(), SourcePosition::invalid()});
+  is.push_back(instruction::Return{Value(value::Unit()), at});
+
+  definition::Method::DebugInformation debug{
+    {{1, "self"}, {2, ""}, {3, "e"}},
+    {LexicalScope{{1}, {0}, at}}
+  };
+  return definition::Method{
+    all_attributes(), member, type::Function({ref, Type::i32()}, Type::unit()), is, debug, at
+  };
+}
+
+/// Returns an instance of each definition.
+///
+/// The names of the definitions are chosen so that strings are written with every tag: some are
+/// empty, some are prefixes of strings written before, and some extend such prefixes.
+std::vector<Definition> all_definitions() {
+  auto object = symbol::Top("java.lang.Object");
+  auto string = symbol::Top("java.lang.String");
+  auto main = symbol::Top("example.Main");
+  auto module = symbol::Top("example.Main$");
+  auto serializable = symbol::Top("java.io.Serializable");
+  auto source = "src/main/scala/example/Main.scala";
+
+  std::vector<Definition> result;
+  result.push_back(definition::Class{{}, object, std::nullopt, {}, SourcePosition::invalid()});
+  result.push_back(definition::Trait{{}, serializable, {}, position(source, 1)});
+  result.push_back(definition::Trait{
+    {}, symbol::Top("java.lang"), {serializable}, position(source, 2)
+  });
+  result.push_back(definition::Class{
+    all_attributes(), string, object, {serializable}, position(source, 3)
+  });
+  result.push_back(definition::Class{{}, main, object, {}, position(source, 4)});
+  result.push_back(definition::Module{{}, module, object, {serializable}, position(source, 5)});
+  for (auto const& t : all_types(main)) {
+    result.push_back(definition::Binding{
+      {}, symbol::Member(main, Signature{"F5fieldO"}), t, Value(value::Zero(t)), false,
+      position(source, 6)
+    });
+  }
+  for (auto const& v : all_values(main, symbol::Member(main, Signature{"D4mainuEO"}))) {
+    result.push_back(definition::Binding{
+      {}, symbol::Member(module, Signature{"F5valueO"}), v.type(), v, true, position(source, 7)
+    });
+  }
+  result.push_back(definition::Forward{
+    {}, symbol::Member(main, Signature{"D4mainuEO"}), type::Function({}, Type::unit()),
+    position(source, 8)
+  });
+  result.push_back(all_instructions(main));
+
+  // A second copy of the method is written with back-references to the entities of the first.
+  result.push_back(all_instructions(main));
+  return result;
+}
+
+/// Checks that `definitions` are decoded as they were encoded and that encoding them again yields
+/// the same bytes, decoding with `options`.
+void expect_round_trip(std::vector<Definition> const& definitions, DecodingOptions options) {
+  File original(Header{5, 1, false}, std::vector<Definition>(definitions));
+  auto bytes = original.serialized();
+
+  auto decoded = File::from_bytes(bytes, options);
+  expect(decoded.definitions.size() == definitions.size(), "definitions are missing");
+  for (std::size_t i = 0; i < std::min(decoded.definitions.size(), definitions.size()); ++i) {
+    if (!(decoded.definitions[i] == definitions[i])) {
+      std::cerr << "definition " << i << " differs after decoding" << std::endl;
+      expect(false, "decoded definitions differ");
+    }
+  }
+  expect(decoded.serialized() == bytes, "encoding decoded definitions yields different bytes");
+}
+
+/// Calls `action` with a file descriptor from which `bytes` are read through a pipe.
+template<typename F>
+void with_pipe(std::vector<uint8_t> const& bytes, F&& action) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    expect(false, "a pipe could not be created");
+    return;
+  }
+
+  std::thread writer([&]() {
+    for (std::size_t i = 0; i < bytes.size();) {
+      auto n = write(fds[1], bytes.data() + i, bytes.size() - i);
+      if (n <= 0) { break; }
+      i += static_cast<std::size_t>(n);
+    }
+    close(fds[1]);
+  });
+  action(fds[0]);
+  close(fds[0]);
+  writer.join();
+}
+
+/// Checks that `definitions` are decoded as they were encoded when they are streamed through a
+/// pipe with nodes allocated in arenas, and that a truncated stream is reported as an error.
+void expect_streamed_round_trip(std::vector<Definition> const& definitions) {
+  File original(Header{5, 1, false}, std::vector<Definition>(definitions));
+  auto bytes = original.serialized();
+  DecodingOptions options{1, true, false};
+
+  with_pipe(bytes, [&](int fd) {
+    auto decoded = File::from_descriptor(fd, options);
+    expect(decoded.serialized() == bytes, "streaming definitions yields different bytes");
+  });
+
+  // The arena of the stream is released with the stream, after the values it interned.
+  with_pipe(bytes, [&](int fd) {
+    auto stream = DefinitionStream::from_descriptor(fd, options);
+    auto d = stream.next();
+    expect(d.has_value(), "a streamed definition is missing");
+  });
+
+  // The arena of the stream is released while unwinding, after the values it interned.
+  bytes.resize(bytes.size() - 3);
+  with_pipe(bytes, [&](int fd) {
+    try {
+      File::from_descriptor(fd, options);
+      expect(false, "a truncated stream is decoded");
+    } catch (DecoderError const&) {}
+  });
+}
+
+/// Checks that a map of local names whose count exceeds the bytes left is reported as truncated
+/// rather than allocated or decoded entirely.
+void expect_truncated_local_names() {
+  for (uint64_t count : {uint64_t{30'000'000}, uint64_t{100'000'000'000'000}}) {
+    std::vector<uint8_t> bytes;
+    Serializer(bytes).unsigned_leb128(count);
+    Decoder source(std::span<const uint8_t>(bytes.data(), bytes.size()));
+    Deserializer(source).local_name();
+    expect(source.has_failed(), "a truncated map of local names is not reported");
+  }
+}
+
+/// Checks that the members of a bundle packed from files holding `definitions` are decoded as they
+/// were encoded, each on its own, and that they refer to the entities interned by the prelude.
+void expect_bundle_round_trip(std::vector<Definition> const& definitions) {
+  auto object = symbol::Top("java.lang.Object");
+  auto other = symbol::Top("example.Other");
+  std::vector<std::vector<Definition>> members = {
+    definitions,
+    std::vector<Definition>(definitions.begin() + 4, definitions.end()),
+    {definition::Class{{}, other, object, {}, position("src/main/scala/example/Other.scala", 1)}}
+  };
+
+  auto directory = std::filesystem::temp_directory_path() / ("nirc-" + std::to_string(getpid()));
+  std::filesystem::create_directories(directory);
+  std::vector<std::filesystem::path> paths;
+  std::vector<std::vector<uint8_t>> contents;
+  for (std::size_t i = 0; i < members.size(); ++i) {
+    paths.push_back(directory / (std::to_string(i) + ".nir"));
+    contents.push_back(File(Header{5, 1, false}, std::vector<Definition>(members[i])).serialized());
+    std::ofstream(paths.back(), std::ios::binary).write(
+      reinterpret_cast<char const*>(contents.back().data()),
+      static_cast<std::streamsize>(contents.back().size()));
+  }
+  Bundle::pack(paths, directory / "bundle");
+  auto bundle = Bundle::open((directory / "bundle").string());
+
+  expect(bundle.size() == members.size(), "bundle members are missing");
+  for (std::size_t i = 0; i < std::min(bundle.size(), members.size()); ++i) {
+    auto eager = bundle.load(i);
+    auto concurrent = bundle.load(i, DecodingOptions{4, true, false});
+    auto lazy = bundle.load_lazily(i);
+    expect(eager.definitions == members[i], "bundle members differ after decoding");
+    expect(concurrent.definitions == members[i], "bundle members differ after decoding");
+    expect(lazy.size() == members[i].size(), "lazy bundle members are missing definitions");
+    for (std::size_t j = members[i].size(); j-- > 0;) {
+      expect(lazy.at(j) == members[i][j], "lazy bundle members differ after decoding");
+    }
+  }
+
+  // The second member only holds definitions whose entities are also interned by the first.
+  expect(bundle.contents(1).size() < contents[1].size(), "bundle members share no entity");
+
+  auto l = bundle.find(Symbol(other));
+  expect(l.has_value() && (l->member == 2) && (l->index == 0), "a bundle definition is not found");
+
+  std::filesystem::remove_all(directory);
+}
+
+/// Checks that the aggregates allocated in an arena are read without being copied once that arena
+/// is no longer current.
+void expect_shared_reads() {
+  Arena arena;
+  std::optional<Value> s, a;
+  {
+    ArenaScope scope(arena);
+    s.emplace(value::Struct({Value(value::Int(1)), Value(value::Null())}));
+    a.emplace(value::ArrayValue(std::vector<value::Long>(1024, 7)));
+  }
+
+  auto elements = &*s->as<value::Struct>()->elements;
+  auto visited = s->visit([](auto const& w) -> void const* {
+    using T = std::decay_t<decltype(w)>;
+    if constexpr (std::is_same_v<T, value::Struct>) { return &*w.elements; }
+    return nullptr;
+  });
+  expect(visited == elements, "visiting a struct copies its elements");
+  expect(a->as<value::ArrayValue>() == a->as<value::ArrayValue>(), "reading an array copies it");
+  expect(s->type() == Type(type::Struct({Type::i32(), Type::null()})), "a struct has a wrong type");
+
+  // Copies made outside of the arena don't depend on it.
+  auto c = *s;
+  expect(&*c.as<value::Struct>()->elements != elements, "a copy refers to an arena's node");
+  expect(c == *s, "a copy differs from its original");
+}
+
+int main() {
+  auto definitions = all_definitions();
+  expect_round_trip(definitions, DecodingOptions{});
+  expect_round_trip(definitions, DecodingOptions{4, true, false});
+  expect_streamed_round_trip(definitions);
+  expect_shared_reads();
+  expect_truncated_local_names();
+  expect_bundle_round_trip(definitions);
+
+  if (failure_count > 0) {
+    std::cerr << failure_count << " failure(s)" << std::endl;
+    return 1;
+  }
+  return 0;
+}
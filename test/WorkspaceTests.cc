@@ -0,0 +1,293 @@
+#include "BatchReader.hh"
+#include "File.hh"
+#include "LazyWorkspace.hh"
+#include "SymbolIndex.hh"
+#include "Workspace.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace nir;
+
+/// The number of expectations that did not hold.
+std::size_t failure_count = 0;
+
+/// Reports a failure described by `message` unless `condition` holds.
+void expect(bool condition, char const* message) {
+  if (!condition) {
+    std::cerr << "failure: " << message << std::endl;
+    ++failure_count;
+  }
+}
+
+/// Returns the path of a new empty directory named after `name`, in the temporary directory.
+std::filesystem::path temporary_directory(std::string const& name) {
+  auto result =
+    std::filesystem::temp_directory_path() / ("nirc-" + name + "-" + std::to_string(getpid()));
+  std::filesystem::remove_all(result);
+  std::filesystem::create_directories(result);
+  return result;
+}
+
+/// Writes a NIR file holding `definitions` at `path`.
+void write_definitions(std::filesystem::path const& path, std::vector<Definition>&& definitions) {
+  auto bytes = File(Header{5, 1, false}, std::move(definitions)).serialized();
+  std::ofstream(path, std::ios::binary | std::ios::trunc).write(
+    reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+/// Returns the definition of a class identified by `id`.
+Definition class_named(std::string const& id) {
+  return definition::Class{
+    {}, symbol::Top(id), symbol::Top("java.lang.Object"), {}, SourcePosition::invalid()
+  };
+}
+
+/// Writes a NIR file defining a class for each identifier in `ids` at `path`.
+void write_classes(std::filesystem::path const& path, std::vector<std::string> const& ids) {
+  std::vector<Definition> definitions;
+  for (auto const& id : ids) { definitions.push_back(class_named(id)); }
+  write_definitions(path, std::move(definitions));
+}
+
+/// Returns the contents of the file at `path`.
+std::vector<uint8_t> contents_of(std::filesystem::path const& path) {
+  std::ifstream f(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+/// Checks that a batch reader reads files in several batches, including files whose size changed
+/// since it was recorded, and that it reports a file that can't be read.
+void expect_batch_reads() {
+  auto root = temporary_directory("batches");
+  std::vector<std::filesystem::path> paths;
+  std::vector<std::uintmax_t> sizes;
+  for (std::size_t i = 0; i < 10; ++i) {
+    paths.push_back(root / "f");
+    paths.back() += std::to_string(i) + ".nir";
+    write_classes(paths.back(), {"test.F" + std::to_string(i)});
+    sizes.push_back(std::filesystem::file_size(paths.back()));
+  }
+
+  // The third file grows and the fifth shrinks after their sizes are recorded.
+  write_classes(paths[2], {"test.F2", "test.Grown0", "test.Grown1"});
+  write_classes(paths[4], {});
+
+  BatchReader reader(4);
+#ifdef NIRC_NO_IO_URING
+  expect(!reader.uses_io_uring(), "files are read through an io_uring that is disabled");
+#endif
+  auto result = reader.read(paths, sizes);
+  expect(result.size() == paths.size(), "files are missing");
+  for (std::size_t i = 0; i < std::min(result.size(), paths.size()); ++i) {
+    if (result[i] != contents_of(paths[i])) {
+      std::cerr << "file " << i << " is read wrongly" << std::endl;
+      expect(false, "files are read wrongly");
+    }
+  }
+  expect(reader.system_call_count() > 0, "system calls are not counted");
+
+  // A missing file is reported, and doesn't prevent the reader from being used afterward.
+  auto missing = paths;
+  missing[6] = root / "missing.nir";
+  try {
+    reader.read(missing, sizes);
+    expect(false, "a missing file is read");
+  } catch (std::ios_base::failure const&) {}
+  expect(reader.read(paths, sizes) == result, "files are read wrongly after a failure");
+
+  std::filesystem::remove_all(root);
+}
+
+/// Checks that a workspace loaded concurrently has its files sorted by path, without duplicates,
+/// and its definitions in the order of these files.
+void expect_deterministic_loading() {
+  auto root = temporary_directory("workspace");
+  std::filesystem::create_directories(root / "b");
+  std::vector<std::pair<std::filesystem::path, std::string>> files = {
+    {root / "c.nir", "test.C"}, {root / "b" / "z.nir", "test.Z"}, {root / "a.nir", "test.A"},
+    {root / "b" / "y.nir", "test.Y"}, {root / "d.nir", "test.D"}
+  };
+  for (auto const& [path, id] : files) { write_classes(path, {id, id + "$"}); }
+  std::ofstream(root / "notes.txt") << "not a NIR file";
+
+  // The file `c.nir` is enumerated both on its own and in `root`.
+  auto w = Workspace::load({root / "c.nir", root}, WorkspaceOptions{4, 2, DecodingOptions{}});
+  std::vector<std::filesystem::path> expected_paths = {
+    root / "a.nir", root / "b" / "y.nir", root / "b" / "z.nir", root / "c.nir", root / "d.nir"
+  };
+  expect(w.paths() == expected_paths, "files are not sorted by path without duplicates");
+
+  std::vector<std::string> names;
+  w.for_each_definition([&](Definition const& d) {
+    names.push_back(std::string(d.name().as<symbol::Top>()->id()));
+  });
+  std::vector<std::string> expected_names = {
+    "test.A", "test.A$", "test.Y", "test.Y$", "test.Z", "test.Z$", "test.C", "test.C$",
+    "test.D", "test.D$"
+  };
+  expect(names == expected_names, "definitions are not in the order of their files");
+  expect(w.definition_count() == expected_names.size(), "definitions are not counted");
+
+  // Loading on a single thread yields the same workspace.
+  auto sequential = Workspace::load({root}, WorkspaceOptions{1, 1, DecodingOptions{}});
+  expect(sequential.paths() == expected_paths, "files are loaded in a different order");
+
+  std::filesystem::remove_all(root);
+}
+
+/// Checks that an index of the workspace at `root` locates the first definition of each symbol
+/// in that workspace and no other symbol, building it on `thread_count` threads.
+void expect_complete_index(std::filesystem::path const& root, std::size_t thread_count) {
+  auto w = Workspace::load({root});
+  auto index = SymbolIndex::build(w, thread_count);
+
+  std::unordered_map<Symbol, SymbolIndex::Location> expected;
+  for (uint32_t i = 0; i < w.size(); ++i) {
+    auto const& definitions = w.files()[i].definitions;
+    for (uint32_t j = 0; j < definitions.size(); ++j) {
+      expected.emplace(definitions[j].name(), SymbolIndex::Location{i, j});
+    }
+  }
+  expect(index.size() == expected.size(), "the index has a wrong number of symbols");
+
+  std::size_t wrong = 0;
+  for (auto const& [name, location] : expected) {
+    auto l = index.find(name);
+    if (!l.has_value() || (l->file != location.file) || (l->definition != location.definition)) {
+      ++wrong;
+    }
+  }
+  expect(wrong == 0, "a definition is not located by the index");
+  expect(!index.find(Symbol(symbol::Top("test.Undefined"))).has_value(), "a symbol is found");
+  expect(
+    !index.find(Symbol(symbol::Member(symbol::Top("test.Undefined"), Signature{"F1xO"})))
+      .has_value(),
+    "a member is found");
+}
+
+/// Checks that a symbol index locates the definitions of workspaces of various sizes, keeping the
+/// first definition of each symbol.
+void expect_symbol_index() {
+  auto root = temporary_directory("index");
+
+  // An empty workspace.
+  {
+    auto index = SymbolIndex::build(Workspace::load({root}));
+    expect(index.size() == 0, "an empty workspace has an index with symbols");
+    expect(!index.find(Symbol(symbol::Top("test.A"))).has_value(), "a symbol is found");
+  }
+
+  // A small workspace, in which two files define the same symbols.
+  write_classes(root / "a.nir", {"test.A", "test.Duplicate"});
+  write_definitions(root / "b.nir", {
+    class_named("test.B"), class_named("test.Duplicate"),
+    definition::Binding{
+      {}, symbol::Member(symbol::Top("test.B"), Signature{"F5countO"}), Type::i32(),
+      Value(value::Zero(Type::i32())), false, SourcePosition::invalid()
+    }
+  });
+  {
+    auto index = SymbolIndex::build(Workspace::load({root}));
+    auto l = index.find(Symbol(symbol::Top("test.Duplicate")));
+    expect(l.has_value() && (l->file == 0) && (l->definition == 1), "the first definition loses");
+  }
+  expect_complete_index(root, 1);
+
+  // A workspace spanning several partitions.
+  for (std::size_t f = 0; f < 3; ++f) {
+    std::vector<std::string> ids;
+    for (std::size_t k = 0; k < 3000; ++k) {
+      ids.push_back("test.p" + std::to_string(f) + ".C" + std::to_string(k));
+    }
+    ids.push_back("test.Duplicate");
+    write_classes(root / ("large" + std::to_string(f) + ".nir"), ids);
+  }
+  expect_complete_index(root, 1);
+  expect_complete_index(root, 4);
+
+  std::filesystem::remove_all(root);
+}
+
+/// Checks that the filters stored in a table are reused when the files they describe are
+/// unchanged or merely touched, and that a stale filter doesn't hide a definition.
+void expect_filter_reuse() {
+  auto root = temporary_directory("filters");
+  auto table = root / "filters";
+  auto a = root / "a.nir";
+  auto b = root / "b.nir";
+  write_classes(a, {"test.A0", "test.A1"});
+  write_classes(b, {"test.B0"});
+
+  // The first time the workspace is opened, every filter is built and the table is written.
+  {
+    auto w = LazyWorkspace::open({a, b}, table, 1);
+    expect(w.reused_filter_count() == 0, "filters are reused from a table that doesn't exist");
+    expect(std::filesystem::exists(table), "the filter table is not written");
+    expect(w.definition(Symbol(symbol::Top("test.A1"))) != nullptr, "a definition is not found");
+  }
+
+  // Unchanged files reuse their filters as is.
+  {
+    auto w = LazyWorkspace::open({a, b}, table, 1);
+    expect(w.reused_filter_count() == 2, "filters of unchanged files are not reused");
+  }
+
+  // A touched file whose contents are unchanged reuses its filter after its hash is checked.
+  std::filesystem::last_write_time(
+    a, std::filesystem::last_write_time(a) + std::chrono::seconds(10));
+  {
+    auto w = LazyWorkspace::open({a, b}, table, 1);
+    expect(w.reused_filter_count() == 2, "filters of touched files are not reused");
+    expect(w.definition(Symbol(symbol::Top("test.A0"))) != nullptr, "a definition is not found");
+  }
+
+  // A file rewritten with the same size and modification time keeps its stale filter, which is
+  // checked before a lookup reports a missing definition.
+  auto time = std::filesystem::last_write_time(b);
+  auto size = std::filesystem::file_size(b);
+  write_classes(b, {"test.B1"});
+  std::filesystem::last_write_time(b, time);
+  expect(std::filesystem::file_size(b) == size, "the rewritten file has a different size");
+  {
+    auto w = LazyWorkspace::open({a, b}, table, 1);
+    expect(w.reused_filter_count() == 2, "a filter of an unchanged file state is not reused");
+    expect(
+      w.definition(Symbol(symbol::Top("test.B1"))) != nullptr,
+      "a definition hidden by a stale filter is not found");
+    expect(
+      w.definition(Symbol(symbol::Top("test.B0"))) == nullptr, "a removed definition is found");
+
+    // Filters exclude the files that don't define a symbol.
+    auto skipped = w.statistics().skipped_count;
+    expect(
+      w.definition(Symbol(symbol::Top("test.Missing"))) == nullptr,
+      "an undefined symbol is found");
+    expect(w.statistics().skipped_count > skipped, "no file is skipped for an undefined symbol");
+  }
+
+  std::filesystem::remove_all(root);
+}
+
+int main() {
+  expect_batch_reads();
+  expect_deterministic_loading();
+  expect_symbol_index();
+  expect_filter_reuse();
+
+  if (failure_count > 0) {
+    std::cerr << failure_count << " failure(s)" << std::endl;
+    return 1;
+  }
+  return 0;
+}